@@ -0,0 +1,121 @@
+/*
+* battle_analysis.cpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*/
+#include "battle_analysis.hpp"
+
+#include <cstdlib>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+#include "battle_simulator.hpp"
+#include "moveset_optimizer.hpp"
+#include "resources.hpp"
+
+#define BATTLE_ANALYSIS_DEFAULT_GAMES 100000
+#define BATTLE_ANALYSIS_DEFAULT_SEED 2016
+
+namespace pokeman {
+namespace driver {
+/// Best recommended set for the monster, or no moves if it has none.
+static Moveset pickMoveset(const MovesetOptimizer& optimizer, const Monster& monster) {
+  std::vector<Moveset> best = optimizer.findBest(monster, monster.species_->getMovepool(), monster.hm_moves_, 1);
+  if(best.empty()) {
+    Moveset moveset;
+    moveset.count = 0;
+    moveset.score = 0.0;
+    return moveset;
+  }
+  return best.front();
+}
+
+static void printResult(const std::string& description, const BattleResult& result) {
+  double low, high;
+  result.confidenceInterval(&low, &high);
+  std::cout << "  " << description << ": " << std::fixed << std::setprecision(1) << 100.0 * result.winRate()
+    << "% (" << 100.0 * low << "-" << 100.0 * high << "%)" << std::endl;
+}
+
+int battle_analysis(int argc, const char* argv[]) {
+  uint64_t games = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : BATTLE_ANALYSIS_DEFAULT_GAMES;
+  uint64_t seed = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : BATTLE_ANALYSIS_DEFAULT_SEED;
+
+  // get database
+  bool error_occured;
+  resources::PokemanDatabase data = resources::initialize(&error_occured);
+  if(error_occured) {
+    std::cerr << "Couldn't load database; Exiting now" << std::endl;
+    return 1;
+  }
+  const std::vector<Monster>& team = data.getTeam();
+  if(team.empty()) {
+    std::cerr << "[Error] the team is empty" << std::endl;
+    return 2;
+  }
+
+  MoveCoverageTable coverage(data.getMoves(), data.getChart());
+  MovesetOptimizer optimizer;
+  optimizer.move_library_ = &data.getMoves();
+  optimizer.coverage_table_ = &coverage;
+  BattleSimulator simulator;
+  simulator.move_library_ = &data.getMoves();
+  simulator.chart_ = &data.getChart();
+
+  // the team, with its recommended sets
+  BattleTeam player;
+  for(const Monster& monster : team) {
+    player.add(Combatant(monster), pickMoveset(optimizer, monster));
+  }
+
+  // each species at the team's first level, with its own recommended set
+  std::vector<const MonsterSpecies*> species_list = data.getSpecies().getAll();
+  std::vector<BattleTeam> opponents;
+  BattleTeam roster;
+  for(const MonsterSpecies* species : species_list) {
+    Monster monster(species->name_, species);
+    monster.level_ = team.front().level_;
+    BattleTeam single;
+    single.add(Combatant(monster), pickMoveset(optimizer, monster));
+    opponents.push_back(single);
+    if(roster.members.size() < BATTLE_TEAM_SIZE)
+      roster.add(single.members.front(), single.movesets.front());
+  }
+
+  std::cout << "--[ Battles: " << games << " games each, seed " << seed << " ]--" << std::endl;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  uint64_t turns = 0;
+
+  // whole team
+  BattleResult result = simulator.simulate(player, roster, games, seed);
+  turns += result.turns;
+  printResult("Team vs roster", result);
+  std::cout << std::endl;
+
+  // one on one
+  for(size_t i = 0; i < team.size(); i++) {
+    std::cout << team[i].toString() << ":" << std::endl;
+    BattleTeam alone;
+    alone.add(player.members[i], player.movesets[i]);
+    for(size_t j = 0; j < opponents.size(); j++) {
+      result = simulator.simulate(alone, opponents[j], games, seed);
+      turns += result.turns;
+      printResult("vs " + species_list[j]->name_, result);
+    }
+    std::cout << std::endl;
+  }
+
+  // speed
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << turns << " turns in " << std::setprecision(2) << seconds << "s ("
+    << std::setprecision(0) << (seconds > 0 ? turns / seconds : 0.0) << " turns/s)" << std::endl;
+
+  // done
+  return 0;
+}
+
+} // namespace driver
+} // namespace pokeman
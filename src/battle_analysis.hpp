@@ -0,0 +1,19 @@
+/*
+* battle_analysis.hpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*
+* Driver that simulates battles to see how the team's movesets hold up.
+*/
+#ifndef POKEMAN_BATTLE_ANALYSIS_HPP_
+#define POKEMAN_BATTLE_ANALYSIS_HPP_
+#include "pokeman.hpp"
+
+namespace pokeman {
+namespace driver {
+int battle_analysis(int argc, const char* argv[]);
+} // namespace driver
+} // namespace pokeman
+
+#endif //POKEMAN_BATTLE_ANALYSIS_HPP_
@@ -0,0 +1,296 @@
+/*
+* battle_simulator.cpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*/
+#include "battle_simulator.hpp"
+
+#include <cassert>
+#include <cmath>
+
+#include <algorithm>
+
+#include "parallel.hpp"
+
+#define BATTLE_ATTACK 0
+#define BATTLE_DEFENSE 1
+#define BATTLE_SPECIAL_ATTACK 2
+#define BATTLE_SPECIAL_DEFENSE 3
+#define BATTLE_SPEED 4
+
+/// Used when a monster is out of pp.
+#define BATTLE_STRUGGLE_POWER 50
+
+namespace pokeman {
+
+void BattleTeam::add(const Combatant & member, const Moveset & moveset) {
+  members.push_back(member);
+  movesets.push_back(moveset);
+}
+
+BattleResult::BattleResult() : games(0), wins(0), losses(0), draws(0), turns(0) {}
+
+double BattleResult::winRate() const {
+  return games == 0 ? 0.0 : (wins + 0.5 * draws) / games;
+}
+
+void BattleResult::confidenceInterval(double * low, double * high) const {
+  if(games == 0) {
+    *low = 0.0;
+    *high = 1.0;
+    return;
+  }
+  const double z = 1.96;
+  double n = (double)games;
+  double p = winRate();
+  double center = (p + z * z / (2 * n)) / (1 + z * z / n);
+  double spread = z * std::sqrt(p * (1 - p) / n + z * z / (4 * n * n)) / (1 + z * z / n);
+  *low = std::max(center - spread, 0.0);
+  *high = std::min(center + spread, 1.0);
+}
+
+BattleResult & BattleResult::operator+=(const BattleResult & that) {
+  games += that.games;
+  wins += that.wins;
+  losses += that.losses;
+  draws += that.draws;
+  turns += that.turns;
+  return *this;
+}
+
+BattleSimulator::BattleSimulator() : move_library_(nullptr), chart_(nullptr), thread_count_(0) {}
+
+BattleResult BattleSimulator::simulate(const BattleTeam & team, const BattleTeam & opponents, const uint64_t games, const uint64_t seed) const {
+  assert(move_library_ != nullptr);
+  assert(chart_ != nullptr);
+  BattleResult total;
+  if(team.members.empty() || opponents.members.empty()) {
+    return total;
+  }
+  Matchup matchup;
+  prepare(team, opponents, &matchup);
+
+  // split the games into streams, each with its own generator
+  const uint64_t game_count = std::min<uint64_t>(games, BATTLE_MAX_GAMES);
+  const size_t stream_count = (size_t)((game_count + BATTLE_GAMES_PER_STREAM - 1) / BATTLE_GAMES_PER_STREAM);
+  std::vector<BattleResult> results(stream_count);
+  parallel::forEachIndex(stream_count, [&](size_t stream) {
+    std::seed_seq seeds = {(uint32_t)seed, (uint32_t)(seed >> 32), (uint32_t)stream, (uint32_t)((uint64_t)stream >> 32)};
+    std::mt19937_64 rng(seeds);
+    uint64_t first = stream * (uint64_t)BATTLE_GAMES_PER_STREAM;
+    uint64_t last = std::min<uint64_t>(first + BATTLE_GAMES_PER_STREAM, game_count);
+    BattleResult& result = results[stream];
+    for(uint64_t game = first; game < last; game++) {
+      int winner = playGame(matchup, &rng, &result.turns);
+      result.games++;
+      if(winner == 0)
+        result.wins++;
+      else if(winner == 1)
+        result.losses++;
+      else
+        result.draws++;
+    }
+  }, thread_count_);
+
+  // add up in stream order
+  for(const BattleResult& result : results) {
+    total += result;
+  }
+  return total;
+}
+
+void BattleSimulator::prepare(const BattleTeam & team, const BattleTeam & opponents, Matchup * matchup) const {
+  assert(team.members.size() == team.movesets.size());
+  assert(opponents.members.size() == opponents.movesets.size());
+  const BattleTeam* sides[2] = {&team, &opponents};
+  for(int side = 0; side < 2; side++) {
+    matchup->sizes[side] = (int)std::min<size_t>(sides[side]->members.size(), BATTLE_TEAM_SIZE);
+  }
+
+  for(int side = 0; side < 2; side++) {
+    const BattleTeam& own = *sides[side];
+    const BattleTeam& other = *sides[1 - side];
+    for(int i = 0; i < matchup->sizes[side]; i++) {
+      PreparedMember& member = matchup->members[side][i];
+      const Moveset& moveset = own.movesets[i];
+      member.stats = own.members[i].stats;
+      member.level = own.members[i].level;
+      member.move_count = std::min(moveset.count, MOVESET_SIZE);
+      for(int slot = 0; slot < member.move_count; slot++) {
+        member.moves[slot] = prepareMove(own.members[i], moveset.moves[slot]);
+
+        // type multiplier on each foe
+        Type type = move_library_->get(moveset.moves[slot]).elemental_type_;
+        for(int j = 0; j < matchup->sizes[1 - side]; j++) {
+          TypeEffectiveness effectiveness = chart_->getTypeEffectivenessXonY(TypesHad(type), other.members[j].type);
+          int up, down;
+          DamageCalculator::getEffectivenessShifts(effectiveness, &up, &down);
+          member.immune[slot][j] = effectiveness == kZeroTimes;
+          member.shift_up[slot][j] = (int8_t)up;
+          member.shift_down[slot][j] = (int8_t)down;
+        }
+      }
+    }
+  }
+}
+
+BattleSimulator::PreparedMove BattleSimulator::prepareMove(const Combatant & user, const MoveId move_id) const {
+  const Move& move = move_library_->get(move_id);
+  MoveFlags flags = move_library_->getFlags(move_id);
+  PreparedMove prepared;
+  prepared.damaging = (flags & kMoveDamaging) != 0;
+  prepared.physical = move.move_type_ == kPhysical;
+  prepared.targets_foe = (flags & kMoveTargetsFoe) != 0;
+  prepared.power = std::max(move.power_, 0);
+  prepared.accuracy = move.accuracy_;
+  prepared.pp = std::max(move.pp_, 1);
+  bool stab = move.elemental_type_ == user.type.first_type_
+    || (user.type.b_dual_type_ && move.elemental_type_ == user.type.second_type_);
+  prepared.stab_numerator = stab ? 3 : 2;
+  const MonsterStats* modifiers[2] = {&move.stat_modifiers_self_, &move.stat_modifiers_target_};
+  int8_t* stages[2] = {prepared.self_stages, prepared.target_stages};
+  for(int i = 0; i < 2; i++) {
+    stages[i][BATTLE_ATTACK] = (int8_t)modifiers[i]->attack_;
+    stages[i][BATTLE_DEFENSE] = (int8_t)modifiers[i]->defense_;
+    stages[i][BATTLE_SPECIAL_ATTACK] = (int8_t)modifiers[i]->special_attack_;
+    stages[i][BATTLE_SPECIAL_DEFENSE] = (int8_t)modifiers[i]->special_defense_;
+    stages[i][BATTLE_SPEED] = (int8_t)modifiers[i]->speed_;
+  }
+  return prepared;
+}
+
+int BattleSimulator::playGame(const Matchup & matchup, std::mt19937_64 * rng, uint64_t * turns) {
+  // fresh state
+  SideState sides[2];
+  for(int side = 0; side < 2; side++) {
+    sides[side].active = 0;
+    for(int i = 0; i < matchup.sizes[side]; i++) {
+      const PreparedMember& member = matchup.members[side][i];
+      MemberState& state = sides[side].members[i];
+      state.hp = member.stats.hp_;
+      for(int slot = 0; slot < member.move_count; slot++)
+        state.pp[slot] = member.moves[slot].pp;
+      std::fill(state.stages, state.stages + BATTLE_STAGED_STATS, 0);
+    }
+  }
+
+  for(int turn = 0; turn < BATTLE_TURN_LIMIT; turn++) {
+    (*turns)++;
+    int choices[2] = {chooseMove(matchup, sides, 0), chooseMove(matchup, sides, 1)};
+
+    // faster one goes first, ties at random
+    int speeds[2];
+    for(int side = 0; side < 2; side++) {
+      const SideState& state = sides[side];
+      speeds[side] = stagedStat(matchup.members[side][state.active].stats.speed_, state.members[state.active].stages[BATTLE_SPEED]);
+    }
+    int first = speeds[0] != speeds[1] ? (speeds[0] > speeds[1] ? 0 : 1) : (int)((*rng)() & 1);
+
+    for(int order = 0; order < 2; order++) {
+      int side = order == 0 ? first : 1 - first;
+      SideState& state = sides[side];
+      if(state.members[state.active].hp <= 0)
+        continue; // fainted before moving
+      useMove(matchup, sides, side, choices[side], rng);
+    }
+
+    // send out the next member, or lose
+    for(int side = 0; side < 2; side++) {
+      SideState& state = sides[side];
+      while(state.active < matchup.sizes[side] && state.members[state.active].hp <= 0)
+        state.active++;
+    }
+    bool out[2] = {sides[0].active == matchup.sizes[0], sides[1].active == matchup.sizes[1]};
+    if(out[0] || out[1]) {
+      return out[0] && out[1] ? -1 : (out[1] ? 0 : 1);
+    }
+  }
+  return -1;
+}
+
+int BattleSimulator::chooseMove(const Matchup & matchup, const SideState sides[2], const int side) {
+  const SideState& own = sides[side];
+  const SideState& other = sides[1 - side];
+  const PreparedMember& user = matchup.members[side][own.active];
+  const PreparedMember& foe = matchup.members[1 - side][other.active];
+  const MemberState& user_state = own.members[own.active];
+  const MemberState& foe_state = other.members[other.active];
+
+  int best = -1;
+  double best_value = -1.0;
+  for(int slot = 0; slot < user.move_count; slot++) {
+    if(user_state.pp[slot] <= 0)
+      continue;
+    const PreparedMove& move = user.moves[slot];
+    double value = 0.0;
+    if(move.damaging && !user.immune[slot][other.active]) {
+      int attack_stage = move.physical ? BATTLE_ATTACK : BATTLE_SPECIAL_ATTACK;
+      int defense_stage = move.physical ? BATTLE_DEFENSE : BATTLE_SPECIAL_DEFENSE;
+      int attack = stagedStat(move.physical ? user.stats.attack_ : user.stats.special_attack_, user_state.stages[attack_stage]);
+      int defense = stagedStat(move.physical ? foe.stats.defense_ : foe.stats.special_defense_, foe_state.stages[defense_stage]);
+      double damage = DamageCalculator::baseDamage(user.level, move.power, attack, defense) * move.stab_numerator / 2.0;
+      damage = std::ldexp(damage, user.shift_up[slot][other.active] - user.shift_down[slot][other.active]);
+      value = damage * (move.accuracy < 0 ? 1.0 : move.accuracy / 100.0);
+    }
+    if(value > best_value) {
+      best = slot;
+      best_value = value;
+    }
+  }
+  return best;
+}
+
+void BattleSimulator::useMove(const Matchup & matchup, SideState sides[2], const int side, const int slot, std::mt19937_64 * rng) {
+  SideState& own = sides[side];
+  SideState& other = sides[1 - side];
+  const PreparedMember& user = matchup.members[side][own.active];
+  const PreparedMember& foe = matchup.members[1 - side][other.active];
+  MemberState& user_state = own.members[own.active];
+  MemberState& foe_state = other.members[other.active];
+  int roll = (int)((*rng)() % DAMAGE_ROLLS);
+
+  // out of pp
+  if(slot < 0) {
+    int defense = stagedStat(foe.stats.defense_, foe_state.stages[BATTLE_DEFENSE]);
+    int attack = stagedStat(user.stats.attack_, user_state.stages[BATTLE_ATTACK]);
+    int base_damage = DamageCalculator::baseDamage(user.level, BATTLE_STRUGGLE_POWER, attack, defense);
+    foe_state.hp -= DamageCalculator::rollOnce(base_damage, 2, 0, 0, roll);
+    return;
+  }
+
+  const PreparedMove& move = user.moves[slot];
+  user_state.pp[slot]--;
+
+  // miss
+  if(move.targets_foe && move.accuracy >= 0 && (int)((*rng)() % 100) >= move.accuracy) {
+    return;
+  }
+
+  // damage
+  if(move.damaging && !user.immune[slot][other.active]) {
+    int attack_stage = move.physical ? BATTLE_ATTACK : BATTLE_SPECIAL_ATTACK;
+    int defense_stage = move.physical ? BATTLE_DEFENSE : BATTLE_SPECIAL_DEFENSE;
+    int attack = stagedStat(move.physical ? user.stats.attack_ : user.stats.special_attack_, user_state.stages[attack_stage]);
+    int defense = stagedStat(move.physical ? foe.stats.defense_ : foe.stats.special_defense_, foe_state.stages[defense_stage]);
+    int base_damage = DamageCalculator::baseDamage(user.level, move.power, attack, defense);
+    foe_state.hp -= DamageCalculator::rollOnce(base_damage, move.stab_numerator,
+      user.shift_up[slot][other.active], user.shift_down[slot][other.active], roll);
+  }
+
+  // stat changes
+  for(int i = 0; i < BATTLE_STAGED_STATS; i++) {
+    int self_stage = user_state.stages[i] + move.self_stages[i];
+    user_state.stages[i] = (int8_t)std::max(-BATTLE_MAX_STAGE, std::min(self_stage, BATTLE_MAX_STAGE));
+    if(move.targets_foe) {
+      int target_stage = foe_state.stages[i] + move.target_stages[i];
+      foe_state.stages[i] = (int8_t)std::max(-BATTLE_MAX_STAGE, std::min(target_stage, BATTLE_MAX_STAGE));
+    }
+  }
+}
+
+int BattleSimulator::stagedStat(const int stat, const int stage) {
+  return stage >= 0 ? stat * (2 + stage) / 2 : stat * 2 / (2 - stage);
+}
+
+} // namespace pokeman
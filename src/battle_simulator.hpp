@@ -0,0 +1,148 @@
+/*
+* battle_simulator.hpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*
+* Plays out many random singles battles between two teams to estimate
+* how often one of them wins.
+*/
+#ifndef POKEMAN_BATTLE_SIMULATOR_HPP_
+#define POKEMAN_BATTLE_SIMULATOR_HPP_
+
+#include <cstdint>
+
+#include <random>
+#include <vector>
+
+#include "damage_calculator.hpp"
+#include "moveset_optimizer.hpp"
+#include "pokeman.hpp"
+
+#define BATTLE_TEAM_SIZE 6
+#define BATTLE_TURN_LIMIT 500
+
+/// Most games one simulation will play, whatever is asked for.
+#define BATTLE_MAX_GAMES 10000000
+
+/// Games played from one random stream. Streams are seeded by index, so
+/// results don't depend on how many threads there are.
+#define BATTLE_GAMES_PER_STREAM 1024
+
+/// Stats that stat changes act on: attack, defense, special attack,
+/// special defense and speed.
+#define BATTLE_STAGED_STATS 5
+#define BATTLE_MAX_STAGE 6
+
+namespace pokeman {
+
+/// One side of a battle, in the order they are sent out.
+struct BattleTeam {
+  std::vector<Combatant> members;
+
+  /// Moves of each member, lined up with members.
+  std::vector<Moveset> movesets;
+
+  /// Adds a member that uses a moveset.
+  void add(const Combatant& member, const Moveset& moveset);
+};
+
+/// Tally of a simulation, from the first team's side.
+struct BattleResult {
+  uint64_t games;
+  uint64_t wins;
+  uint64_t losses;
+  uint64_t draws;
+  uint64_t turns;
+
+  BattleResult();
+
+  /// Share of games won, with draws as half a win.
+  double winRate() const;
+
+  /// 95% Wilson score interval of the win rate.
+  void confidenceInterval(double* low, double* high) const;
+
+  BattleResult& operator+=(const BattleResult& that);
+};
+
+class BattleSimulator {
+public:
+  const MoveLibrary* move_library_;
+  const TypeChart* chart_;
+
+  /// Worker threads; 0 uses every core.
+  unsigned int thread_count_;
+
+private:
+  /// A move with everything the battle needs copied out of the library.
+  struct PreparedMove {
+    bool damaging;
+    bool physical;
+    bool targets_foe;
+    int power;
+    int accuracy;
+    int pp;
+    int stab_numerator;
+    int8_t self_stages[BATTLE_STAGED_STATS];
+    int8_t target_stages[BATTLE_STAGED_STATS];
+  };
+
+  /// A member with its moves, and the type multiplier of each of its
+  /// moves on each member of the other side.
+  struct PreparedMember {
+    MonsterStats stats;
+    int level;
+    int move_count;
+    PreparedMove moves[MOVESET_SIZE];
+    bool immune[MOVESET_SIZE][BATTLE_TEAM_SIZE];
+    int8_t shift_up[MOVESET_SIZE][BATTLE_TEAM_SIZE];
+    int8_t shift_down[MOVESET_SIZE][BATTLE_TEAM_SIZE];
+  };
+
+  /// Both sides, ready to be played any number of times.
+  struct Matchup {
+    PreparedMember members[2][BATTLE_TEAM_SIZE];
+    int sizes[2];
+  };
+
+  /// Changing state of a member. Fixed size, so a battle allocates nothing.
+  struct MemberState {
+    int hp;
+    int pp[MOVESET_SIZE];
+    int8_t stages[BATTLE_STAGED_STATS];
+  };
+
+  struct SideState {
+    MemberState members[BATTLE_TEAM_SIZE];
+    int active;
+  };
+
+public:
+  BattleSimulator();
+
+  /// Plays games between the teams, up to BATTLE_MAX_GAMES. The same seed
+  /// gives the same result.
+  BattleResult simulate(const BattleTeam& team, const BattleTeam& opponents, const uint64_t games, const uint64_t seed) const;
+
+private:
+  void prepare(const BattleTeam& team, const BattleTeam& opponents, Matchup* matchup) const;
+
+  PreparedMove prepareMove(const Combatant& user, const MoveId move_id) const;
+
+  /// Plays one game. Returns 0 if the first side wins, 1 if the second
+  /// does and -1 for a draw.
+  static int playGame(const Matchup& matchup, std::mt19937_64* rng, uint64_t* turns);
+
+  /// Picks the usable move with the most expected damage, or -1 to struggle.
+  static int chooseMove(const Matchup& matchup, const SideState sides[2], const int side);
+
+  static void useMove(const Matchup& matchup, SideState sides[2], const int side, const int slot, std::mt19937_64* rng);
+
+  /// Stat with its stage applied.
+  static int stagedStat(const int stat, const int stage);
+};
+
+} // namespace pokeman
+
+#endif //POKEMAN_BATTLE_SIMULATOR_HPP_
@@ -0,0 +1,49 @@
+/*
+* compile_database.cpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*/
+#include "compile_database.hpp"
+
+#include <iostream>
+
+#include "pmdb.hpp"
+#include "resources.hpp"
+
+namespace pokeman {
+namespace driver {
+int compile_database(int argc, const char* argv[]) {
+  resources::Loader loader(FILEPATH_CONFIG);
+  if(loader.errorOccured()) {
+    std::cerr << "Couldn't load config; Exiting now" << std::endl;
+    return 1;
+  }
+
+  // always from the sources, never from an older database
+  resources::PokemanDatabase data;
+  if(!data.loadSources(loader)) {
+    std::cerr << "Couldn't load database; Exiting now" << std::endl;
+    return 1;
+  }
+
+  // where to write: argument, or the configured path
+  std::string filepath;
+  if(argc > 2) {
+    filepath = argv[2];
+  } else if(!loader.getFilepath(resources::LoaderTool::kCompiledDatabase, &filepath)) {
+    std::cerr << "No '" << resources::LoaderTool::toString(resources::LoaderTool::kCompiledDatabase)
+      << "' path is configured; pass one" << std::endl;
+    return 2;
+  }
+
+  if(!resources::writePmdb(data, resources::getPmdbSourceStamp(loader), filepath)) {
+    std::cerr << "Couldn't write " << filepath << std::endl;
+    return 3;
+  }
+  std::cout << "Compiled " << data.getMoves().size() << " moves, " << data.getSpecies().getAll().size()
+    << " species and " << data.getTeam().size() << " team members into " << filepath << std::endl;
+  return 0;
+}
+} // namespace driver
+} // namespace pokeman
@@ -0,0 +1,19 @@
+/*
+* compile_database.hpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*
+* Driver that compiles the yaml data into a database that loads quickly.
+*/
+#ifndef POKEMAN_COMPILE_DATABASE_HPP_
+#define POKEMAN_COMPILE_DATABASE_HPP_
+#include "pokeman.hpp"
+
+namespace pokeman {
+namespace driver {
+int compile_database(int argc, const char* argv[]);
+} // namespace driver
+} // namespace pokeman
+
+#endif //POKEMAN_COMPILE_DATABASE_HPP_
@@ -0,0 +1,169 @@
+/*
+* damage_calculator.cpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*/
+#include "damage_calculator.hpp"
+
+#include <cassert>
+
+#include <algorithm>
+
+namespace pokeman {
+
+MonsterStats calculateStats(const MonsterStats & base_stats, const int level) {
+  MonsterStats stats;
+  stats.hp_ = (2 * base_stats.hp_ + DAMAGE_DEFAULT_IV) * level / 100 + level + 10;
+  stats.attack_ = (2 * base_stats.attack_ + DAMAGE_DEFAULT_IV) * level / 100 + 5;
+  stats.defense_ = (2 * base_stats.defense_ + DAMAGE_DEFAULT_IV) * level / 100 + 5;
+  stats.special_attack_ = (2 * base_stats.special_attack_ + DAMAGE_DEFAULT_IV) * level / 100 + 5;
+  stats.special_defense_ = (2 * base_stats.special_defense_ + DAMAGE_DEFAULT_IV) * level / 100 + 5;
+  stats.speed_ = (2 * base_stats.speed_ + DAMAGE_DEFAULT_IV) * level / 100 + 5;
+  return stats;
+}
+
+Combatant::Combatant(const MonsterSpecies & species, const int level) : type(species.type_),
+  stats(calculateStats(species.base_stats_, level)), level(level) {}
+
+Combatant::Combatant(const Monster & monster) : Combatant(*monster.species_, monster.level_) {}
+
+double DamageRange::expectedFraction() const {
+  if(target_hp <= 0) {
+    return 0.0;
+  }
+  return std::min(expected / target_hp, 1.0);
+}
+
+DamageCalculator::DamageCalculator() : move_library_(nullptr), chart_(nullptr) {}
+
+DamageRange DamageCalculator::calculate(const Combatant & attacker, const MoveId move_id, const Combatant & defender) const {
+  assert(move_library_ != nullptr);
+  assert(chart_ != nullptr);
+  MoveFactors factors = getMoveFactors(attacker, move_id);
+  TypeEffectiveness effectiveness = factors.type >= 0 && factors.type < kNullType
+    ? chart_->getTypeEffectivenessXonY(TypesHad(factors.type), defender.type) : kOneTimes;
+  return calculateWith(attacker, factors, defender, effectiveness);
+}
+
+DamageRange DamageCalculator::calculate(const Combatant & attacker, const MoveId move_id, const Combatant & defender,
+  const TypeEffectiveness effectiveness) const {
+  assert(move_library_ != nullptr);
+  return calculateWith(attacker, getMoveFactors(attacker, move_id), defender, effectiveness);
+}
+
+std::vector<DamageRange> DamageCalculator::calculateMatrix(const Combatant & attacker, const std::vector<MoveId>& moves,
+  const std::vector<Combatant>& targets) const {
+  assert(move_library_ != nullptr);
+  assert(chart_ != nullptr);
+
+  // look up everything that only depends on one side
+  std::vector<MoveFactors> factors;
+  factors.reserve(moves.size());
+  for(MoveId move_id : moves) {
+    factors.push_back(getMoveFactors(attacker, move_id));
+  }
+  std::vector<TypeEffectiveness> defending(targets.size() * kNullType);
+  for(size_t j = 0; j < targets.size(); j++) {
+    for(int type = 0; type < kNullType; type++) {
+      defending[j * kNullType + type] = chart_->getTypeEffectivenessXonY(TypesHad((Type)type), targets[j].type);
+    }
+  }
+
+  // fill the matrix; a move without a type hits everything neutrally
+  std::vector<DamageRange> matrix;
+  matrix.reserve(moves.size() * targets.size());
+  for(const MoveFactors& move_factors : factors) {
+    const bool typed = move_factors.type >= 0 && move_factors.type < kNullType;
+    for(size_t j = 0; j < targets.size(); j++) {
+      TypeEffectiveness effectiveness = typed ? defending[j * kNullType + move_factors.type] : kOneTimes;
+      matrix.push_back(calculateWith(attacker, move_factors, targets[j], effectiveness));
+    }
+  }
+  return matrix;
+}
+
+std::vector<double> DamageCalculator::rateAgainstRoster(const Combatant & attacker, const std::vector<MoveId>& moves,
+  const std::vector<Combatant>& targets) const {
+  std::vector<double> ratings(moves.size(), 0.0);
+  if(targets.empty()) {
+    return ratings;
+  }
+  std::vector<DamageRange> matrix = calculateMatrix(attacker, moves, targets);
+  for(size_t i = 0; i < moves.size(); i++) {
+    double total = 0.0;
+    for(size_t j = 0; j < targets.size(); j++) {
+      total += matrix[i * targets.size() + j].expectedFraction();
+    }
+    ratings[i] = total / targets.size();
+  }
+  return ratings;
+}
+
+int DamageCalculator::baseDamage(const int level, const int power, const int attack, const int defense) {
+  return (2 * level / 5 + 2) * power * attack / std::max(defense, 1) / 50 + 2;
+}
+
+void DamageCalculator::getEffectivenessShifts(const TypeEffectiveness effectiveness, int * up, int * down) {
+  *up = *down = 0;
+  switch(effectiveness) {
+  case kQuarterTimes: *down = 2; break;
+  case kHalfTimes: *down = 1; break;
+  case kTwoTimes: *up = 1; break;
+  case kFourTimes: *up = 2; break;
+  default: break;
+  }
+}
+
+void DamageCalculator::rollDamage(const int base_damage, const int stab_numerator, const int effectiveness_up,
+  const int effectiveness_down, int out[DAMAGE_ROLLS]) {
+  for(int i = 0; i < DAMAGE_ROLLS; i++) {
+    out[i] = rollOnce(base_damage, stab_numerator, effectiveness_up, effectiveness_down, i);
+  }
+}
+
+DamageCalculator::MoveFactors DamageCalculator::getMoveFactors(const Combatant & attacker, const MoveId move_id) const {
+  const Move& move = move_library_->get(move_id);
+  MoveFactors factors;
+  factors.damaging = move.move_type_ != kStatus && move.power_ > 0;
+  factors.physical = move.move_type_ == kPhysical;
+  factors.power = move.power_;
+  factors.type = move.elemental_type_;
+  bool stab = move.elemental_type_ == attacker.type.first_type_
+    || (attacker.type.b_dual_type_ && move.elemental_type_ == attacker.type.second_type_);
+  factors.stab_numerator = stab ? 3 : 2;
+  factors.accuracy = move.accuracy_ < 0 ? 1.0 : (double)move.accuracy_ / 100;
+  return factors;
+}
+
+DamageRange DamageCalculator::calculateWith(const Combatant & attacker, const MoveFactors & factors, const Combatant & defender,
+  const TypeEffectiveness effectiveness) const {
+  DamageRange range;
+  range.min = range.max = 0;
+  range.expected = 0.0;
+  range.target_hp = defender.stats.hp_;
+  if(!factors.damaging || effectiveness == kZeroTimes || effectiveness == kNullTimes) {
+    return range;
+  }
+
+  // damage before the roll
+  int attack = factors.physical ? attacker.stats.attack_ : attacker.stats.special_attack_;
+  int defense = factors.physical ? defender.stats.defense_ : defender.stats.special_defense_;
+  int base_damage = baseDamage(attacker.level, factors.power, attack, defense);
+  int up, down;
+  getEffectivenessShifts(effectiveness, &up, &down);
+
+  // roll
+  int rolls[DAMAGE_ROLLS];
+  rollDamage(base_damage, factors.stab_numerator, up, down, rolls);
+  int total = 0;
+  for(int i = 0; i < DAMAGE_ROLLS; i++) {
+    total += rolls[i];
+  }
+  range.min = rolls[0];
+  range.max = rolls[DAMAGE_ROLLS - 1];
+  range.expected = factors.accuracy * total / DAMAGE_ROLLS;
+  return range;
+}
+
+} // namespace pokeman
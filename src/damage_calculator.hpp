@@ -0,0 +1,127 @@
+/*
+* damage_calculator.hpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*
+* Works out how much damage moves do, from stats, level, STAB and typing.
+*/
+#ifndef POKEMAN_DAMAGE_CALCULATOR_HPP_
+#define POKEMAN_DAMAGE_CALCULATOR_HPP_
+
+#include <vector>
+
+#include "pokeman.hpp"
+
+/// Number of random damage rolls, from 85% to 100%.
+#define DAMAGE_ROLLS 16
+#define DAMAGE_LOWEST_ROLL 85
+
+/// Individual value assumed for every stat.
+#define DAMAGE_DEFAULT_IV 31
+
+namespace pokeman {
+
+/// Stats of a monster at a level, with neutral nature and no effort values.
+MonsterStats calculateStats(const MonsterStats& base_stats, const int level);
+
+/// A monster as the damage calculator sees it.
+struct Combatant {
+  TypesHad type;
+  MonsterStats stats;
+  int level;
+
+  /// Builds from a species at a level.
+  Combatant(const MonsterSpecies& species, const int level);
+
+  /// Builds from a team member.
+  explicit Combatant(const Monster& monster);
+};
+
+/// Damage of one move on one target, over every roll.
+struct DamageRange {
+  /// lowest and highest roll
+  int min;
+  int max;
+
+  /// mean of the rolls, times the chance to hit
+  double expected;
+
+  /// hp of the target, for turning damage into a fraction
+  int target_hp;
+
+  /// Expected damage as a share of the target's hp, capped at 1.
+  double expectedFraction() const;
+};
+
+class DamageCalculator {
+public:
+  const MoveLibrary* move_library_;
+  const TypeChart* chart_;
+
+public:
+  DamageCalculator();
+
+  /// Damage of a move from attacker onto defender.
+  DamageRange calculate(const Combatant& attacker, const MoveId move_id, const Combatant& defender) const;
+
+  /// Same, with the move's effectiveness on the defender already looked up.
+  DamageRange calculate(const Combatant& attacker, const MoveId move_id, const Combatant& defender,
+    const TypeEffectiveness effectiveness) const;
+
+  /// Damage of every move onto every target, row by row with a row per move.
+  std::vector<DamageRange> calculateMatrix(const Combatant& attacker, const std::vector<MoveId>& moves,
+    const std::vector<Combatant>& targets) const;
+
+  /// Expected share of hp each move takes off, averaged over the targets.
+  /// Status moves rate 0.
+  std::vector<double> rateAgainstRoster(const Combatant& attacker, const std::vector<MoveId>& moves,
+    const std::vector<Combatant>& targets) const;
+
+  /// Damage before the roll and multipliers.
+  static int baseDamage(const int level, const int power, const int attack, const int defense);
+
+  /// Type multiplier as shifts up and down. Immunity isn't a shift, so check for it first.
+  static void getEffectivenessShifts(const TypeEffectiveness effectiveness, int* up, int* down);
+
+  /// Damage of roll number roll, from 0 (85%) to DAMAGE_ROLLS - 1 (100%).
+  /// stab_numerator is 3 for STAB and 2 without, and the effectiveness
+  /// shifts are the base 2 exponents of the type multiplier.
+  static int rollOnce(const int base_damage, const int stab_numerator, const int effectiveness_up,
+    const int effectiveness_down, const int roll);
+
+  /// Fills out with the damage of each roll.
+  static void rollDamage(const int base_damage, const int stab_numerator, const int effectiveness_up,
+    const int effectiveness_down, int out[DAMAGE_ROLLS]);
+
+private:
+  /// Per move values that don't depend on the target.
+  struct MoveFactors {
+    bool damaging;
+    bool physical;
+    int power;
+    int stab_numerator;
+    double accuracy;
+    Type type;
+  };
+
+  MoveFactors getMoveFactors(const Combatant& attacker, const MoveId move_id) const;
+
+  /// Attacking and defending stat, hp and type multiplier for one pairing.
+  DamageRange calculateWith(const Combatant& attacker, const MoveFactors& factors, const Combatant& defender,
+    const TypeEffectiveness effectiveness) const;
+};
+
+/// Same integer steps for every roll, with no branches, so that a loop
+/// over the rolls can be vectorized.
+inline int DamageCalculator::rollOnce(const int base_damage, const int stab_numerator, const int effectiveness_up,
+  const int effectiveness_down, const int roll) {
+  int damage = base_damage * (DAMAGE_LOWEST_ROLL + roll) / 100;
+  damage = damage * stab_numerator / 2;
+  damage = (damage << effectiveness_up) >> effectiveness_down;
+  return damage > 1 ? damage : 1;
+}
+
+} // namespace pokeman
+
+#endif //POKEMAN_DAMAGE_CALCULATOR_HPP_
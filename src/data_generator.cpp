@@ -0,0 +1,242 @@
+/*
+* data_generator.cpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*/
+#include "data_generator.hpp"
+
+#include <cstdlib>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "pmdb.hpp"
+#include "resources.hpp"
+
+namespace pokeman {
+
+static const char* const kSyllables[] = {
+  "ba", "ko", "ri", "zu", "me", "ta", "lo", "shi", "ga", "ne", "vo", "pi", "du", "ra", "ke", "mo"
+};
+static const int kSyllableCount = sizeof(kSyllables) / sizeof(kSyllables[0]);
+
+static const char* const kMoveWords[] = {
+  "Punch", "Beam", "Slash", "Wave", "Fang", "Storm", "Kick", "Pulse", "Dance", "Guard"
+};
+static const int kMoveWordCount = sizeof(kMoveWords) / sizeof(kMoveWords[0]);
+
+DataGenerator::DataGenerator() : species_count_(GEN_DATA_DEFAULT_SPECIES), move_count_(GEN_DATA_DEFAULT_MOVES),
+  team_count_(GEN_DATA_DEFAULT_TEAM), seed_(GEN_DATA_DEFAULT_SEED) {}
+
+bool DataGenerator::write(const std::string & directory) {
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+  rng_.seed(seed_);
+  learnsets_.assign((size_t)species_count_, std::vector<int>());
+
+  // moves first, since species learn them and the team keeps them
+  const std::string prefix = directory + "/";
+  std::ofstream moves(prefix + "moves.yml");
+  writeMoves(moves);
+  std::ofstream species(prefix + "species.yml");
+  writeSpecies(species);
+  std::ofstream team(prefix + "team.yml");
+  writeTeam(team);
+  std::ofstream config(prefix + "config.yml");
+  config << "---\n"
+    << "moves: " << prefix << "moves.yml\n"
+    << "species: " << prefix << "species.yml\n"
+    << "team: " << prefix << "team.yml\n"
+    << "ratings: " << prefix << "ratings.cache\n"
+    << "movesets: " << prefix << "movesets.csv\n"
+    << "database: " << prefix << "pokeman.pmdb\n";
+  return moves.good() && species.good() && team.good() && config.good();
+}
+
+std::string DataGenerator::makeName(int index) {
+  // at least two syllables, and a different string for every index
+  std::string name;
+  for(index += kSyllableCount; index > 0; index /= kSyllableCount) {
+    name.insert(0, kSyllables[index % kSyllableCount]);
+  }
+  name[0] = (char)(name[0] - 'a' + 'A');
+  return name;
+}
+
+int DataGenerator::pick(const int low, const int high) {
+  return low + (int)(rng_() % (uint64_t)(high - low + 1));
+}
+
+void DataGenerator::writeMoves(std::ostream & out) {
+  out << "---\n";
+  for(int i = 0; i < move_count_; i++) {
+    Type type = (Type)pick(0, kFairy - 1); // the gen 5 chart has no fairy
+    bool status = pick(0, 4) == 0;
+    out << "-\n"
+      << "  name: " << makeName(i) << " " << kMoveWords[i % kMoveWordCount] << "\n"
+      << "  number: " << (i + 1) << "\n"
+      << "  type: " << resources::getTypeName(type) << "\n"
+      << "  category: " << resources::getMoveTypeName(status ? kStatus : pick(0, 1) == 0 ? kPhysical : kSpecial) << "\n"
+      << "  pp: " << 5 * pick(1, 8) << "\n";
+    if(status) {
+      // raises one of the user's stats
+      static const char* const kStats[] = {"attack", "defense", "spatk", "spdef", "speed"};
+      out << "  target: " << resources::getMoveTargetName(kSelf) << "\n"
+        << "  status:\n"
+        << "    target:\n"
+        << "      " << kStats[pick(0, 4)] << ": " << pick(1, 2) << "\n";
+    } else {
+      MoveTargetDescription target = pick(0, 9) == 0 ? kAllAdjacentFoes : kAnyAdjacentFoe;
+      out << "  target: " << resources::getMoveTargetName(target) << "\n"
+        << "  power: " << 5 * pick(8, 24) << "\n"
+        << "  accuracy: " << (pick(0, 3) == 0 ? 5 * pick(14, 19) : 100) << "\n";
+    }
+  }
+}
+
+void DataGenerator::writeSpecies(std::ostream & out) {
+  static const char* const kStats[] = {"hp", "attack", "defense", "spatk", "spdef", "speed"};
+  out << "---\n";
+  for(int i = 0; i < species_count_; i++) {
+    std::vector<int>& learnset = learnsets_[i];
+    out << "-\n"
+      << "  name: " << makeName(i) << "\n"
+      << "  number: " << (i + 1) << "\n"
+      << "  types:\n";
+    int first_type = pick(0, kFairy - 1);
+    out << "    - " << resources::getTypeName((Type)first_type) << "\n";
+    if(pick(0, 1) == 0) {
+      int second_type = (first_type + pick(1, kFairy - 1)) % kFairy; // never the first
+      out << "    - " << resources::getTypeName((Type)second_type) << "\n";
+    }
+    out << "  basestats:\n";
+    for(const char* stat : kStats) {
+      out << "    " << stat << ": " << pick(30, 150) << "\n";
+    }
+    if(move_count_ == 0)
+      continue;
+
+    // distinct moves for each way of learning
+    auto pickMoves = [this, &learnset](const int count) {
+      std::vector<int> moves;
+      while((int)moves.size() < std::min(count, move_count_)) {
+        int move = pick(0, move_count_ - 1);
+        if(std::find(moves.begin(), moves.end(), move) == moves.end())
+          moves.push_back(move);
+      }
+      learnset.insert(learnset.end(), moves.begin(), moves.end());
+      return moves;
+    };
+    out << "  learnset:\n"
+      << "    leveling:\n";
+    std::vector<int> level_up = pickMoves(pick(GEN_DATA_MIN_LEVEL_UP, GEN_DATA_MAX_LEVEL_UP));
+    for(size_t j = 0; j < level_up.size(); j++) {
+      int level = j == 0 ? 1 : (int)(j * POKEMAN_MAX_LEVEL / level_up.size());
+      out << "      - name: " << makeName(level_up[j]) << " " << kMoveWords[level_up[j] % kMoveWordCount] << "\n"
+        << "        level: " << level << "\n";
+    }
+    std::vector<int> machine = pickMoves(pick(0, GEN_DATA_MAX_MACHINE));
+    if(!machine.empty()) {
+      out << "    machine:\n";
+      for(int move : machine) {
+        out << "      - " << makeName(move) << " " << kMoveWords[move % kMoveWordCount] << "\n";
+      }
+    }
+    std::vector<int> tutor = pickMoves(pick(0, GEN_DATA_MAX_TUTOR));
+    if(!tutor.empty()) {
+      out << "    tutoring:\n";
+      for(int move : tutor) {
+        out << "      - " << makeName(move) << " " << kMoveWords[move % kMoveWordCount] << "\n";
+      }
+    }
+  }
+}
+
+void DataGenerator::writeTeam(std::ostream & out) {
+  out << "---\n";
+  if(species_count_ == 0)
+    return;
+  for(int i = 0; i < team_count_; i++) {
+    int species = pick(0, species_count_ - 1);
+    out << "-\n"
+      << "  name: " << makeName(i) << " the " << makeName(species) << "\n"
+      << "  species: " << makeName(species) << "\n"
+      << "  level: " << pick(5, POKEMAN_MAX_LEVEL) << "\n";
+
+    // a couple of moves it can learn
+    const std::vector<int>& learnset = learnsets_[species];
+    int kept = learnset.empty() ? 0 : pick(0, 2);
+    if(kept > 0)
+      out << "  moves:\n";
+    for(int j = 0; j < kept; j++) {
+      int move = learnset[pick(0, (int)learnset.size() - 1)];
+      out << "    - " << makeName(move) << " " << kMoveWords[move % kMoveWordCount] << "\n";
+    }
+  }
+}
+
+namespace driver {
+int generate_data(int argc, const char* argv[]) {
+  if(argc < 3) {
+    std::cerr << "usage: gen-data <directory> [species] [moves] [team] [seed]" << std::endl;
+    return 1;
+  }
+  DataGenerator generator;
+  const std::string directory = argv[2];
+  if(argc > 3)
+    generator.species_count_ = std::atoi(argv[3]);
+  if(argc > 4)
+    generator.move_count_ = std::atoi(argv[4]);
+  if(argc > 5)
+    generator.team_count_ = std::atoi(argv[5]);
+  if(argc > 6)
+    generator.seed_ = std::strtoull(argv[6], nullptr, 10);
+  if(generator.species_count_ < 0 || generator.move_count_ < 0 || generator.team_count_ < 0) {
+    std::cerr << "counts can't be negative" << std::endl;
+    return 1;
+  }
+
+  if(!generator.write(directory)) {
+    std::cerr << "Couldn't write data into " << directory << std::endl;
+    return 2;
+  }
+  std::cout << "Wrote " << generator.species_count_ << " species, " << generator.move_count_ << " moves and "
+    << generator.team_count_ << " team members into " << directory << std::endl;
+
+  // load it back both ways, to see how long each takes
+  resources::Loader loader(directory + "/config.yml");
+  resources::PokemanDatabase data;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  if(loader.errorOccured() || !data.loadSources(loader)) {
+    std::cerr << "Couldn't load the data back" << std::endl;
+    return 3;
+  }
+  std::chrono::steady_clock::time_point loaded = std::chrono::steady_clock::now();
+
+  std::string filepath;
+  loader.getFilepath(resources::LoaderTool::kCompiledDatabase, &filepath);
+  uint64_t stamp = resources::getPmdbSourceStamp(loader);
+  resources::PokemanDatabase compiled;
+  std::string error;
+  if(!resources::writePmdb(data, stamp, filepath)) {
+    std::cerr << "Couldn't write " << filepath << std::endl;
+    return 4;
+  }
+  std::chrono::steady_clock::time_point written = std::chrono::steady_clock::now();
+  if(!compiled.loadCompiled(filepath, stamp, &error)) {
+    std::cerr << "Couldn't load " << filepath << ": " << error << std::endl;
+    return 4;
+  }
+  std::chrono::steady_clock::time_point reloaded = std::chrono::steady_clock::now();
+
+  typedef std::chrono::duration<double, std::milli> Milliseconds;
+  std::cout << "yaml loads in " << Milliseconds(loaded - start).count() << " ms; "
+    << filepath << " loads in " << Milliseconds(reloaded - written).count() << " ms" << std::endl;
+  return 0;
+}
+} // namespace driver
+} // namespace pokeman
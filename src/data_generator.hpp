@@ -0,0 +1,76 @@
+/*
+* data_generator.hpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*
+* Makes up large sets of species, moves and team members in the data
+* file formats, for seeing how loading and analysis hold up as data grows.
+*/
+#ifndef POKEMAN_DATA_GENERATOR_HPP_
+#define POKEMAN_DATA_GENERATOR_HPP_
+
+#include <cstdint>
+
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "pokeman.hpp"
+
+#define GEN_DATA_DEFAULT_SPECIES 10000
+#define GEN_DATA_DEFAULT_MOVES 5000
+#define GEN_DATA_DEFAULT_TEAM 100000
+#define GEN_DATA_DEFAULT_SEED 1
+
+/// Learnset sizes, about as wide as real species'.
+#define GEN_DATA_MIN_LEVEL_UP 8
+#define GEN_DATA_MAX_LEVEL_UP 24
+#define GEN_DATA_MAX_MACHINE 48
+#define GEN_DATA_MAX_TUTOR 12
+
+namespace pokeman {
+
+class DataGenerator {
+public:
+  int species_count_;
+  int move_count_;
+  int team_count_;
+  uint64_t seed_;
+
+private:
+  std::mt19937_64 rng_;
+
+  /// Moves each species can learn, by move index.
+  std::vector<std::vector<int>> learnsets_;
+
+public:
+  DataGenerator();
+
+  /// Writes moves.yml, species.yml, team.yml and a config.yml pointing at
+  /// them into a directory, creating it if needed. The same seed and
+  /// counts always write the same files. False, if a file can't be
+  /// written.
+  bool write(const std::string& directory);
+
+  /// Unique name for an index, made of syllables.
+  static std::string makeName(int index);
+
+private:
+  /// Uniform in [low, high], the same on every platform.
+  int pick(const int low, const int high);
+
+  void writeMoves(std::ostream& out);
+
+  void writeSpecies(std::ostream& out);
+
+  void writeTeam(std::ostream& out);
+};
+
+namespace driver {
+int generate_data(int argc, const char* argv[]);
+} // namespace driver
+} // namespace pokeman
+
+#endif //POKEMAN_DATA_GENERATOR_HPP_
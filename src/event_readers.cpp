@@ -0,0 +1,502 @@
+/*
+* event_readers.cpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*/
+#include "event_readers.hpp"
+
+#include <cctype>
+
+#include <string_view>
+
+namespace pokeman {
+
+DataFormat getDataFormat(const std::string & filepath) {
+  size_t dot = filepath.find_last_of('.');
+  if(dot == std::string::npos) {
+    return kYamlFormat;
+  }
+  std::string extension = filepath.substr(dot + 1);
+  for(char& c : extension) {
+    c = (char)std::tolower((unsigned char)c);
+  }
+  if(extension == "json") {
+    return kJsonFormat;
+  } else if(extension == "csv") {
+    return kCsvFormat;
+  } else {
+    return kYamlFormat;
+  }
+}
+
+BufferedInput::BufferedInput(std::istream & in) : in_(in), position_(0), end_(0) {}
+
+int BufferedInput::peek() {
+  if(position_ == end_ && !fill()) {
+    return -1;
+  }
+  return (unsigned char)buffer_[position_];
+}
+
+int BufferedInput::get() {
+  int c = peek();
+  if(c < 0) {
+    return c;
+  }
+  position_++;
+  mark_.pos++;
+  if(c == '\n') {
+    mark_.line++;
+    mark_.column = 0;
+  } else {
+    mark_.column++;
+  }
+  return c;
+}
+
+const YAML::Mark & BufferedInput::getMark() const {
+  return mark_;
+}
+
+bool BufferedInput::fill() {
+  if(!in_) {
+    return false;
+  }
+  in_.read(buffer_, EVENT_READER_BUFFER_SIZE);
+  position_ = 0;
+  end_ = (size_t)in_.gcount();
+  return end_ > 0;
+}
+
+JsonEventReader::JsonEventReader(std::istream & in) : input_(in) {}
+
+bool JsonEventReader::read(YAML::EventHandler & handler) {
+  skipSpace();
+  if(input_.peek() < 0) {
+    return fail("there is no json value");
+  }
+  handler.OnDocumentStart(input_.getMark());
+  if(!readValue(handler, 0)) {
+    return false;
+  }
+  skipSpace();
+  if(input_.peek() >= 0) {
+    return fail("text after the json value");
+  }
+  handler.OnDocumentEnd();
+  return true;
+}
+
+const std::string & JsonEventReader::getError() const {
+  return error_;
+}
+
+const YAML::Mark & JsonEventReader::getErrorMark() const {
+  return error_mark_;
+}
+
+/// Quoted strings are tagged "!" and the rest "?", as yaml-cpp does.
+bool JsonEventReader::readValue(YAML::EventHandler & handler, const int depth) {
+  skipSpace();
+  const YAML::Mark mark = input_.getMark();
+  const int c = input_.peek();
+  if(c == '{' || c == '[') {
+    if(depth >= JSON_MAX_DEPTH) {
+      return fail("nested too deep");
+    }
+    const bool object = c == '{';
+    const int close = object ? '}' : ']';
+    input_.get();
+    if(object) {
+      handler.OnMapStart(mark, "?", YAML::NullAnchor, YAML::EmitterStyle::Flow);
+    } else {
+      handler.OnSequenceStart(mark, "?", YAML::NullAnchor, YAML::EmitterStyle::Flow);
+    }
+
+    skipSpace();
+    if(input_.peek() == close) {
+      input_.get();
+    } else {
+      while(true) {
+        if(object) {
+          skipSpace();
+          const YAML::Mark key_mark = input_.getMark();
+          if(input_.peek() != '"') {
+            return fail("expected a key");
+          }
+          if(!readString()) {
+            return false;
+          }
+          handler.OnScalar(key_mark, "!", YAML::NullAnchor, scalar_);
+          skipSpace();
+          if(input_.get() != ':') {
+            return fail("expected ':'");
+          }
+        }
+        if(!readValue(handler, depth + 1)) {
+          return false;
+        }
+        skipSpace();
+        int next = input_.get();
+        if(next == close) {
+          break;
+        } else if(next != ',') {
+          return fail(object ? "expected ',' or '}'" : "expected ',' or ']'");
+        }
+      }
+    }
+
+    if(object) {
+      handler.OnMapEnd();
+    } else {
+      handler.OnSequenceEnd();
+    }
+    return true;
+  } else if(c == '"') {
+    if(!readString()) {
+      return false;
+    }
+    handler.OnScalar(mark, "!", YAML::NullAnchor, scalar_);
+    return true;
+  } else if(c == 't' || c == 'f') {
+    if(!readWord(c == 't' ? "true" : "false")) {
+      return false;
+    }
+    handler.OnScalar(mark, "?", YAML::NullAnchor, scalar_);
+    return true;
+  } else if(c == 'n') {
+    if(!readWord("null")) {
+      return false;
+    }
+    handler.OnNull(mark, YAML::NullAnchor);
+    return true;
+  } else if(c == '-' || (c >= '0' && c <= '9')) {
+    if(!readNumber()) {
+      return false;
+    }
+    handler.OnScalar(mark, "?", YAML::NullAnchor, scalar_);
+    return true;
+  } else {
+    return fail(c < 0 ? "unexpected end" : "unexpected character");
+  }
+}
+
+bool JsonEventReader::readString() {
+  input_.get(); // opening quote
+  scalar_.clear();
+  while(true) {
+    int c = input_.get();
+    if(c < 0) {
+      return fail("unterminated string");
+    } else if(c == '"') {
+      return true;
+    } else if(c < 0x20) {
+      return fail("control character in string");
+    } else if(c != '\\') {
+      scalar_.push_back((char)c);
+      continue;
+    }
+
+    // escapes
+    c = input_.get();
+    switch(c) {
+    case '"': scalar_.push_back('"'); break;
+    case '\\': scalar_.push_back('\\'); break;
+    case '/': scalar_.push_back('/'); break;
+    case 'b': scalar_.push_back('\b'); break;
+    case 'f': scalar_.push_back('\f'); break;
+    case 'n': scalar_.push_back('\n'); break;
+    case 'r': scalar_.push_back('\r'); break;
+    case 't': scalar_.push_back('\t'); break;
+    case 'u': {
+      // code point, maybe as a surrogate pair, out as utf-8
+      unsigned long code = 0;
+      for(int pair = 0; pair < 2; pair++) {
+        unsigned long unit = 0;
+        for(int i = 0; i < 4; i++) {
+          int digit = input_.get();
+          if(!std::isxdigit(digit)) {
+            return fail("bad \\u escape");
+          }
+          unit = unit * 16 + (unsigned long)(std::isdigit(digit) ? digit - '0' : std::tolower(digit) - 'a' + 10);
+        }
+        if(pair == 1) {
+          if(unit < 0xDC00 || unit > 0xDFFF) {
+            return fail("unpaired surrogate");
+          }
+          code = 0x10000 + ((code - 0xD800) << 10) + (unit - 0xDC00);
+          break;
+        }
+        code = unit;
+        if(code < 0xD800 || code > 0xDBFF) {
+          break;
+        }
+        if(input_.get() != '\\' || input_.get() != 'u') {
+          return fail("unpaired surrogate");
+        }
+      }
+      if(code < 0x80) {
+        scalar_.push_back((char)code);
+      } else if(code < 0x800) {
+        scalar_.push_back((char)(0xC0 | (code >> 6)));
+        scalar_.push_back((char)(0x80 | (code & 0x3F)));
+      } else if(code < 0x10000) {
+        scalar_.push_back((char)(0xE0 | (code >> 12)));
+        scalar_.push_back((char)(0x80 | ((code >> 6) & 0x3F)));
+        scalar_.push_back((char)(0x80 | (code & 0x3F)));
+      } else {
+        scalar_.push_back((char)(0xF0 | (code >> 18)));
+        scalar_.push_back((char)(0x80 | ((code >> 12) & 0x3F)));
+        scalar_.push_back((char)(0x80 | ((code >> 6) & 0x3F)));
+        scalar_.push_back((char)(0x80 | (code & 0x3F)));
+      }
+      break;
+    }
+    default:
+      return fail("bad escape");
+    }
+  }
+}
+
+bool JsonEventReader::readNumber() {
+  scalar_.clear();
+  while(true) {
+    int c = input_.peek();
+    if(!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')) {
+      break;
+    }
+    scalar_.push_back((char)input_.get());
+  }
+  return true;
+}
+
+bool JsonEventReader::readWord(const char * word) {
+  scalar_.clear();
+  for(const char* c = word; *c != '\0'; c++) {
+    if(input_.get() != *c) {
+      return fail("unexpected word");
+    }
+    scalar_.push_back(*c);
+  }
+  return true;
+}
+
+void JsonEventReader::skipSpace() {
+  int c = input_.peek();
+  while(c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+    input_.get();
+    c = input_.peek();
+  }
+}
+
+bool JsonEventReader::fail(const std::string & message) {
+  error_ = message;
+  error_mark_ = input_.getMark();
+  return false;
+}
+
+CsvEventReader::CsvEventReader(std::istream & in) : input_(in), cell_count_(0) {
+  root_.cell = -1;
+  root_.sequence = false;
+}
+
+bool CsvEventReader::read(YAML::EventHandler & handler) {
+  if(!readHeader()) {
+    return error_.empty() ? fail("there is no header row") : false;
+  }
+  handler.OnDocumentStart(input_.getMark());
+  handler.OnSequenceStart(input_.getMark(), "?", YAML::NullAnchor, YAML::EmitterStyle::Block);
+  while(readRow()) {
+    if(cell_count_ == 1 && cells_[0].empty()) {
+      continue; // blank line
+    }
+    emitMap(handler, root_);
+  }
+  if(!error_.empty()) {
+    return false;
+  }
+  handler.OnSequenceEnd();
+  handler.OnDocumentEnd();
+  return true;
+}
+
+const std::string & CsvEventReader::getError() const {
+  return error_;
+}
+
+const YAML::Mark & CsvEventReader::getErrorMark() const {
+  return error_mark_;
+}
+
+/// Cells keep their strings from row to row, so rows after the first
+/// rarely allocate.
+bool CsvEventReader::readRow() {
+  if(input_.peek() < 0) {
+    return false;
+  }
+  cell_count_ = 0;
+  auto nextCell = [this]() {
+    if(cell_count_ == cells_.size())
+      cells_.emplace_back();
+    cells_[cell_count_++].clear();
+  };
+  nextCell();
+
+  bool quoted = false;
+  while(true) {
+    int c = input_.get();
+    if(c < 0) {
+      if(quoted)
+        return fail("unterminated quote");
+      break;
+    }
+    std::string& cell = cells_[cell_count_ - 1];
+    if(quoted) {
+      if(c != '"') {
+        cell.push_back((char)c);
+      } else if(input_.peek() == '"') {
+        cell.push_back((char)input_.get());
+      } else {
+        quoted = false;
+      }
+    } else if(c == '"') {
+      quoted = true;
+    } else if(c == ',') {
+      nextCell();
+    } else if(c == '\n') {
+      break;
+    } else if(c == '\r') {
+      if(input_.peek() == '\n')
+        input_.get();
+      break;
+    } else {
+      cell.push_back((char)c);
+    }
+  }
+  return true;
+}
+
+bool CsvEventReader::readHeader() {
+  if(!readRow()) {
+    return false;
+  }
+  for(size_t i = 0; i < cell_count_; i++) {
+    std::string_view path = cells_[i];
+    if(path.empty())
+      continue;
+
+    // sequence and its fields
+    Column leaf;
+    leaf.cell = (int)i;
+    leaf.sequence = false;
+    size_t bracket = path.find('[');
+    if(bracket != std::string_view::npos && path.back() == ']') {
+      leaf.sequence = true;
+      std::string_view fields = path.substr(bracket + 1, path.size() - bracket - 2);
+      path = path.substr(0, bracket);
+      while(!fields.empty()) {
+        size_t colon = fields.find(':');
+        leaf.fields.emplace_back(fields.substr(0, colon));
+        fields = colon == std::string_view::npos ? std::string_view() : fields.substr(colon + 1);
+      }
+    }
+
+    // maps on the way
+    Column* parent = &root_;
+    size_t dot;
+    while((dot = path.find('.')) != std::string_view::npos) {
+      std::string_view key = path.substr(0, dot);
+      path = path.substr(dot + 1);
+      Column* child = nullptr;
+      for(Column& column : parent->children) {
+        if(column.cell < 0 && column.key == key)
+          child = &column;
+      }
+      if(child == nullptr) {
+        Column map;
+        map.key = std::string(key);
+        map.cell = -1;
+        map.sequence = false;
+        parent->children.push_back(map);
+        child = &parent->children.back();
+      }
+      parent = child;
+    }
+    leaf.key = std::string(path);
+    parent->children.push_back(leaf);
+  }
+  return true;
+}
+
+bool CsvEventReader::hasValue(const Column & column) const {
+  if(column.cell >= 0) {
+    return (size_t)column.cell < cell_count_ && !cells_[column.cell].empty();
+  }
+  for(const Column& child : column.children) {
+    if(hasValue(child))
+      return true;
+  }
+  return false;
+}
+
+void CsvEventReader::emitMap(YAML::EventHandler & handler, const Column & column) {
+  const YAML::Mark& mark = input_.getMark();
+  handler.OnMapStart(mark, "?", YAML::NullAnchor, YAML::EmitterStyle::Block);
+  for(const Column& child : column.children) {
+    if(!hasValue(child))
+      continue;
+    handler.OnScalar(mark, "?", YAML::NullAnchor, child.key);
+    if(child.cell < 0) {
+      emitMap(handler, child);
+    } else {
+      emitLeaf(handler, child);
+    }
+  }
+  handler.OnMapEnd();
+}
+
+void CsvEventReader::emitLeaf(YAML::EventHandler & handler, const Column & column) {
+  const YAML::Mark& mark = input_.getMark();
+  const std::string& value = cells_[column.cell];
+  if(!column.sequence) {
+    handler.OnScalar(mark, "?", YAML::NullAnchor, value);
+    return;
+  }
+
+  handler.OnSequenceStart(mark, "?", YAML::NullAnchor, YAML::EmitterStyle::Flow);
+  std::string_view items = value;
+  while(true) {
+    size_t bar = items.find('|');
+    std::string_view item = items.substr(0, bar);
+    if(column.fields.empty()) {
+      scratch_.assign(item.data(), item.size());
+      handler.OnScalar(mark, "?", YAML::NullAnchor, scratch_);
+    } else {
+      handler.OnMapStart(mark, "?", YAML::NullAnchor, YAML::EmitterStyle::Flow);
+      for(const std::string& field : column.fields) {
+        size_t colon = item.find(':');
+        std::string_view part = item.substr(0, colon);
+        item = colon == std::string_view::npos ? std::string_view() : item.substr(colon + 1);
+        if(part.empty())
+          continue;
+        handler.OnScalar(mark, "?", YAML::NullAnchor, field);
+        scratch_.assign(part.data(), part.size());
+        handler.OnScalar(mark, "?", YAML::NullAnchor, scratch_);
+      }
+      handler.OnMapEnd();
+    }
+    if(bar == std::string_view::npos)
+      break;
+    items = items.substr(bar + 1);
+  }
+  handler.OnSequenceEnd();
+}
+
+bool CsvEventReader::fail(const std::string & message) {
+  error_ = message;
+  error_mark_ = input_.getMark();
+  return false;
+}
+
+} // namespace pokeman
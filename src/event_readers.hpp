@@ -0,0 +1,162 @@
+/*
+* event_readers.hpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*
+* Readers for data files in json and csv. They turn a file into the same
+* events yaml-cpp's parser gives, so records are built and parsed exactly
+* like yaml ones.
+*/
+#ifndef POKEMAN_EVENT_READERS_HPP_
+#define POKEMAN_EVENT_READERS_HPP_
+
+#include <cstddef>
+
+#include <istream>
+#include <string>
+#include <vector>
+
+#include <yaml-cpp/eventhandler.h>
+#include <yaml-cpp/mark.h>
+
+/// Bytes read from the stream at a time.
+#define EVENT_READER_BUFFER_SIZE 65536
+
+/// Deepest nesting of json arrays and objects allowed.
+#define JSON_MAX_DEPTH 64
+
+namespace pokeman {
+
+/// File formats data can be read from.
+enum DataFormat {
+  kYamlFormat,
+  kJsonFormat,
+  kCsvFormat
+};
+
+/// Format by the file's extension; yaml for anything unknown.
+DataFormat getDataFormat(const std::string& filepath);
+
+/// Reads a stream through a fixed buffer, keeping track of lines.
+class BufferedInput {
+private:
+  std::istream& in_;
+  char buffer_[EVENT_READER_BUFFER_SIZE];
+  size_t position_;
+  size_t end_;
+  YAML::Mark mark_;
+
+public:
+  BufferedInput(std::istream& in);
+
+  /// Next byte without taking it, or -1 at the end.
+  int peek();
+
+  /// Takes the next byte, or -1 at the end.
+  int get();
+
+  /// Where the next byte is.
+  const YAML::Mark& getMark() const;
+
+private:
+  bool fill();
+};
+
+/// Reads one json document. Arrays become sequences, objects maps, and
+/// numbers and true and false scalars of their text.
+class JsonEventReader {
+private:
+  BufferedInput input_;
+
+  /// Reused for every string and number.
+  std::string scalar_;
+  std::string error_;
+  YAML::Mark error_mark_;
+
+public:
+  JsonEventReader(std::istream& in);
+
+  /// False, if the json is malformed.
+  bool read(YAML::EventHandler& handler);
+
+  const std::string& getError() const;
+
+  const YAML::Mark& getErrorMark() const;
+
+private:
+  bool readValue(YAML::EventHandler& handler, const int depth);
+
+  bool readString();
+
+  bool readNumber();
+
+  bool readWord(const char* word);
+
+  void skipSpace();
+
+  bool fail(const std::string& message);
+};
+
+/// Reads a csv table as a sequence of maps, one per row. Header names
+/// are paths into the map, separated by dots. A name ending in "[]" holds
+/// a sequence, its items separated by '|', and one ending in "[a:b]" a
+/// sequence of maps, with the fields of each item separated by ':'.
+/// Empty cells are left out, as are maps with nothing in them.
+class CsvEventReader {
+private:
+  /// Map key or leaf column, from the header.
+  struct Column {
+    std::string key;
+
+    /// Index of the cell, for leaves; -1 for maps.
+    int cell;
+
+    /// Fields of each item, for sequences of maps.
+    std::vector<std::string> fields;
+    bool sequence;
+
+    std::vector<Column> children;
+  };
+
+  BufferedInput input_;
+  Column root_;
+
+  /// Cells of the row; only the first cell_count_ are in it.
+  std::vector<std::string> cells_;
+  size_t cell_count_;
+
+  /// Holds a piece of a cell while it is handed on.
+  std::string scratch_;
+  std::string error_;
+  YAML::Mark error_mark_;
+
+public:
+  CsvEventReader(std::istream& in);
+
+  /// False, if the csv is malformed.
+  bool read(YAML::EventHandler& handler);
+
+  const std::string& getError() const;
+
+  const YAML::Mark& getErrorMark() const;
+
+private:
+  /// Reads a row into cells_. False, at the end of the file.
+  bool readRow();
+
+  bool readHeader();
+
+  /// True, if any cell under the column has something in it.
+  bool hasValue(const Column& column) const;
+
+  void emitMap(YAML::EventHandler& handler, const Column& column);
+
+  void emitLeaf(YAML::EventHandler& handler, const Column& column);
+
+  bool fail(const std::string& message);
+};
+
+} // namespace pokeman
+
+#endif //POKEMAN_EVENT_READERS_HPP_
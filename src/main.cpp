@@ -5,7 +5,12 @@
 * May 2016
 */
 
+#include "battle_analysis.hpp"
+#include "compile_database.hpp"
+#include "data_generator.hpp"
+#include "matchup_analysis.hpp"
 #include "moveset_analysis.hpp"
+#include "test_moveset.hpp"
 #include "test_pokeman.hpp"
 #include "test_resources.hpp"
 #include "type_analysis.hpp"
@@ -27,8 +32,14 @@ int command_list(int argc, const char* argv[]);
 int run_tests(int argc, const char* argv[]);
 
 static const ArgumentType arguments[] = {
-  { "moveset", "find suggestions about moveset.", pokeman::driver::moveset_analysis},
+  { "moveset", "find suggestions about moveset; takes level cap, level-up, machines or all, a format and a board position.", pokeman::driver::moveset_analysis},
   { "types", "run type analysis on pokemon.", pokeman::driver::type_analysis},
+  { "moveset-all", "save recommended sets of every species; takes level cap, learn methods, format and board position.", pokeman::driver::moveset_all_analysis},
+  { "team-moveset", "pick sets for the whole team to cover its weaknesses; takes the same as moveset.", pokeman::driver::team_moveset_analysis},
+  { "matchups", "show how hard team members hit each species.", pokeman::driver::matchup_analysis},
+  { "battle", "simulate battles of the team; takes game count and seed.", pokeman::driver::battle_analysis},
+  { "compile", "compile the data into a database that loads quickly; takes an output path.", pokeman::driver::compile_database},
+  { "gen-data", "write made up species, moves and team; takes a directory, species, moves and team counts and a seed.", pokeman::driver::generate_data},
   { "test", "run tests on source code.", run_tests},
   { "help", "print command list.", command_list},
   { nullptr, nullptr, unrecognized_argument }
@@ -38,7 +49,8 @@ int run_tests(int argc, const char* argv[]) {
   // tests
   std::vector<const pokeman::test::TestNode*> suites = {
     pokeman::test::pokeman_suite(),
-    pokeman::test::resource_suite()
+    pokeman::test::resource_suite(),
+    pokeman::test::moveset_suite()
   };
 
   // run all suites
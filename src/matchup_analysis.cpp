@@ -0,0 +1,69 @@
+/*
+* matchup_analysis.cpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*/
+#include "matchup_analysis.hpp"
+
+#include <iomanip>
+#include <iostream>
+
+#include "damage_calculator.hpp"
+#include "resources.hpp"
+
+namespace pokeman {
+namespace driver {
+int matchup_analysis(int argc, const char* argv[]) {
+  // get database
+  bool error_occured;
+  resources::PokemanDatabase data = resources::initialize(&error_occured);
+  if(error_occured) {
+    std::cerr << "Couldn't load database; Exiting now" << std::endl;
+    return 1;
+  }
+
+  DamageCalculator calculator;
+  calculator.move_library_ = &data.getMoves();
+  calculator.chart_ = &data.getChart();
+  std::vector<const MonsterSpecies*> roster = data.getSpecies().getAll();
+
+  // best move of each team member on each species, at the member's level
+  std::cout << "--[ Matchups ]--" << std::endl;
+  for(const Monster& monster : data.getTeam()) {
+    std::cout << monster.toString() << " Lv. " << monster.level_ << ":" << std::endl;
+    std::vector<MoveId> moves = monster.species_->getMovepool().toVector();
+    for(MoveId move_id : monster.hm_moves_) {
+      moves.push_back(move_id);
+    }
+    std::vector<Combatant> targets;
+    for(const MonsterSpecies* species : roster) {
+      targets.push_back(Combatant(*species, monster.level_));
+    }
+    std::vector<DamageRange> matrix = calculator.calculateMatrix(Combatant(monster), moves, targets);
+
+    for(size_t j = 0; j < targets.size(); j++) {
+      std::cout << "  vs " << roster[j]->name_ << ": ";
+      int best = -1;
+      for(size_t i = 0; i < moves.size(); i++) {
+        if(best < 0 || matrix[i * targets.size() + j].expected > matrix[best * targets.size() + j].expected)
+          best = (int)i;
+      }
+      if(best < 0 || matrix[best * targets.size() + j].expected <= 0.0) {
+        std::cout << "no damaging moves" << std::endl;
+        continue;
+      }
+      const DamageRange& range = matrix[best * targets.size() + j];
+      std::cout << data.getMoves().get(moves[best]).name_ << " " << range.min << "-" << range.max
+        << " (" << std::fixed << std::setprecision(0) << 100.0 * range.min / range.target_hp << "-"
+        << 100.0 * range.max / range.target_hp << "% of " << range.target_hp << " hp)" << std::endl;
+    }
+    std::cout << std::endl;
+  }
+
+  // done
+  return 0;
+}
+
+} // namespace driver
+} // namespace pokeman
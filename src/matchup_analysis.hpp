@@ -0,0 +1,19 @@
+/*
+* matchup_analysis.hpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*
+* Driver that shows how hard each team member can hit every species.
+*/
+#ifndef POKEMAN_MATCHUP_ANALYSIS_HPP_
+#define POKEMAN_MATCHUP_ANALYSIS_HPP_
+#include "pokeman.hpp"
+
+namespace pokeman {
+namespace driver {
+int matchup_analysis(int argc, const char* argv[]);
+} // namespace driver
+} // namespace pokeman
+
+#endif //POKEMAN_MATCHUP_ANALYSIS_HPP_
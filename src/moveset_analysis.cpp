@@ -9,11 +9,22 @@
 #include "moveset_analysis.hpp"
 
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
 
+#include <algorithm>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <sstream>
 
+#include "moveset_optimizer.hpp"
+#include "moveset_table.hpp"
+#include "parallel.hpp"
 #include "resources.hpp"
 #include "pokeman_loader.hpp"
+#include "team_optimizer.hpp"
+#include "type_analyzer.hpp"
 
 #define MOVESET_ANALYSIS_FPATH_TEAM "Data/team.yml"
 #define MOVESET_ANALYSIS_FPATH_SPECIES "Data/species.yml"
@@ -24,192 +35,234 @@
 #define MOVESET_THIRD_QUADRANT 2
 #define MOVESET_FOURTH_QUADRANT 3
 #define MOVESET_QUADRANT_MOVES_TO_LIST 10
+#define MOVESET_SETS_TO_LIST 3
+
+/// Sets each member brings to the team-wide search.
+#define MOVESET_TEAM_CANDIDATES 16
+#define MOVESET_TEAM_SEED 1
+
+/// Bump when the way moves are rated changes, so cached ratings are redone.
+#define MOVESET_RATING_RULES_VERSION 2
+
+/// Damage of a move that hits more than one target, outside singles.
+#define MOVESET_SPREAD_MODIFIER 0.75
+
+/// Foes' worth of credit lost for each ally a damaging move hits.
+#define MOVESET_ALLY_HIT_PENALTY 1.0
 
 using namespace std::literals::string_literals;
 
 namespace pokeman {
 namespace driver {
+MovesetAnalyzer::MovesetAnalyzer() : move_library_(nullptr), coverage_table_(nullptr), damage_calculator_(nullptr),
+  setup_damage_table_(nullptr), level_cap_(POKEMAN_MAX_LEVEL), learn_methods_(kAllLearnMethods), format_(kSingles), board_position_(0), rating_cache_(nullptr), rating_version_(0),
+  rating_expression_(nullptr), moveset_table_(nullptr) {}
+
 /// Finds moves that are strong against the types that the monster resists well.
 /// This includes status-type moves. Moves that are used on self are
 /// always included.
-std::vector<std::string> MovesetAnalyzer::getStrongMoves(const TypeChart& chart, const Monster& monster) const {
+MoveSet MovesetAnalyzer::getStrongMoves(const TypeChart& chart, const Monster& monster) const {
   assert(monster.species_ != nullptr);
+  assert(move_library_ != nullptr);
   std::list<Type> types_of_interest = chart.getDefensiveStrengths(monster.species_->type_, true);
-  std::vector<std::string> move_pool = monster.species_->getMovepool();
-  std::vector<std::string> strong_moves;
-  for(std::string move_name : move_pool) {
-    Move move;
-    if(!getMoveIfExists(move_name, &move)) {
-      std::cerr << "could not get move '" << move_name << "'" << std::endl;
-      return std::vector<std::string>();
-    } else {
-      for(Type type : types_of_interest) {
-        if(chart.isWeakTo(type, move.elemental_type_) || move.move_type_ == kStatus) {
-          strong_moves.push_back(move_name);
-          break;
-        }
+
+  // which move types hit any of those hard?
+  MoveSet strong_moves = move_library_->getCategorySet(kStatus);
+  for(int i = 0; i < kNullType; i++) {
+    Type move_type = (Type)i;
+    for(Type type : types_of_interest) {
+      if(chart.isWeakTo(type, move_type)) {
+        strong_moves |= move_library_->getTypeSet(move_type);
+        break;
       }
     }
   }
-  return strong_moves;
+  return strong_moves &= MoveSet(getMovepool(monster));
 }
 
 /// Filters out moves based on type.
-std::vector<std::string> MovesetAnalyzer::filterMovesByType(const std::vector<std::string>& moves, const MoveType type) const {
+MoveSet MovesetAnalyzer::filterMovesByType(const MoveSet& moves, const MoveType type) const {
   assert(type != kNullMoveType);
   if(type == kNullMoveType) {
     std::cerr << "Could not filter moves by null type" << std::endl;
-    return std::vector<std::string>();
+    return MoveSet();
   } else {
-    std::vector<std::string> filtered;
-    for(std::string move_name : moves) {
-      Move move;
-      if(!getMoveIfExists(move_name, &move)) {
-        std::cerr << "Error retrieving move '" << move_name << "'" << std::endl;
-        return std::vector<std::string>();
-      } else {
-        if(move.move_type_ == type) {
-          filtered.push_back(move_name);
-        }
-      }
-    }
-    return filtered;
+    return moves & move_library_->getCategorySet(type);
   }
 }
 
-std::vector<std::string> MovesetAnalyzer::filterMovesByStab(const std::vector<std::string>& moves, const TypesHad & typing) const {
-  std::vector<std::string> stab;
-  for(std::string move_name : moves) {
-    Move move;
-    if(!getMoveIfExists(move_name, &move)) {
-      std::cerr << "Error: Not able to find move '" << move_name << std::endl;
-      return std::vector<std::string>();
-    } else {
-      if(isStab(move, typing)) {
-        stab.push_back(move_name);
-      }
-    }
+MoveSet MovesetAnalyzer::filterMovesByStab(const MoveSet& moves, const TypesHad & typing) const {
+  MoveSet types = move_library_->getTypeSet(typing.first_type_);
+  if(typing.b_dual_type_) {
+    types |= move_library_->getTypeSet(typing.second_type_);
   }
-  return stab;
+  return moves & move_library_->getFlagSet(kMoveDamaging) & move_library_->getFlagSet(kMoveTargetsFoe) & types;
 }
 
-std::vector<std::string> MovesetAnalyzer::filterMovesByNonDamaging(const std::vector<std::string>& moves) const {
-  std::vector<std::string> nondamaging;
-  for(std::string move_name : moves) {
-    Move move;
-    if(!getMoveIfExists(move_name, &move)) {
-      std::cerr << "Error: Not able to find move '" << move_name << std::endl;
-      return std::vector<std::string>();
-    } else {
-      if(isNonDamaging(move)) {
-        nondamaging.push_back(move_name);
-      }
-    }
+MoveSet MovesetAnalyzer::filterMovesByNonDamaging(const MoveSet& moves) const {
+  return moves - move_library_->getFlagSet(kMoveDamaging);
+}
+
+MoveSet MovesetAnalyzer::filterStatChangeMovesByMonster(const MoveSet& moves, const Monster & monster) const {
+  MoveSet boosts;
+  if(suitedToPhysical(monster)) {
+    boosts |= move_library_->getFlagSet(kMoveBoostsAttack);
   }
-  return nondamaging;
-}
-
-std::vector<std::string> MovesetAnalyzer::filterStatChangeMovesByMonster(const std::vector<std::string>& moves, const Monster & monster) const {
-  std::vector<std::string> moves_filtered;
-  for(std::string move_name : moves) {
-    Move move;
-    if(!getMoveIfExists(move_name, &move)) {
-      std::cerr << "Error: Not able to find move '" << move_name << std::endl;
-      return std::vector<std::string>();
-    } else {
-      if (move.stat_modifiers_self_.attack_ > 0 && suitedToPhysical(monster)) {
-        moves_filtered.push_back(move_name);
-      } else if (move.stat_modifiers_self_.special_attack_ > 0 && suitedToSpecial(monster)) {
-        moves_filtered.push_back(move_name);
-      }
-    }
+  if(suitedToSpecial(monster)) {
+    boosts |= move_library_->getFlagSet(kMoveBoostsSpecialAttack);
   }
-  return moves_filtered;
+  return moves & boosts;
 }
 
-std::vector<std::string> MovesetAnalyzer::filterMovesByUtility(const std::vector<std::string>& moves, const Monster & monster) const {
-  std::vector<std::string> utility;
-  for(std::string move_name : moves) {
-    Move move;
-    if(!getMoveIfExists(move_name, &move)) {
-      std::cerr << "Error: Not able to find move '" << move_name << std::endl;
-      return std::vector<std::string>();
-    } else {
-      if(isUtility(move)) {
-        utility.push_back(move_name);
-      }
-    }
-  }
-  return utility;
+MoveSet MovesetAnalyzer::filterMovesByUtility(const MoveSet& moves, const Monster & monster) const {
+  return moves - move_library_->getFlagSet(kMoveDamaging) - move_library_->getFlagSet(kMoveSelfStatChange)
+    - move_library_->getFlagSet(kMoveTargetStatChange);
 }
 
-std::list<Type> MovesetAnalyzer::getMoveSupereffectiveTypes(const TypeChart & chart, const std::string & move_name) const {
-  Move move;
-  if(!getMoveIfExists(move_name, &move)) {
-    std::cerr << "Error: could not find move '" << move_name << "'" << std::endl;
-    return std::list<Type>();
-  } else if (!MoveTarget(move.target_).target_foe) {
+std::list<Type> MovesetAnalyzer::getMoveSupereffectiveTypes(const TypeChart & chart, const MoveId move_id) const {
+  const Move& move = move_library_->get(move_id);
+  if ((move.flags_ & kMoveTargetsFoe) == 0) {
     return std::list<Type>(); // cannot be practically supereffective  
   } else {
     return chart.getOffensiveStrengths(move.elemental_type_, false);
   }
 }
 
-std::string MovesetAnalyzer::moveToString(std::string move_name) const {
-  Move move;
-  if(!getMoveIfExists(move_name, &move)) {
-    return move_name + " <NOT FOUND>"s;
+std::string MovesetAnalyzer::moveToString(const MoveId move_id) const {
+  if(!move_library_->contains(move_id)) {
+    return std::to_string(move_id) + " <NOT FOUND>"s;
   } else {
+    const Move& move = move_library_->get(move_id);
     return "'"s + move.name_ + "' "s + resources::getTypeName(move.elemental_type_) + " "s + resources::getMoveTypeName(move.move_type_) + " "s
       + std::to_string(move.pp_) + "mp " +  (move.power_ > 0 ? std::to_string(move.power_) : "--")
       + " "s + (move.accuracy_ > 0 ? std::to_string(move.accuracy_) : "--") + "%"s;
   }
 }
 
-void MovesetAnalyzer::printMovesetAnalysis(const TypeChart & chart, const Monster & monster) const {
+void MovesetAnalyzer::printMovesetAnalysis(const TypeChart & chart, const Monster & monster, std::ostream & out) const {
   assert(monster.species_ != nullptr);
 
   // get moveset
-  std::vector<std::string> moves = getStrongMoves(chart, monster);
+  std::vector<MoveId> moves = getStrongMoves(chart, monster).toVector();
 
   // print name
-  std::cout << monster.toString() << ": " << std::endl;
+  out << monster.toString() << ": " << std::endl;
 
   // print best moves
   if(monster.species_->type_.b_dual_type_) {
-    printFourMovePicksForDualtyped(moves, monster);
+    printFourMovePicksForDualtyped(moves, monster, out);
   } else {
-    printFourMovePicksForMonotyped(moves, monster);
+    printFourMovePicksForMonotyped(moves, monster, out);
   }
+
+  // print best full sets
+  printBestMovesets(chart, monster, out);
 }
 
-bool MovesetAnalyzer::getMoveIfExists(const std::string & string, Move * move_dest) const {
-  assert(move_dest != nullptr);
-  if(move_data_.find(string) == move_data_.end()) {
+std::vector<Moveset> MovesetAnalyzer::findBestMovesets(const Monster & monster) const {
+  std::vector<MoveId> locked = getLockedMoves(monster);
+  if(moveset_table_ != nullptr && locked.empty() && monster.level_ == moveset_table_->level_) {
+    const std::vector<Moveset>* precomputed = moveset_table_->find(monster.species_->number_);
+    if(precomputed != nullptr)
+      return *precomputed;
+  }
+  return findCandidateMovesets(monster, MOVESET_SETS_TO_LIST);
+}
+
+std::vector<Moveset> MovesetAnalyzer::findCandidateMovesets(const Monster & monster, const size_t count) const {
+  MovesetOptimizer optimizer;
+  optimizer.move_library_ = move_library_;
+  optimizer.coverage_table_ = coverage_table_;
+
+  // one per thread, so its memo is only allocated once per worker
+  thread_local SetupEvaluator setup_evaluator;
+  if(prepareSetupEvaluator(monster, &setup_evaluator)) {
+    optimizer.setup_evaluator_ = &setup_evaluator;
+  }
+  return optimizer.findBest(monster, getMovepool(monster), getLockedMoves(monster), count);
+}
+
+bool MovesetAnalyzer::prepareSetupEvaluator(const Monster & monster, SetupEvaluator * evaluator) const {
+  if(damage_calculator_ == nullptr || roster_.empty()) {
     return false;
-  } else {
-    *move_dest = move_data_.at(string);
+  }
+  if(setup_damage_table_ != nullptr) {
+    evaluator->prepare(Combatant(monster), setup_damage_table_);
     return true;
   }
+  std::vector<Combatant> targets;
+  targets.reserve(roster_.size());
+  for(const MonsterSpecies* species : roster_) {
+    targets.push_back(Combatant(*species, monster.level_));
+  }
+  evaluator->damage_calculator_ = damage_calculator_;
+  evaluator->prepare(Combatant(monster), targets);
+  return true;
 }
 
-void MovesetAnalyzer::printFourMovePicksForMonotyped(const std::vector<std::string>& moves, const Monster & monster) const {
+void MovesetAnalyzer::printBestMovesets(const TypeChart & chart, const Monster & monster, std::ostream & out) const {
+  std::vector<Moveset> movesets = findBestMovesets(monster);
+  SetupEvaluator setup_evaluator;
+  bool show_setup = prepareSetupEvaluator(monster, &setup_evaluator);
+
+  out << "  Recommended sets:" << std::endl;
+  for(const Moveset& moveset : movesets) {
+    out << "    [" << std::fixed << std::setprecision(2) << moveset.score << "]";
+    for(int i = 0; i < moveset.count; i++) {
+      out << (i == 0 ? " " : ", ") << move_library_->get(moveset.moves[i]).name_;
+    }
+    out << std::endl;
+
+    // how to use it, if setting up pays off
+    std::vector<MoveId> sequence;
+    double damage = show_setup ? setup_evaluator.evaluate(moveset.moves, moveset.count, &sequence) : 0.0;
+    bool sets_up = std::any_of(sequence.begin(), sequence.end(), [this](MoveId id) {
+      return (move_library_->getFlags(id) & kMoveDamaging) == 0;
+    });
+    if(sets_up) {
+      out << "      setup:";
+      for(size_t i = 0; i < sequence.size(); i++) {
+        out << (i == 0 ? " " : ", ") << move_library_->get(sequence[i]).name_;
+      }
+      out << " (" << std::setprecision(2) << damage << " hp)" << std::endl;
+    }
+  }
+  out << std::endl;
+}
+
+MoveIdSpan MovesetAnalyzer::getMovepool(const Monster & monster) const {
+  return monster.species_->getMovepool(level_cap_, learn_methods_);
+}
+
+std::vector<MoveId> MovesetAnalyzer::getLockedMoves(const Monster & monster) const {
+  std::vector<MoveId> kept;
+  std::bitset<4> quadrant_taken = analyzeHMniches(monster, &kept);
+  std::vector<MoveId> locked;
+  for(unsigned int i = 0; i < kept.size(); i++) {
+    if(quadrant_taken[i])
+      locked.push_back(kept[i]);
+  }
+  return locked;
+}
+
+void MovesetAnalyzer::printFourMovePicksForMonotyped(const std::vector<MoveId>& moves, const Monster & monster, std::ostream & out) const {
   assert(monster.species_ != nullptr);
   assert(!monster.species_->type_.b_dual_type_);
 
   // check how many HMS are taken
-  std::bitset<4> quadrant_taken = analyzeHMniches(monster);
+  std::vector<MoveId> kept;
+  std::bitset<4> quadrant_taken = analyzeHMniches(monster, &kept);
 
   // These are the ranked moves decided on.
 
-  std::map<std::string, double> ranking_map = getMoveRatings(moves, monster);
-  MoveRankings rankings(&ranking_map, this);
+  std::vector<double> ratings = getMoveRatings(moves, monster);
+  MoveRankings rankings(&moves, &ratings, this);
   Type type = monster.species_->type_.first_type_;
-  std::vector<std::vector<std::string>> slots;
-  slots.push_back(getPicks(rankings.pickStabWithHighPP(type), monster, quadrant_taken[MOVESET_FIRST_QUADRANT], MOVESET_FIRST_QUADRANT));
-  slots.push_back(getPicks(rankings.pickStabWithHighPower(type), monster, quadrant_taken[MOVESET_SECOND_QUADRANT], MOVESET_SECOND_QUADRANT));
-  slots.push_back(getPicks(rankings.pickNonStabButStrong(monster.species_->type_), monster, quadrant_taken[MOVESET_THIRD_QUADRANT], MOVESET_THIRD_QUADRANT));
-  slots.push_back(getPicks(rankings.pickNonDamaging(monster), monster, quadrant_taken[MOVESET_FOURTH_QUADRANT], MOVESET_FOURTH_QUADRANT));
+  std::vector<std::vector<MoveId>> slots;
+  slots.push_back(getPicks(rankings.pickStabWithHighPP(type), kept, MOVESET_FIRST_QUADRANT));
+  slots.push_back(getPicks(rankings.pickStabWithHighPower(type), kept, MOVESET_SECOND_QUADRANT));
+  slots.push_back(getPicks(rankings.pickNonStabButStrong(monster.species_->type_), kept, MOVESET_THIRD_QUADRANT));
+  slots.push_back(getPicks(rankings.pickNonDamaging(monster), kept, MOVESET_FOURTH_QUADRANT));
 
   // Print results
   std::vector<MovesetPicksNode> meta;
@@ -217,27 +270,28 @@ void MovesetAnalyzer::printFourMovePicksForMonotyped(const std::vector<std::stri
   meta.push_back({"High Powered STAB", quadrant_taken[meta.size()]});
   meta.push_back({"Utility", quadrant_taken[meta.size()]});
   meta.push_back({"Non damaging", quadrant_taken[meta.size()]});
-  printPicks(slots, meta);
+  printPicks(slots, meta, out);
 
 }
 
-void MovesetAnalyzer::printFourMovePicksForDualtyped(const std::vector<std::string>& moves, const Monster & monster) const {
+void MovesetAnalyzer::printFourMovePicksForDualtyped(const std::vector<MoveId>& moves, const Monster & monster, std::ostream & out) const {
   assert(monster.species_ != nullptr);
   assert(monster.species_->type_.b_dual_type_);
 
   // check how many HMS are taken
-  std::bitset<4> quadrant_taken = analyzeHMniches(monster);
+  std::vector<MoveId> kept;
+  std::bitset<4> quadrant_taken = analyzeHMniches(monster, &kept);
 
   // These are the ranked moves decided on.
-  std::map<std::string, double> ranking_map = getMoveRatings(moves, monster);
-  MoveRankings rankings(&ranking_map, this);
+  std::vector<double> ratings = getMoveRatings(moves, monster);
+  MoveRankings rankings(&moves, &ratings, this);
   Type first_type = monster.species_->type_.first_type_;
   Type second_type = monster.species_->type_.second_type_;
-  std::vector<std::vector<std::string>> slots;
-  slots.push_back(getPicks(rankings.pickStabWithHighPP(first_type), monster, quadrant_taken[MOVESET_FIRST_QUADRANT], MOVESET_FIRST_QUADRANT));
-  slots.push_back(getPicks(rankings.pickStabWithHighPP(second_type), monster, quadrant_taken[MOVESET_SECOND_QUADRANT], MOVESET_SECOND_QUADRANT));
-  slots.push_back(getPicks(rankings.pickNonStabButStrong(monster.species_->type_), monster, quadrant_taken[MOVESET_THIRD_QUADRANT], MOVESET_THIRD_QUADRANT));
-  slots.push_back(getPicks(rankings.pickNonDamaging(monster), monster, quadrant_taken[MOVESET_FOURTH_QUADRANT], MOVESET_FOURTH_QUADRANT));
+  std::vector<std::vector<MoveId>> slots;
+  slots.push_back(getPicks(rankings.pickStabWithHighPP(first_type), kept, MOVESET_FIRST_QUADRANT));
+  slots.push_back(getPicks(rankings.pickStabWithHighPP(second_type), kept, MOVESET_SECOND_QUADRANT));
+  slots.push_back(getPicks(rankings.pickNonStabButStrong(monster.species_->type_), kept, MOVESET_THIRD_QUADRANT));
+  slots.push_back(getPicks(rankings.pickNonDamaging(monster), kept, MOVESET_FOURTH_QUADRANT));
 
   // Print results
   std::vector<MovesetPicksNode> meta;
@@ -245,85 +299,340 @@ void MovesetAnalyzer::printFourMovePicksForDualtyped(const std::vector<std::stri
   meta.push_back({"Second type STAB", quadrant_taken[meta.size()]});
   meta.push_back({"Utility", quadrant_taken[meta.size()]});
   meta.push_back({"Non damaging", quadrant_taken[meta.size()]});
-  printPicks(slots, meta);
+  printPicks(slots, meta, out);
 }
 
-std::vector<std::string> MovesetAnalyzer::getPicks(const std::vector<std::string>& picks, const Monster & monster, const bool isHM, const unsigned int slot) const {
-  std::vector<std::string> moves;
-  if(!isHM) {
-    if(picks.size() <= MOVESET_QUADRANT_MOVES_TO_LIST) {
-      return picks;
-    } else {
-      moves.assign(picks.cbegin(), picks.cbegin() + (MOVESET_QUADRANT_MOVES_TO_LIST));
+std::vector<MoveId> MovesetAnalyzer::getPicks(const std::vector<MoveId>& picks, const std::vector<MoveId>& kept, const unsigned int slot) const {
+  assert(slot < kept.size());
+  std::vector<MoveId> moves;
+  if(kept[slot] == kNullMoveId) {
+    for(MoveId pick : picks) {
+      if(moves.size() == MOVESET_QUADRANT_MOVES_TO_LIST)
+        break;
+      if(std::find(kept.begin(), kept.end(), pick) == kept.end())
+        moves.push_back(pick);
     }
   } else {
-    assert(monster.hm_moves_.size() >= slot + 1);
-    moves.push_back(monster.hm_moves_[slot]);
+    moves.push_back(kept[slot]);
   }
   return moves;
 }
 
-void MovesetAnalyzer::printPicks(const std::vector<std::vector<std::string>>& picks, const std::vector<MovesetPicksNode>& meta) const {
+void MovesetAnalyzer::printPicks(const std::vector<std::vector<MoveId>>& picks, const std::vector<MovesetPicksNode>& meta, std::ostream & out) const {
   assert(picks.size() == meta.size());
   assert(picks.size() == 4);
 
   // print descriptions or note lock for each pick.
   for(int i = 0;  i < 4; i++) {
     MovesetPicksNode info = meta[i];
-    std::cout << "  (" << (i + 1) << ") " << (info.isHM ? "LOCKED"s : info.description) << ":" << std::endl;
-    for(std::string pick : picks[i]) {
-      std::cout << "      " << moveToString(pick) << std::endl;
+    out << "  (" << (i + 1) << ") " << (info.isHM ? "LOCKED"s : info.description) << ":" << std::endl;
+    for(MoveId pick : picks[i]) {
+      out << "      " << moveToString(pick) << std::endl;
+    }
+  }
+  out << std::endl;
+}
+
+std::vector<double> MovesetAnalyzer::getMoveRatings(const std::vector<MoveId>& moves, const Monster & monster) const {
+  if(rating_cache_ == nullptr) {
+    return computeMoveRatings(moves, monster);
+  }
+
+  // look up what we can
+  std::vector<double> ratings(moves.size(), 0.0);
+  std::vector<MoveId> missing;
+  std::vector<size_t> positions;
+  for(size_t i = 0; i < moves.size(); i++) {
+    RatingKey key = {monster.species_->number_, moves[i], monster.level_, rating_version_};
+    if(!rating_cache_->find(key, &ratings[i])) {
+      missing.push_back(moves[i]);
+      positions.push_back(i);
     }
   }
-  std::cout << std::endl;
+
+  // work out the rest
+  std::vector<double> computed = computeMoveRatings(missing, monster);
+  for(size_t i = 0; i < positions.size(); i++) {
+    ratings[positions[i]] = computed[i];
+    rating_cache_->store({monster.species_->number_, missing[i], monster.level_, rating_version_}, computed[i]);
+  }
+  return ratings;
 }
 
-std::map<std::string, double> MovesetAnalyzer::getMoveRatings(const std::vector<std::string>& moves, const Monster & monster) const {
-  std::map<std::string, double> ratings;
-  for(std::string move_name : moves) {
-    Move move;
-    if(!getMoveIfExists(move_name, &move)) {
-      std::cerr << "Error compiling move priorities on '" << move_name << "'" << std::endl;
-      return std::map<std::string, double>();
-    } else {
-      ratings[move_name] = moveRating(monster, move);
+std::vector<double> MovesetAnalyzer::computeMoveRatings(const std::vector<MoveId>& moves, const Monster & monster) const {
+  std::vector<double> ratings = rating_expression_ != nullptr ? evaluateMoveRatings(moves, monster)
+    : builtinMoveRatings(moves, monster);
+  if(format_ != kSingles) {
+    std::vector<double> multipliers = getFormatMultipliers(moves);
+    for(size_t i = 0; i < ratings.size(); i++) {
+      ratings[i] *= multipliers[i];
     }
+  }
+  return ratings;
+}
+
+std::vector<double> MovesetAnalyzer::builtinMoveRatings(const std::vector<MoveId>& moves, const Monster & monster) const {
+  std::vector<double> ratings;
+  ratings.reserve(moves.size());
+  for(MoveId move_id : moves) {
+    ratings.push_back(moveRating(monster, move_library_->get(move_id)));
   } 
+  if(damage_calculator_ == nullptr || roster_.empty()) {
+    return ratings;
+  }
+
+  // rate damaging moves by what they'd do to everyone at the same level
+  std::vector<MoveId> damaging;
+  std::vector<size_t> positions;
+  for(size_t i = 0; i < moves.size(); i++) {
+    if(move_library_->get(moves[i]).move_type_ != kStatus) {
+      damaging.push_back(moves[i]);
+      positions.push_back(i);
+    }
+  }
+  std::vector<Combatant> targets;
+  targets.reserve(roster_.size());
+  for(const MonsterSpecies* species : roster_) {
+    targets.push_back(Combatant(*species, monster.level_));
+  }
+  std::vector<double> damage_ratings = damage_calculator_->rateAgainstRoster(Combatant(monster), damaging, targets);
+  for(size_t i = 0; i < positions.size(); i++) {
+    ratings[positions[i]] = damage_ratings[i];
+  }
   return ratings;
 }
 
-std::bitset<4> MovesetAnalyzer::analyzeHMniches(const Monster & monster) {
-  assert(monster.hm_moves_.size() < 5);
-  std::bitset<4> quadrants;
-  for(unsigned int i = 0; i < monster.hm_moves_.size(); i++) {
-    quadrants[i] = true; //todo: actually check niches, after tests pass and the demo otherwise works
+std::vector<double> MovesetAnalyzer::evaluateMoveRatings(const std::vector<MoveId>& moves, const Monster & monster) const {
+  assert(rating_expression_ != nullptr);
+  const MonsterStats& stats = monster.species_->base_stats_;
+  const TypesHad& typing = monster.species_->type_;
+  ScoringBatch batch;
+  batch.resize(moves.size());
+  for(size_t i = 0; i < moves.size(); i++) {
+    const Move& move = move_library_->get(moves[i]);
+    batch.column(kScoringPower)[i] = move.power_;
+    batch.column(kScoringAccuracy)[i] = move.accuracy_;
+    batch.column(kScoringPp)[i] = move.pp_;
+    batch.column(kScoringPhysical)[i] = move.move_type_ == kPhysical;
+    batch.column(kScoringSpecial)[i] = move.move_type_ == kSpecial;
+    batch.column(kScoringStatus)[i] = move.move_type_ == kStatus;
+    batch.column(kScoringStab)[i] = move.elemental_type_ == typing.first_type_
+      || (typing.b_dual_type_ && move.elemental_type_ == typing.second_type_);
+    batch.column(kScoringSuited)[i] = suitedToMoveTypeRating(monster, move);
+    batch.column(kScoringHp)[i] = stats.hp_;
+    batch.column(kScoringAttack)[i] = stats.attack_;
+    batch.column(kScoringDefense)[i] = stats.defense_;
+    batch.column(kScoringSpecialAttack)[i] = stats.special_attack_;
+    batch.column(kScoringSpecialDefense)[i] = stats.special_defense_;
+    batch.column(kScoringSpeed)[i] = stats.speed_;
+    batch.column(kScoringLevel)[i] = monster.level_;
   }
-  return quadrants;
+
+  // damage is the costly one, so only work it out if it's asked for
+  if(damage_calculator_ != nullptr && !roster_.empty() && rating_expression_->usesVariable(kScoringDamage)) {
+    std::vector<Combatant> targets;
+    targets.reserve(roster_.size());
+    for(const MonsterSpecies* species : roster_) {
+      targets.push_back(Combatant(*species, monster.level_));
+    }
+    std::vector<double> damage_ratings = damage_calculator_->rateAgainstRoster(Combatant(monster), moves, targets);
+    std::copy(damage_ratings.begin(), damage_ratings.end(), batch.column(kScoringDamage));
+  }
+
+  std::vector<double> ratings(moves.size(), 0.0);
+  rating_expression_->evaluate(batch, ratings.data());
+  return ratings;
 }
 
-bool MovesetAnalyzer::isStab(const Move move, const TypesHad & typing) {
-  if(!MoveTarget(move.target_).target_foe || isNonDamaging(move)) {
-    return false;
-  } else {
-    bool is_stab_first = move.elemental_type_ == typing.first_type_;
-    bool is_stab_second = typing.b_dual_type_ && move.elemental_type_ == typing.second_type_;
-    return is_stab_first || is_stab_second;
+/// Works out a multiplier per target description and damage class once,
+/// then looks each move up.
+std::vector<double> MovesetAnalyzer::getFormatMultipliers(const std::vector<MoveId>& moves) const {
+  assert(board_position_ >= 0 && board_position_ < format_);
+  double by_target[kNullTargetDescription][2];
+  for(int description = 0; description < kNullTargetDescription; description++) {
+    const MoveTargetTraits& traits = kMoveTargetTraits[description];
+    MoveTargetMask mask = getMoveTargetMask((MoveTargetDescription)description, format_, board_position_);
+    int foes = (int)std::bitset<POKEMAN_MAX_BATTLE_SLOTS>(mask >> POKEMAN_MAX_BATTLE_SLOTS).count();
+    int allies = (int)std::bitset<POKEMAN_MAX_BATTLE_SLOTS>(mask & ~(1 << board_position_)).count();
+    for(int damaging = 0; damaging < 2; damaging++) {
+      double multiplier = 1.0;
+      if(!traits.foe) {
+        multiplier = 1.0; // support moves are judged the same anywhere
+      } else if(traits.any) {
+        multiplier = foes > 0 ? 1.0 : 0.0; // picks one foe
+      } else {
+        double hits = foes - (damaging ? allies * MOVESET_ALLY_HIT_PENALTY : 0.0);
+        double spread = foes + allies > 1 ? MOVESET_SPREAD_MODIFIER : 1.0;
+        multiplier = std::max(hits * spread, 0.0);
+      }
+      by_target[description][damaging] = multiplier;
+    }
+  }
+
+  std::vector<double> multipliers(moves.size(), 1.0);
+  for(size_t i = 0; i < moves.size(); i++) {
+    const Move& move = move_library_->get(moves[i]);
+    if(move.target_ != kNullTargetDescription) {
+      multipliers[i] = by_target[move.target_][(move.flags_ & kMoveDamaging) != 0];
+    }
   }
+  return multipliers;
 }
 
-bool MovesetAnalyzer::isNonDamaging(const Move move) {
-  return move.power_ < 0 || move.move_type_ == kStatus;
+/// FNV-1a over everything a rating is worked out from.
+/// FNV-1a over the value's four bytes.
+static void mixHash(uint32_t* hash, const int value) {
+  for(int i = 0; i < 4; i++) {
+    *hash = (*hash ^ (uint32_t)((value >> (8 * i)) & 0xFF)) * 16777619u;
+  }
 }
 
-bool MovesetAnalyzer::isUtility(const Move move) {
-  return isNonDamaging(move) && !hasStatModifier(move);
+uint32_t MovesetAnalyzer::getRatingVersion() const {
+  assert(move_library_ != nullptr);
+  uint32_t hash = 2166136261u;
+  auto mix = [&hash](const int value) {
+    mixHash(&hash, value);
+  };
+  mix(MOVESET_RATING_RULES_VERSION);
+  mix(damage_calculator_ != nullptr ? 1 : 0);
+  mix(format_);
+  mix(board_position_);
+  if(rating_expression_ != nullptr) {
+    for(char c : rating_expression_->getSource())
+      mix(c);
+  }
+  for(MoveId id = 0; id < move_library_->size(); id++) {
+    const Move& move = move_library_->get(id);
+    for(char c : move.name_)
+      mix(c);
+    mix(move.elemental_type_);
+    mix(move.move_type_);
+    mix(move.power_);
+    mix(move.accuracy_);
+    mix(move.pp_);
+  }
+  for(const MonsterSpecies* species : roster_) {
+    const MonsterStats& stats = species->base_stats_;
+    mix(species->number_);
+    mix(species->type_.first_type_);
+    mix(species->type_.b_dual_type_ ? species->type_.second_type_ : kNullType);
+    mix(stats.hp_);
+    mix(stats.attack_);
+    mix(stats.defense_);
+    mix(stats.special_attack_);
+    mix(stats.special_defense_);
+    mix(stats.speed_);
+  }
+  return hash;
+}
+
+/// Ratings don't depend on learnsets, but which sets can be picked does.
+uint32_t MovesetAnalyzer::getMovesetVersion() const {
+  uint32_t hash = getRatingVersion();
+  for(const MonsterSpecies* species : roster_) {
+    mixHash(&hash, species->number_);
+    mixHash(&hash, (int)species->learnset_.size());
+    for(const LearnsetMove& move : species->learnset_) {
+      mixHash(&hash, move.move_id_);
+      mixHash(&hash, move.learned_at_level_);
+      mixHash(&hash, (move.b_machine_able_ ? 1 : 0) | (move.b_tutor_able_ ? 2 : 0));
+    }
+  }
+  return hash;
+}
+
+/// Quadrants are, in order: the first STAB, the second STAB (or a strong
+/// one, for monotypes), damaging coverage and non damaging.
+double MovesetAnalyzer::getNicheFit(const Monster & monster, const MoveId move_id, const int quadrant) const {
+  const Move& move = move_library_->get(move_id);
+  const TypesHad& typing = monster.species_->type_;
+  bool damaging = (move.flags_ & kMoveDamaging) != 0;
+  bool first_stab = move.elemental_type_ == typing.first_type_;
+  bool second_stab = typing.b_dual_type_ && move.elemental_type_ == typing.second_type_;
+  double coverage = 0.0;
+  if(coverage_table_ != nullptr && coverage_table_->hasEntry(move_id)) {
+    coverage = (double)coverage_table_->getSuperEffective(move_id).count() / POKEMAN_NUMBER_OF_TYPINGS;
+  }
+
+  switch(quadrant) {
+  case MOVESET_FIRST_QUADRANT:
+    return damaging && first_stab ? 1.0 + (double)move.pp_ / 40 : 0.0;
+
+  case MOVESET_SECOND_QUADRANT:
+    if(typing.b_dual_type_)
+      return damaging && second_stab ? 1.0 + (double)move.pp_ / 40 : 0.0;
+    return damaging && first_stab ? 1.0 + (double)move.power_ / 150 : 0.0;
+
+  case MOVESET_THIRD_QUADRANT:
+    if(!damaging)
+      return 0.0;
+    return first_stab || second_stab ? 0.5 : 1.0 + coverage;
+
+  case MOVESET_FOURTH_QUADRANT:
+    return damaging ? 0.0 : 1.0;
+
+  default:
+    assert(false);
+    return 0.0;
+  }
 }
 
-bool MovesetAnalyzer::hasStatModifier(const Move move) {
-  return !move.stat_modifiers_self_.isBlank() || !move.stat_modifiers_target_.isBlank();
+/// Assignment by dynamic programming over subsets of quadrants: best[i][mask]
+/// is the most fit the first i kept moves can get from the quadrants in mask.
+/// Every kept move gets a quadrant, even one it doesn't fit.
+std::bitset<4> MovesetAnalyzer::analyzeHMniches(const Monster & monster, std::vector<MoveId>* kept) const {
+  assert(kept != nullptr);
+  const std::vector<MoveId>& moves = monster.hm_moves_;
+  assert(moves.size() <= MOVESET_SIZE); // the loaders refuse more
+  const int quadrant_count = 4;
+  const int mask_count = 1 << quadrant_count;
+  const double unreachable = -1.0;
+
+  double fit[4][4];
+  for(size_t i = 0; i < moves.size(); i++) {
+    for(int q = 0; q < quadrant_count; q++)
+      fit[i][q] = getNicheFit(monster, moves[i], q);
+  }
+
+  // a mask reachable after i moves has exactly i quadrants in it
+  double best[5][mask_count];
+  int choice[5][mask_count];
+  std::fill(&best[0][0], &best[0][0] + 5 * mask_count, unreachable);
+  best[0][0] = 0.0;
+  for(size_t i = 0; i < moves.size(); i++) {
+    for(int mask = 0; mask < mask_count; mask++) {
+      if(best[i][mask] == unreachable)
+        continue;
+      for(int q = 0; q < quadrant_count; q++) {
+        if(mask & (1 << q))
+          continue;
+        int next = mask | (1 << q);
+        double total = best[i][mask] + fit[i][q];
+        if(total > best[i + 1][next]) {
+          best[i + 1][next] = total;
+          choice[i + 1][next] = q;
+        }
+      }
+    }
+  }
+
+  // walk back from the best full assignment
+  int mask = 0;
+  for(int candidate = 0; candidate < mask_count; candidate++) {
+    if(best[moves.size()][candidate] > best[moves.size()][mask])
+      mask = candidate;
+  }
+  std::bitset<4> quadrants(mask);
+  kept->assign(quadrant_count, kNullMoveId);
+  for(size_t i = moves.size(); i > 0; i--) {
+    int q = choice[i][mask];
+    (*kept)[q] = moves[i - 1];
+    mask &= ~(1 << q);
+  }
+  return quadrants;
 }
 
-double MovesetAnalyzer::accuracyRating(const Move move) {
+double MovesetAnalyzer::accuracyRating(const Move& move) {
   if(move.accuracy_ < 0) {
     return 1.0; // doesn't miss
   } else {
@@ -331,7 +640,7 @@ double MovesetAnalyzer::accuracyRating(const Move move) {
   }
 }
 
-double MovesetAnalyzer::moveRating(const Monster & monster, const Move move) {
+double MovesetAnalyzer::moveRating(const Monster & monster, const Move& move) {
   if(!suitedToMoveTypeRating(monster, move)) {
     return 0.0;
   } else if (move.move_type_ == kStatus) {
@@ -351,7 +660,7 @@ bool MovesetAnalyzer::suitedToSpecial(const Monster & monster) {
   return monster.species_->base_stats_.special_attack_ >= monster.species_->base_stats_.attack_;
 }
 
-bool MovesetAnalyzer::suitedToMoveTypeRating(const Monster & monster, const Move move) {
+bool MovesetAnalyzer::suitedToMoveTypeRating(const Monster & monster, const Move& move) {
   bool isPhysical = move.move_type_ == kPhysical && suitedToPhysical(monster);
   bool isSpecial = move.move_type_ == kSpecial && suitedToSpecial(monster);
   bool isStatus = move.move_type_ == kStatus;
@@ -359,116 +668,403 @@ bool MovesetAnalyzer::suitedToMoveTypeRating(const Monster & monster, const Move
 }
 
 
-int moveset_analysis(int argc, const char * argv[]) {
-  // initialize config
-  resources::Loader config_loader(FILEPATH_CONFIG);
-  if(config_loader.errorOccured()) {
-    std::cerr << "Failed to load config, exiting now" << std::endl;
-    return 1;
-  }
+/// Names of learn methods, as given on the command line.
+struct LearnMethodsName {
+  const char* name;
+  LearnMethods methods;
+};
+
+static const LearnMethodsName learn_method_names[] = {
+  {"level-up", kLevelUpOnly},
+  {"machines", kLevelUpAndMachines},
+  {"all", kAllLearnMethods},
+  {nullptr, kAllLearnMethods}
+};
+
+/// Names of battle formats, as given on the command line.
+struct BattleFormatName {
+  const char* name;
+  BattleFormat format;
+};
 
-  // load stuff
-  bool error_occured;
-  resources::PokemanDatabase database = resources::initialize(&error_occured);
-  if(error_occured) {
-    std::cerr << "Couldn't load database; Exiting now" << std::endl;
-    return 2;
+static const BattleFormatName battle_format_names[] = {
+  {"singles", kSingles},
+  {"doubles", kDoubles},
+  {"triples", kTriples},
+  {nullptr, kSingles}
+};
+
+/// What the moveset drivers are asked to find sets for.
+struct MovesetLimits {
+  int level_cap;
+  LearnMethods learn_methods;
+  BattleFormat format;
+  int board_position;
+};
+
+/// Reads an optional level cap, learn methods, format and board position
+/// from argv[first] on.
+static bool parseLimits(int argc, const char* argv[], const int first, MovesetLimits* limits) {
+  limits->level_cap = POKEMAN_MAX_LEVEL;
+  limits->learn_methods = kAllLearnMethods;
+  limits->format = kSingles;
+  limits->board_position = 0;
+  if(argc > first) {
+    limits->level_cap = std::atoi(argv[first]);
+    if(limits->level_cap < 1 || limits->level_cap > POKEMAN_MAX_LEVEL) {
+      std::cerr << "[Error] level cap '" << argv[first] << "' should be from 1 to " << POKEMAN_MAX_LEVEL << std::endl;
+      return false;
+    }
   }
+  if(argc > first + 1) {
+    int i = 0;
+    while(learn_method_names[i].name != nullptr && std::strcmp(learn_method_names[i].name, argv[first + 1]) != 0)
+      i++;
+    if(learn_method_names[i].name == nullptr) {
+      std::cerr << "[Error] learn methods '" << argv[first + 1] << "' should be level-up, machines or all" << std::endl;
+      return false;
+    }
+    limits->learn_methods = learn_method_names[i].methods;
+  }
+  if(argc > first + 2) {
+    int i = 0;
+    while(battle_format_names[i].name != nullptr && std::strcmp(battle_format_names[i].name, argv[first + 2]) != 0)
+      i++;
+    if(battle_format_names[i].name == nullptr) {
+      std::cerr << "[Error] format '" << argv[first + 2] << "' should be singles, doubles or triples" << std::endl;
+      return false;
+    }
+    limits->format = battle_format_names[i].format;
+  }
+  if(argc > first + 3) {
+    limits->board_position = std::atoi(argv[first + 3]);
+    if(limits->board_position < 0 || limits->board_position >= limits->format) {
+      std::cerr << "[Error] board position '" << argv[first + 3] << "' should be from 0 to " << (limits->format - 1) << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
 
-  // develop moveset data
+/// Data and precomputed tables the moveset drivers share.
+/// The analyzer points into the rest, so a session stays put.
+struct MovesetSession {
+  resources::Loader config_loader;
+  resources::PokemanDatabase database;
+  TypeChart chart;
+  MoveCoverageTable coverage;
+  DamageCalculator damage_calculator;
+  std::unique_ptr<SetupDamageTable> setup_damage_table;
+  RatingCache rating_cache;
+  ScoringExpression rating_expression;
+  std::string rating_cache_path;
+  bool persist_ratings;
   MovesetAnalyzer analyzer;
-  analyzer.move_data_ = database.getMoves();
+
+  MovesetSession() : config_loader(FILEPATH_CONFIG), persist_ratings(false) {}
+  MovesetSession(const MovesetSession&) = delete;
+
+  /// Loads everything. Returns 0, or the driver's exit code on failure.
+  int open(const MovesetLimits& limits) {
+    // initialize config
+    if(config_loader.errorOccured()) {
+      std::cerr << "Failed to load config, exiting now" << std::endl;
+      return 1;
+    }
+
+    // load stuff in place, since the team points into it
+    if(!database.load(config_loader)) {
+      std::cerr << "Couldn't load database; Exiting now" << std::endl;
+      return 2;
+    }
+
+    // develop moveset data
+    chart = resources::generateTypeChartGen5();
+    coverage = MoveCoverageTable(database.getMoves(), chart);
+    damage_calculator.move_library_ = &database.getMoves();
+    damage_calculator.chart_ = &chart;
+    analyzer.move_library_ = &database.getMoves();
+    analyzer.coverage_table_ = &coverage;
+    analyzer.damage_calculator_ = &damage_calculator;
+    analyzer.roster_ = database.getSpecies().getAll();
+    setup_damage_table.reset(new SetupDamageTable(&damage_calculator, analyzer.roster_));
+    analyzer.setup_damage_table_ = setup_damage_table.get();
+    analyzer.level_cap_ = limits.level_cap;
+    analyzer.learn_methods_ = limits.learn_methods;
+    analyzer.format_ = limits.format;
+    analyzer.board_position_ = limits.board_position;
+
+    // rate moves by the configured formula, if there is one
+    std::string scoring_path;
+    if(config_loader.getFilepath(resources::LoaderTool::kScoring, &scoring_path)) {
+      YAML::Node scoring = config_loader.loadResource(resources::LoaderTool::kScoring);
+      std::string error;
+      if(config_loader.errorOccured() || !scoring["rating"].IsScalar()) {
+        std::cerr << "[Error] " << scoring_path << " should have a 'rating' expression" << std::endl;
+        return 5;
+      }
+      if(!rating_expression.compile(scoring["rating"].as<std::string>(), &error)) {
+        std::cerr << "[Error] rating expression in " << scoring_path << ": " << error << std::endl;
+        return 5;
+      }
+      analyzer.rating_expression_ = &rating_expression;
+    }
+
+    // reuse ratings from earlier runs, if configured to
+    persist_ratings = config_loader.getFilepath(resources::LoaderTool::kRatingCache, &rating_cache_path);
+    analyzer.rating_cache_ = &rating_cache;
+    analyzer.rating_version_ = analyzer.getRatingVersion();
+    if(persist_ratings) {
+      rating_cache.load(rating_cache_path, analyzer.rating_version_);
+    }
+    return 0;
+  }
+
+  /// Writes back new ratings, if configured to.
+  void close() {
+    if(persist_ratings && rating_cache.misses() > 0 && !rating_cache.save(rating_cache_path)) {
+      std::cerr << "[Warning] couldn't save move ratings to " << rating_cache_path << std::endl;
+    }
+  }
+};
+
+int moveset_analysis(int argc, const char * argv[]) {
+  MovesetLimits limits;
+  if(!parseLimits(argc, argv, 2, &limits)) {
+    return 3;
+  }
+  MovesetSession session;
+  int result = session.open(limits);
+  if(result != 0) {
+    return result;
+  }
+  MovesetAnalyzer& analyzer = session.analyzer;
+
+  // answer from the precomputed table, if it fits this run
+  MovesetTable table;
+  std::string table_path;
+  if(session.config_loader.getFilepath(resources::LoaderTool::kMovesetTable, &table_path)
+    && table.load(table_path, session.database.getMoves())
+    && table.matches(analyzer.getMovesetVersion(), limits.level_cap, limits.learn_methods)) {
+    analyzer.moveset_table_ = &table;
+  }
 
   // get moves for each pokemon
-  TypeChart chart = resources::generateTypeChartGen5();
   std::cout << "--[Find moves for each dude:] --" << std::endl;
-  for(Monster monster : database.getTeam()) {
-    analyzer.printMovesetAnalysis(chart, monster);
+  const std::vector<Monster>& team = session.database.getTeam();
+  std::vector<std::ostringstream> reports(team.size());
+  parallel::forEachIndex(team.size(), [&](size_t i) {
+    analyzer.printMovesetAnalysis(session.chart, team[i], reports[i]);
+  });
+
+  // print in team order
+  for(const std::ostringstream& report : reports) {
+    std::cout << report.str();
   }
+  session.close();
 
   // done
   return 0;
 }
 
-MoveRankings::MoveRankings(const std::map<std::string, double>* rankings, const MovesetAnalyzer * analyzer) :
-  rankings_(rankings), analyzer_(analyzer) {
-  assert(rankings_ != nullptr);
-  assert(analyzer_ != nullptr);
-}
+int moveset_all_analysis(int argc, const char * argv[]) {
+  MovesetLimits limits;
+  if(!parseLimits(argc, argv, 2, &limits)) {
+    return 3;
+  }
+  MovesetSession session;
+  int result = session.open(limits);
+  if(result != 0) {
+    return result;
+  }
+  std::string table_path;
+  if(!session.config_loader.getFilepath(resources::LoaderTool::kMovesetTable, &table_path)) {
+    std::cerr << "[Error] config has no 'movesets' file to write to" << std::endl;
+    return 4;
+  }
 
-std::vector<std::string> MoveRankings::pickStabWithHighPP(Type type) {
-  // get moves list
-  std::vector<std::string> moves = getMovesRatedAtLeast();
-  moves = analyzer_->filterMovesByStab(moves, type);
-  if(moves.empty()) {
-    return std::vector<std::string>();
-  } else {
-    return moves; // todo: actually filter by high PP somehow, however that would work 8/
+  // every species, with nothing locked, at the default level
+  std::vector<const MonsterSpecies*> species = session.database.getSpecies().getAll();
+  std::vector<std::vector<Moveset>> movesets(species.size());
+  parallel::forEachIndex(species.size(), [&](size_t i) {
+    Monster monster(species[i]->name_, species[i]);
+    movesets[i] = session.analyzer.findBestMovesets(monster);
+  });
+
+  // save
+  MovesetTable table;
+  table.version_ = session.analyzer.getMovesetVersion();
+  table.level_ = POKEMAN_DEFAULT_LEVEL;
+  table.level_cap_ = limits.level_cap;
+  table.learn_methods_ = limits.learn_methods;
+  for(size_t i = 0; i < species.size(); i++) {
+    table.set(species[i]->number_, movesets[i]);
   }
-}
+  if(!table.save(table_path, session.database.getMoves(), session.database.getSpecies())) {
+    std::cerr << "[Error] couldn't write " << table_path << std::endl;
+    return 5;
+  }
+  std::cout << "Wrote movesets for " << table.size() << " species to " << table_path << std::endl;
+  session.close();
 
-std::vector<std::string> MoveRankings::pickStabWithHighPower(Type type) {
-  return pickStabWithHighPP(type); //todo: fix, after I figure out how to prioritize this 8/
+  // done
+  return 0;
 }
 
-std::vector<std::string> MoveRankings::pickNonStabButStrong(TypesHad typing) {
-  // get moves list
-  std::vector<std::string> moves = getMovesRatedAtLeast();
-  std::vector<std::string> stab_moves = analyzer_->filterMovesByStab(moves, typing);
-  std::vector<std::string> nondamaging_moves = analyzer_->filterMovesByNonDamaging(moves);
-  if(moves.empty()) {
-    return std::vector<std::string>();
-  } else if (stab_moves.empty()) {
-    return moves;
-  } else {
-    std::vector<std::string> nonstab_moves;
-    for(int i = 0; i < (int)moves.size(); i++) {
-      if(!moveExistsInVector(stab_moves, moves[i]) && !moveExistsInVector(nondamaging_moves, moves[i])) {
-        nonstab_moves.push_back(moves[i]);
-      }
+int team_moveset_analysis(int argc, const char * argv[]) {
+  MovesetLimits limits;
+  if(!parseLimits(argc, argv, 2, &limits)) {
+    return 3;
+  }
+  MovesetSession session;
+  int result = session.open(limits);
+  if(result != 0) {
+    return result;
+  }
+  const std::vector<Monster>& team = session.database.getTeam();
+  const MoveLibrary& library = session.database.getMoves();
+
+  // threats are weighted by how many members they hit hard
+  TypeAnalyzer type_analyzer;
+  type_analyzer.chart_ = &session.chart;
+  type_analyzer.addMonstersToTeam(team);
+  std::vector<int> weaknesses = type_analyzer.countWeaknesses();
+  std::vector<double> threats(weaknesses.begin(), weaknesses.end());
+
+  // each member's best sets on its own
+  std::vector<std::vector<Moveset>> candidates(team.size());
+  parallel::forEachIndex(team.size(), [&](size_t i) {
+    candidates[i] = session.analyzer.findCandidateMovesets(team[i], MOVESET_TEAM_CANDIDATES);
+  });
+
+  // pick one each, together
+  TeamOptimizer optimizer;
+  optimizer.coverage_table_ = &session.coverage;
+  TeamPlan plan = optimizer.optimize(candidates, threats, MOVESET_TEAM_SEED);
+  std::vector<int> alone(team.size(), 0);
+  for(size_t i = 0; i < team.size(); i++) {
+    alone[i] = candidates[i].empty() ? -1 : 0;
+  }
+  double alone_score = optimizer.score(candidates, threats, alone);
+
+  // print
+  std::cout << "--[Team movesets:] --" << std::endl;
+  uint32_t covered = 0;
+  for(size_t i = 0; i < team.size(); i++) {
+    std::cout << "  " << team[i].name_ << "  " << team[i].species_->name_ << ":";
+    if(plan.choices[i] < 0) {
+      std::cout << " no moves" << std::endl;
+      continue;
+    }
+    const Moveset& moveset = candidates[i][plan.choices[i]];
+    covered |= optimizer.getThreatHits(moveset);
+    std::cout << " [" << std::fixed << std::setprecision(2) << moveset.score << "]";
+    for(int j = 0; j < moveset.count; j++) {
+      std::cout << (j == 0 ? " " : ", ") << library.get(moveset.moves[j]).name_;
+    }
+    std::cout << std::endl;
+  }
+  std::cout << std::endl << "  Threats:";
+  for(int t = 0; t < kNullType; t++) {
+    if(weaknesses[t] > 0) {
+      std::cout << " " << resources::getTypeName((Type)t) << ((covered >> t) & 1 ? "" : " (uncovered)");
     }
-    return nonstab_moves;
   }
+  std::cout << std::endl << "  Score " << std::fixed << std::setprecision(2) << plan.score
+    << ", against " << alone_score << " picking alone" << std::endl;
+  session.close();
+  return 0;
 }
 
-std::vector<std::string> MoveRankings::pickNonDamaging(const Monster& monster) {
-  // get moves list
-  std::vector<std::string> moves = getMovesRatedAtLeast();
-  moves = analyzer_->filterMovesByNonDamaging(moves);
-  
-  // filter down two kinds of moves
-  std::vector<std::string> stat_changes = analyzer_->filterStatChangeMovesByMonster(moves, monster);
-  std::vector<std::string> unique = analyzer_->filterMovesByUtility(moves, monster);
-  moves.clear();
-  moves.insert(moves.begin(), stat_changes.begin(), stat_changes.end());
-  moves.insert(moves.begin(), unique.begin(), unique.end());
+MoveRankings::MoveRankings(const std::vector<MoveId>* moves, const std::vector<double>* ratings, const MovesetAnalyzer * analyzer) :
+  moves_(moves), ratings_(ratings), analyzer_(analyzer) {
+  assert(moves_ != nullptr);
+  assert(ratings_ != nullptr);
+  assert(analyzer_ != nullptr);
+  assert(moves_->size() == ratings_->size());
 
-  if(moves.empty()) {
-    return std::vector<std::string>();
-  } else {
-    return moves;
+  // orders start out unsorted; they are sorted as far as picks look.
+  by_rating_.resize(moves_->size());
+  for(int i = 0; i < (int)by_rating_.size(); i++) {
+    by_rating_[i] = i;
   }
+  by_power_ = by_pp_ = by_rating_;
+  by_rating_sorted_ = by_power_sorted_ = by_pp_sorted_ = 0;
+  pool_ = MoveSet(*moves_);
 }
 
-std::vector<std::string> MoveRankings::getMovesRatedAtLeast(double min_rating) {
-  std::vector<std::string> moves;
-  for(std::pair<std::string, double> pair : *rankings_) {
-    if(pair.second >= min_rating)
-      moves.push_back(pair.first);
-  }
-  return moves;
+std::vector<MoveId> MoveRankings::pickStabWithHighPP(Type type) {
+  const MoveLibrary& library = *analyzer_->move_library_;
+  return scan(&by_pp_, &by_pp_sorted_, [&](int a, int b) {
+    int pp_a = library.get((*moves_)[a]).pp_;
+    int pp_b = library.get((*moves_)[b]).pp_;
+    return pp_a != pp_b ? pp_a > pp_b : (*ratings_)[a] > (*ratings_)[b];
+  }, analyzer_->filterMovesByStab(pool_, type), MOVESET_QUADRANT_MOVES_TO_LIST);
+}
+
+std::vector<MoveId> MoveRankings::pickStabWithHighPower(Type type) {
+  const MoveLibrary& library = *analyzer_->move_library_;
+  return scan(&by_power_, &by_power_sorted_, [&](int a, int b) {
+    int power_a = library.get((*moves_)[a]).power_;
+    int power_b = library.get((*moves_)[b]).power_;
+    return power_a != power_b ? power_a > power_b : (*ratings_)[a] > (*ratings_)[b];
+  }, analyzer_->filterMovesByStab(pool_, type), MOVESET_QUADRANT_MOVES_TO_LIST);
+}
+
+std::vector<MoveId> MoveRankings::pickNonStabButStrong(TypesHad typing) {
+  MoveSet picks = pool_ - analyzer_->filterMovesByStab(pool_, typing) - analyzer_->filterMovesByNonDamaging(pool_);
+  return scanByRating(picks, MOVESET_QUADRANT_MOVES_TO_LIST);
 }
 
-std::vector<std::string> MoveRankings::getMovesSorted(double min_rating) {
-  return std::vector<std::string>(); // todo: later
+std::vector<MoveId> MoveRankings::pickNonDamaging(const Monster& monster) {
+  MoveSet nondamaging = analyzer_->filterMovesByNonDamaging(pool_);
+  MoveSet picks = analyzer_->filterStatChangeMovesByMonster(nondamaging, monster)
+    | analyzer_->filterMovesByUtility(nondamaging, monster);
+  return scanByRating(picks, MOVESET_QUADRANT_MOVES_TO_LIST);
 }
 
-bool MoveRankings::moveExistsInVector(const std::vector<std::string>& vector, const std::string & value) {
-  for(std::string string : vector) {
-    if(value.compare(string) == 0)
-      return true;
+std::vector<MoveId> MoveRankings::getMovesRatedAtLeast(double min_rating) {
+  return getMovesSorted(min_rating);
+}
+
+std::vector<MoveId> MoveRankings::getMovesSorted(double min_rating) {
+  return scanByRating(pool_, moves_->size(), min_rating);
+}
+
+std::vector<MoveId> MoveRankings::scanByRating(const MoveSet & picks, const size_t limit, const double min_rating) {
+  return scan(&by_rating_, &by_rating_sorted_, [&](int a, int b) {
+    return (*ratings_)[a] > (*ratings_)[b];
+  }, picks, limit, min_rating);
+}
+
+template <typename Compare>
+std::vector<MoveId> MoveRankings::scan(std::vector<int>* order, size_t* sorted, Compare compare, const MoveSet& picks, const size_t limit, const double min_rating) {
+  std::vector<MoveId> moves;
+  for(size_t i = 0; i < order->size() && moves.size() < limit; i++) {
+    if(i == *sorted) {
+      // sort further, doubling what has been sorted so far
+      sortPrefix(order, sorted, compare, std::max<size_t>(2 * i, MOVESET_QUADRANT_MOVES_TO_LIST));
+    }
+    int position = (*order)[i];
+    if((*ratings_)[position] >= min_rating && picks.contains((*moves_)[position])) {
+      moves.push_back((*moves_)[position]);
+    }
   }
-  return false;
+  return moves;
 }
+
+template <typename Compare>
+void MoveRankings::sortPrefix(std::vector<int>* order, size_t* sorted, Compare compare, const size_t count) {
+  if(count <= *sorted) {
+    return;
+  }
+  // ties go to the earlier move, so picks are the same however far it is sorted
+  auto stable_compare = [&](int a, int b) {
+    return compare(a, b) || (!compare(b, a) && a < b);
+  };
+  size_t end = std::min(count, order->size());
+  std::partial_sort(order->begin() + *sorted, order->begin() + end, order->end(), stable_compare);
+  *sorted = end;
 }
 }
+}
\ No newline at end of file
@@ -9,10 +9,19 @@
 #ifndef POKEMAN_MOVESET_ANALYSIS_HPP_
 #define POKEMAN_MOVESET_ANALYSIS_HPP_
 
+#include <bitset>
 #include <map>
+#include <ostream>
 #include <string>
+#include <vector>
 
+#include "damage_calculator.hpp"
+#include "moveset_optimizer.hpp"
+#include "moveset_table.hpp"
 #include "pokeman.hpp"
+#include "rating_cache.hpp"
+#include "scoring_expression.hpp"
+#include "setup_evaluator.hpp"
 
 namespace pokeman {
 namespace driver {
@@ -23,92 +32,184 @@ struct MovesetPicksNode {
 
 class MovesetAnalyzer {
 public:
-  std::map<std::string, Move> move_data_;
+  const MoveLibrary* move_library_;
+  const MoveCoverageTable* coverage_table_;
+
+  /// If set, damaging moves are rated by expected damage on the roster.
+  const DamageCalculator* damage_calculator_;
+  std::vector<const MonsterSpecies*> roster_;
+
+  /// If set, setup damage on the roster is shared through here.
+  SetupDamageTable* setup_damage_table_;
+
+  /// Only moves learnable by this level, the ways allowed, are considered.
+  int level_cap_;
+  LearnMethods learn_methods_;
+
+  /// Board the sets are for. Outside singles, spread moves are credited
+  /// for each foe they reach and damaging moves lose for each ally.
+  BattleFormat format_;
+  int board_position_;
+
+  /// If set, ratings are looked up here first, under rating_version_.
+  RatingCache* rating_cache_;
+  uint32_t rating_version_;
+
+  /// If set, moves are rated by this instead of the built in formula.
+  const ScoringExpression* rating_expression_;
+
+  /// If set, recommended sets are taken from here when nothing is locked.
+  const MovesetTable* moveset_table_;
 
 public:
-  
-  std::vector<std::string> getStrongMoves(const TypeChart& chart, const Monster& monster) const;
+  MovesetAnalyzer();
+
+  MoveSet getStrongMoves(const TypeChart& chart, const Monster& monster) const;
 
-  std::vector<std::string> filterMovesByType(const std::vector<std::string>& moves, const MoveType type) const;
+  MoveSet filterMovesByType(const MoveSet& moves, const MoveType type) const;
 
-  std::vector<std::string> filterMovesByStab(const std::vector<std::string>& moves, const TypesHad& typing) const;
+  MoveSet filterMovesByStab(const MoveSet& moves, const TypesHad& typing) const;
 
-  std::vector<std::string> filterMovesByNonDamaging(const std::vector<std::string>& moves) const;
+  MoveSet filterMovesByNonDamaging(const MoveSet& moves) const;
 
   /// Seeks out moves that have a buff towards the monster.
-  std::vector<std::string> filterStatChangeMovesByMonster(const std::vector<std::string>& moves, const Monster& monster) const;
+  MoveSet filterStatChangeMovesByMonster(const MoveSet& moves, const Monster& monster) const;
   
   /// Seeks out moves that have some unquantifiable utility
-  std::vector<std::string> filterMovesByUtility(const std::vector<std::string>& moves, const Monster& monster) const;
+  MoveSet filterMovesByUtility(const MoveSet& moves, const Monster& monster) const;
+
+  std::list<Type> getMoveSupereffectiveTypes(const TypeChart& chart, const MoveId move_id) const;
+
+  std::string moveToString(const MoveId move_id) const;
+
+  void printMovesetAnalysis(const TypeChart& chart, const Monster& monster, std::ostream& out) const;
 
-  std::list<Type> getMoveSupereffectiveTypes(const TypeChart& chart, const std::string& move_name) const;
+  /// Best full movesets, keeping locked moves.
+  std::vector<Moveset> findBestMovesets(const Monster& monster) const;
 
-  std::string moveToString(std::string move_name) const;
+  /// Up to count of the best full movesets, worked out fresh.
+  std::vector<Moveset> findCandidateMovesets(const Monster& monster, const size_t count) const;
 
-  void printMovesetAnalysis(const TypeChart& chart, const Monster& monster) const;
+  /// Puts each kept move in the quadrant it fills best, with no two
+  /// sharing one. Sets kept to the move in each quadrant, or kNullMoveId,
+  /// and returns the quadrants taken.
+  std::bitset<4> analyzeHMniches(const Monster& monster, std::vector<MoveId>* kept) const;
+
+  /// Multiplier on each move's rating for the format and board position.
+  std::vector<double> getFormatMultipliers(const std::vector<MoveId>& moves) const;
+
+  /// Stamp of the rating rules, the moves and the roster, for cache keys.
+  uint32_t getRatingVersion() const;
+
+  /// Stamp for precomputed sets: the rating version, and every species'
+  /// learnset.
+  uint32_t getMovesetVersion() const;
 
 private:
-  bool getMoveIfExists(const std::string& string, Move* move_dest) const;
+  void printFourMovePicksForMonotyped(const std::vector<MoveId>& moves, const Monster& monster, std::ostream& out) const;
 
-  void printFourMovePicksForMonotyped(const std::vector<std::string>& moves, const Monster& monster) const;
+  void printFourMovePicksForDualtyped(const std::vector<MoveId>& moves, const Monster& monster, std::ostream& out) const;
 
-  void printFourMovePicksForDualtyped(const std::vector<std::string>& moves, const Monster& monster) const;
+  /// picks must be sorted. A quadrant with a kept move lists only that
+  /// move; the others leave out every kept move.
+  std::vector<MoveId> getPicks(const std::vector<MoveId>& picks, const std::vector<MoveId>& kept, const unsigned int slot) const;
 
-  /// picks must be sorted.
-  std::vector<std::string> getPicks(const std::vector<std::string>& picks, const Monster& monster, const bool isHM, const unsigned int slot) const;
+  void printPicks(const std::vector<std::vector<MoveId>>& picks, const std::vector<MovesetPicksNode>& meta, std::ostream& out) const;
 
-  void printPicks(const std::vector<std::vector<std::string>>& picks, const std::vector<MovesetPicksNode>& meta) const;
+  /// Prints the best full movesets, keeping locked moves.
+  void printBestMovesets(const TypeChart& chart, const Monster& monster, std::ostream& out) const;
 
-  std::map<std::string, double> getMoveRatings(const std::vector<std::string>& moves, const Monster& monster) const;
+  /// Readies an evaluator for the monster against the roster. False if
+  /// there is no damage calculator or roster to do it with.
+  bool prepareSetupEvaluator(const Monster& monster, SetupEvaluator* evaluator) const;
 
-  static std::bitset<4> analyzeHMniches(const Monster& monster);
+  /// Moves the monster could know, under the level cap.
+  MoveIdSpan getMovepool(const Monster& monster) const;
 
-  static bool isStab(const Move move, const TypesHad& typing);
+  /// Moves that are kept in every moveset.
+  std::vector<MoveId> getLockedMoves(const Monster& monster) const;
 
-  static bool isNonDamaging(const Move move);
+  std::vector<double> getMoveRatings(const std::vector<MoveId>& moves, const Monster& monster) const;
 
-  static bool isUtility(const Move move);
+  /// Rates moves without the cache.
+  std::vector<double> computeMoveRatings(const std::vector<MoveId>& moves, const Monster& monster) const;
 
-  static bool hasStatModifier(const Move move);
+  /// Rates moves with the built in formula.
+  std::vector<double> builtinMoveRatings(const std::vector<MoveId>& moves, const Monster& monster) const;
 
-  static double accuracyRating(const Move move);
+  /// Rates moves with rating_expression_, all in one batch.
+  std::vector<double> evaluateMoveRatings(const std::vector<MoveId>& moves, const Monster& monster) const;
 
-  static double moveRating(const Monster& monster, const Move move);
+  /// How well a move fills a quadrant, from 0 up.
+  double getNicheFit(const Monster& monster, const MoveId move_id, const int quadrant) const;
+
+  static double accuracyRating(const Move& move);
+
+  static double moveRating(const Monster& monster, const Move& move);
   
   static bool suitedToPhysical(const Monster& monster);
 
   static bool suitedToSpecial(const Monster& monster);
 
-  static bool suitedToMoveTypeRating(const Monster& monster, const Move move);
+  static bool suitedToMoveTypeRating(const Monster& monster, const Move& move);
 
 };
 
 class MoveRankings {
 private:
-  const std::map<std::string, double>* rankings_;
+  /// Rated moves, and their ratings.
+  const std::vector<MoveId>* moves_;
+  const std::vector<double>* ratings_;
   const MovesetAnalyzer* analyzer_;
 
+  /// Rated moves, as a set.
+  MoveSet pool_;
+
+  /// Orders of positions in moves_, sorted only as far as *_sorted_.
+  std::vector<int> by_rating_;
+  std::vector<int> by_power_;
+  std::vector<int> by_pp_;
+  size_t by_rating_sorted_;
+  size_t by_power_sorted_;
+  size_t by_pp_sorted_;
+
 public:
-  MoveRankings(const std::map<std::string, double>* rankings, const MovesetAnalyzer* analyzer);
+  /// Ratings must line up with moves. Both must outlive the rankings.
+  MoveRankings(const std::vector<MoveId>* moves, const std::vector<double>* ratings, const MovesetAnalyzer* analyzer);
 
-  std::vector<std::string> pickStabWithHighPP(Type type);
+  std::vector<MoveId> pickStabWithHighPP(Type type);
 
-  std::vector<std::string> pickStabWithHighPower(Type type);
+  std::vector<MoveId> pickStabWithHighPower(Type type);
 
-  std::vector<std::string> pickNonStabButStrong(TypesHad typing);
+  std::vector<MoveId> pickNonStabButStrong(TypesHad typing);
 
-  std::vector<std::string> pickNonDamaging(const Monster& monster);
+  std::vector<MoveId> pickNonDamaging(const Monster& monster);
 
 private:
-  std::vector<std::string> getMovesRatedAtLeast(double min_rating = 0.0);
+  std::vector<MoveId> getMovesRatedAtLeast(double min_rating = 0.0);
+
+  std::vector<MoveId> getMovesSorted(double min_rating = 0.0);
+
+  /// Walks an order from the top, collecting up to limit moves that are
+  /// rated at least min_rating and in the set.
+  template <typename Compare>
+  std::vector<MoveId> scan(std::vector<int>* order, size_t* sorted, Compare compare, const MoveSet& picks, const size_t limit, const double min_rating = 0.0);
 
-  std::vector<std::string> getMovesSorted(double min_rating = 0.0);
+  std::vector<MoveId> scanByRating(const MoveSet& picks, const size_t limit, const double min_rating = 0.0);
 
-  static bool moveExistsInVector(const std::vector<std::string>& vector, const std::string& value);
+  /// Makes sure the first count entries of an order are sorted.
+  template <typename Compare>
+  static void sortPrefix(std::vector<int>* order, size_t* sorted, Compare compare, const size_t count);
 
 };
 
 int moveset_analysis(int argc, const char* argv[]);
+
+/// Works out recommended sets for every species and saves them.
+int moveset_all_analysis(int argc, const char* argv[]);
+
+/// Picks sets for the whole team together, to cover its weaknesses.
+int team_moveset_analysis(int argc, const char* argv[]);
 } // namespace driver
 } // namespace pokeman
 
@@ -0,0 +1,203 @@
+/*
+* moveset_optimizer.cpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*/
+#include "moveset_optimizer.hpp"
+
+#include <cassert>
+
+#include <algorithm>
+
+#include "setup_evaluator.hpp"
+
+namespace pokeman {
+
+MovesetWeights::MovesetWeights() {
+  coverage = 0.1;
+  walls = 0.1;
+  stab = 1.5;
+  power = 2.0;
+  utility = 1.0;
+  setup = 1.0;
+}
+
+MovesetOptimizer::MovesetOptimizer() : move_library_(nullptr), coverage_table_(nullptr), setup_evaluator_(nullptr) {}
+
+std::vector<Moveset> MovesetOptimizer::findBest(const Monster & monster, const MoveIdSpan movepool,
+  const std::vector<MoveId>& locked, const size_t max_results) const {
+  assert(move_library_ != nullptr);
+  assert(coverage_table_ != nullptr);
+  assert(monster.species_ != nullptr);
+  std::vector<Moveset> results;
+  if(max_results == 0) {
+    return results;
+  }
+
+  // start the set off with the locked moves
+  Search search;
+  search.current.count = 0;
+  search.current.score = 0.0;
+  search.attack_count = 0;
+  search.additive = 0.0;
+  search.utility_count = 0;
+  for(MoveId id : locked) {
+    if(search.current.count == MOVESET_SIZE)
+      break;
+    add(&search, scoreMove(monster, id));
+  }
+
+  // gather candidates, best bound first
+  std::vector<MoveId> pool = movepool.toVector();
+  std::sort(pool.begin(), pool.end());
+  pool.erase(std::unique(pool.begin(), pool.end()), pool.end());
+  std::vector<MoveScore> candidates;
+  candidates.reserve(pool.size());
+  for(MoveId id : pool) {
+    if(std::find(locked.begin(), locked.end(), id) == locked.end())
+      candidates.push_back(scoreMove(monster, id));
+  }
+  std::stable_sort(candidates.begin(), candidates.end(), [](const MoveScore& a, const MoveScore& b) {
+    return a.upper_bound > b.upper_bound;
+  });
+
+  // search, widely enough to rescore if need be
+  bool rescore = setup_evaluator_ != nullptr && weights_.setup != 0.0;
+  search.candidates = &candidates;
+  search.slots = std::min(MOVESET_SIZE - search.current.count, (int)candidates.size());
+  search.max_results = rescore ? max_results * MOVESET_SETUP_RESCORE : max_results;
+  search.results = &results;
+  branch(&search, 0, 0);
+  if(rescore) {
+    rescoreForSetup(&results, max_results);
+  }
+  return results;
+}
+
+double MovesetOptimizer::score(const Monster & monster, const MoveId * moves, const int count) const {
+  Search search;
+  search.current.count = 0;
+  search.attack_count = 0;
+  search.additive = 0.0;
+  search.utility_count = 0;
+  for(int i = 0; i < count && i < MOVESET_SIZE; i++) {
+    add(&search, scoreMove(monster, moves[i]));
+  }
+  return combine(search);
+}
+
+MovesetOptimizer::MoveScore MovesetOptimizer::scoreMove(const Monster & monster, const MoveId id) const {
+  const Move& move = move_library_->get(id);
+  MoveFlags flags = move_library_->getFlags(id);
+  MoveScore move_score;
+  move_score.id = id;
+  move_score.additive = 0.0;
+  move_score.utility = (flags & kMoveDamaging) == 0;
+  move_score.attacks = coverage_table_->hasEntry(id);
+
+  if(!move_score.utility) {
+    // same type attack bonus
+    const TypesHad& typing = monster.species_->type_;
+    if(move.elemental_type_ == typing.first_type_ || (typing.b_dual_type_ && move.elemental_type_ == typing.second_type_)) {
+      move_score.additive += weights_.stab;
+    }
+
+    // power, by how likely it hits and how well the user can use it
+    const MonsterStats& stats = monster.species_->base_stats_;
+    int best_stat = std::max(stats.attack_, stats.special_attack_);
+    int stat = move.move_type_ == kSpecial ? stats.special_attack_ : stats.attack_;
+    double stat_factor = best_stat > 0 ? (double)stat / best_stat : 1.0;
+    double accuracy = move.accuracy_ < 0 ? 1.0 : (double)move.accuracy_ / 100;
+    move_score.additive += weights_.power * ((double)move.power_ / 100) * accuracy * stat_factor;
+  }
+
+  move_score.upper_bound = weights_.coverage * coverage_table_->getSuperEffective(id).count() + move_score.additive
+    + (move_score.utility ? weights_.utility : 0.0);
+  return move_score;
+}
+
+double MovesetOptimizer::combine(const Search & search, const bool count_walls) const {
+  double score = weights_.coverage * search.coverage.count() + search.additive
+    + (search.utility_count > 0 ? weights_.utility : 0.0);
+  if(count_walls && search.attack_count > 0) {
+    score -= weights_.walls * search.walls.count();
+  }
+  return score;
+}
+
+void MovesetOptimizer::add(Search * search, const MoveScore & move_score) const {
+  search->current.moves[search->current.count++] = move_score.id;
+  search->coverage |= coverage_table_->getSuperEffective(move_score.id);
+  if(move_score.attacks) {
+    const TypingSet& resisted = coverage_table_->getResisted(move_score.id);
+    search->walls = search->attack_count == 0 ? resisted : (search->walls & resisted);
+    search->attack_count++;
+  }
+  search->additive += move_score.additive;
+  search->utility_count += move_score.utility ? 1 : 0;
+}
+
+/// Picks candidates in order, so that a set is visited once. Coverage only
+/// grows by union, so a move can add at most its own bound to a set; since
+/// candidates are sorted by bound, the next few bounds are the most any
+/// completion can add, and the loop stops once that can't beat the results.
+void MovesetOptimizer::branch(Search * search, const size_t start, const int depth) const {
+  const std::vector<MoveScore>& candidates = *search->candidates;
+  if(depth == search->slots) {
+    offer(search, combine(*search));
+    return;
+  }
+
+  const int remaining = search->slots - depth;
+  const double current = combine(*search, false);
+  for(size_t i = start; i + remaining <= candidates.size(); i++) {
+    // prune
+    if(search->results->size() == search->max_results) {
+      double bound = current;
+      for(int j = 0; j < remaining; j++) {
+        bound += candidates[i + j].upper_bound;
+      }
+      if(bound <= search->results->back().score)
+        break;
+    }
+
+    // add the move
+    Search previous = *search;
+    add(search, candidates[i]);
+
+    branch(search, i + 1, depth + 1);
+
+    // take it back
+    *search = previous;
+  }
+}
+
+void MovesetOptimizer::offer(Search * search, const double score) {
+  std::vector<Moveset>& results = *search->results;
+  if(results.size() == search->max_results && score <= results.back().score) {
+    return;
+  }
+
+  // insert in order
+  Moveset moveset = search->current;
+  moveset.score = score;
+  std::vector<Moveset>::iterator it = std::upper_bound(results.begin(), results.end(), moveset,
+    [](const Moveset& a, const Moveset& b) { return a.score > b.score; });
+  results.insert(it, moveset);
+  if(results.size() > search->max_results)
+    results.pop_back();
+}
+
+void MovesetOptimizer::rescoreForSetup(std::vector<Moveset>* results, const size_t max_results) const {
+  for(Moveset& moveset : *results) {
+    moveset.score += weights_.setup * setup_evaluator_->evaluate(moveset.moves, moveset.count);
+  }
+  std::stable_sort(results->begin(), results->end(), [](const Moveset& a, const Moveset& b) {
+    return a.score > b.score;
+  });
+  if(results->size() > max_results)
+    results->resize(max_results);
+}
+
+} // namespace pokeman
@@ -0,0 +1,120 @@
+/*
+* moveset_optimizer.hpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*
+* Searches a monster's movepool for the best full sets of moves.
+*/
+#ifndef POKEMAN_MOVESET_OPTIMIZER_HPP_
+#define POKEMAN_MOVESET_OPTIMIZER_HPP_
+
+#include <vector>
+
+#include "pokeman.hpp"
+
+/// With a setup evaluator, this many times the sets asked for are found,
+/// then rescored with setup damage.
+#define MOVESET_SETUP_RESCORE 4
+
+namespace pokeman {
+
+class SetupEvaluator;
+
+/// A set of up to four moves, with its score.
+struct Moveset {
+  MoveId moves[MOVESET_SIZE];
+  int count;
+  double score;
+};
+
+/// How much each aspect of a moveset is worth.
+struct MovesetWeights {
+  /// per typing hit super effectively by any move
+  double coverage;
+
+  /// per typing that resists every damaging move, taken off
+  double walls;
+
+  /// per damaging move sharing a type with the user
+  double stab;
+
+  /// per 100 accuracy-weighted power, scaled by the user's attacking stat
+  double power;
+
+  /// for having at least one non damaging move
+  double utility;
+
+  /// per target's hp of expected damage over the setup evaluator's turns
+  double setup;
+
+  /// Default weights.
+  MovesetWeights();
+};
+
+class MovesetOptimizer {
+public:
+  const MoveLibrary* move_library_;
+  const MoveCoverageTable* coverage_table_;
+  MovesetWeights weights_;
+
+  /// If set, sets are also rated by how well they set up and sweep. It must
+  /// be prepared for the monster, and is used from this thread only.
+  SetupEvaluator* setup_evaluator_;
+
+private:
+  /// Scoring info of one candidate move.
+  struct MoveScore {
+    MoveId id;
+    bool attacks;
+    double additive;
+    bool utility;
+    double upper_bound;
+  };
+
+  /// State of the branch and bound search.
+  struct Search {
+    const std::vector<MoveScore>* candidates;
+    Moveset current;
+    TypingSet coverage;
+    TypingSet walls;
+    int attack_count;
+    double additive;
+    int utility_count;
+    int slots;
+    size_t max_results;
+    std::vector<Moveset>* results;
+  };
+
+public:
+  MovesetOptimizer();
+
+  /// Finds up to max_results of the best sets for the monster.
+  /// Locked moves are part of every set, and take up slots.
+  /// Results are sorted with the best first.
+  std::vector<Moveset> findBest(const Monster& monster, const MoveIdSpan movepool,
+    const std::vector<MoveId>& locked, const size_t max_results) const;
+
+  /// Scores a set of moves for the monster.
+  double score(const Monster& monster, const MoveId* moves, const int count) const;
+
+private:
+  MoveScore scoreMove(const Monster& monster, const MoveId id) const;
+
+  /// Score of the search's current set. Bounds leave out the walls
+  /// penalty, since it is never negative.
+  double combine(const Search& search, const bool count_walls = true) const;
+
+  void add(Search* search, const MoveScore& move_score) const;
+
+  void branch(Search* search, const size_t start, const int depth) const;
+
+  static void offer(Search* search, const double score);
+
+  /// Adds setup damage to each score, then keeps the best max_results.
+  void rescoreForSetup(std::vector<Moveset>* results, const size_t max_results) const;
+};
+
+} // namespace pokeman
+
+#endif //POKEMAN_MOVESET_OPTIMIZER_HPP_
@@ -0,0 +1,127 @@
+/*
+* moveset_table.cpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*/
+#include "moveset_table.hpp"
+
+#include <cstdlib>
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#define MOVESET_TABLE_MAGIC "#pokeman-movesets"
+#define MOVESET_TABLE_HEADER "number,species,rank,score,move1,move2,move3,move4"
+
+namespace pokeman {
+
+/// Splits a CSV line. Fields never hold commas.
+static std::vector<std::string> splitFields(const std::string& line) {
+  std::vector<std::string> fields;
+  std::stringstream stream(line);
+  std::string field;
+  while(std::getline(stream, field, ',')) {
+    fields.push_back(field);
+  }
+  if(!line.empty() && line.back() == ',') {
+    fields.push_back("");
+  }
+  return fields;
+}
+
+MovesetTable::MovesetTable() : version_(0), level_(POKEMAN_DEFAULT_LEVEL), level_cap_(POKEMAN_MAX_LEVEL), learn_methods_(kAllLearnMethods) {}
+
+const std::vector<Moveset>* MovesetTable::find(const int species_number) const {
+  std::map<int, std::vector<Moveset>>::const_iterator it = movesets_.find(species_number);
+  return it == movesets_.end() ? nullptr : &it->second;
+}
+
+void MovesetTable::set(const int species_number, const std::vector<Moveset>& movesets) {
+  movesets_[species_number] = movesets;
+}
+
+size_t MovesetTable::size() const {
+  return movesets_.size();
+}
+
+bool MovesetTable::matches(const uint32_t version, const int level_cap, const LearnMethods learn_methods) const {
+  return version_ == version && level_cap_ == level_cap && learn_methods_ == learn_methods;
+}
+
+bool MovesetTable::save(const std::string & filepath, const MoveLibrary & moves, const MonsterSpeciesLibrary & species) const {
+  std::ofstream file(filepath, std::ios::trunc);
+  if(!file) {
+    return false;
+  }
+  file << MOVESET_TABLE_MAGIC << "," << version_ << "," << level_ << "," << level_cap_ << "," << (int)learn_methods_ << "\n";
+  file << MOVESET_TABLE_HEADER << "\n";
+  file << std::fixed << std::setprecision(4);
+  for(const std::pair<const int, std::vector<Moveset>>& entry : movesets_) {
+    const MonsterSpecies* monster_species = species.get(entry.first);
+    const std::string name = monster_species == nullptr ? "" : monster_species->name_;
+    for(size_t rank = 0; rank < entry.second.size(); rank++) {
+      const Moveset& moveset = entry.second[rank];
+      file << entry.first << "," << name << "," << (rank + 1) << "," << moveset.score;
+      for(int i = 0; i < MOVESET_SIZE; i++) {
+        file << "," << (i < moveset.count ? moves.get(moveset.moves[i]).name_ : "");
+      }
+      file << "\n";
+    }
+  }
+  return (bool)file;
+}
+
+bool MovesetTable::load(const std::string & filepath, const MoveLibrary & moves) {
+  std::ifstream file(filepath);
+  if(!file) {
+    return false;
+  }
+
+  // stamp and header
+  std::string line;
+  std::getline(file, line);
+  std::vector<std::string> stamp = splitFields(line);
+  if(stamp.size() != 5 || stamp[0] != MOVESET_TABLE_MAGIC) {
+    return false;
+  }
+  std::getline(file, line);
+  if(line != MOVESET_TABLE_HEADER) {
+    return false;
+  }
+  version_ = (uint32_t)std::strtoul(stamp[1].c_str(), nullptr, 10);
+  level_ = std::atoi(stamp[2].c_str());
+  level_cap_ = std::atoi(stamp[3].c_str());
+  learn_methods_ = (LearnMethods)std::atoi(stamp[4].c_str());
+
+  // rows, in rank order
+  movesets_.clear();
+  while(std::getline(file, line)) {
+    if(line.empty())
+      continue;
+    std::vector<std::string> fields = splitFields(line);
+    if(fields.size() != 4 + MOVESET_SIZE) {
+      movesets_.clear();
+      return false;
+    }
+    Moveset moveset;
+    moveset.count = 0;
+    moveset.score = std::atof(fields[3].c_str());
+    for(int i = 0; i < MOVESET_SIZE; i++) {
+      const std::string& name = fields[4 + i];
+      if(name.empty())
+        continue;
+      MoveId id = moves.getId(name);
+      if(id == kNullMoveId) {
+        movesets_.clear();
+        return false;
+      }
+      moveset.moves[moveset.count++] = id;
+    }
+    movesets_[std::atoi(fields[0].c_str())].push_back(moveset);
+  }
+  return true;
+}
+
+} // namespace pokeman
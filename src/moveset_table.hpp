@@ -0,0 +1,64 @@
+/*
+* moveset_table.hpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*
+* Recommended movesets for every species, worked out ahead of time and
+* kept as a CSV file.
+*/
+#ifndef POKEMAN_MOVESET_TABLE_HPP_
+#define POKEMAN_MOVESET_TABLE_HPP_
+
+#include <cstdint>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "moveset_optimizer.hpp"
+#include "pokeman.hpp"
+
+namespace pokeman {
+
+class MovesetTable {
+public:
+  /// Stamp of the data and rules the sets came from.
+  uint32_t version_;
+
+  /// Level of the monsters the sets were picked for; they are only good
+  /// for monsters of that level.
+  int level_;
+
+  /// Limits the sets were picked under.
+  int level_cap_;
+  LearnMethods learn_methods_;
+
+private:
+  /// Best sets of each species, best first, by pokedex number.
+  std::map<int, std::vector<Moveset>> movesets_;
+
+public:
+  MovesetTable();
+
+  /// Sets for the species, or nullptr if it has no entry.
+  const std::vector<Moveset>* find(const int species_number) const;
+
+  void set(const int species_number, const std::vector<Moveset>& movesets);
+
+  size_t size() const;
+
+  /// True, if made under the same version and limits.
+  bool matches(const uint32_t version, const int level_cap, const LearnMethods learn_methods) const;
+
+  /// Writes one row per set: number, species, rank, score and moves.
+  bool save(const std::string& filepath, const MoveLibrary& moves, const MonsterSpeciesLibrary& species) const;
+
+  /// Reads a saved table. False, if the file is missing, malformed or
+  /// names moves the library doesn't have.
+  bool load(const std::string& filepath, const MoveLibrary& moves);
+};
+
+} // namespace pokeman
+
+#endif //POKEMAN_MOVESET_TABLE_HPP_
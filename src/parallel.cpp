@@ -0,0 +1,53 @@
+/*
+* parallel.cpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*/
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace pokeman {
+namespace parallel {
+unsigned int defaultThreadCount() {
+  unsigned int count = std::thread::hardware_concurrency();
+  return count == 0 ? 1 : count;
+}
+
+void forEachIndex(const size_t count, const std::function<void(size_t)>& task, unsigned int thread_count) {
+  if(thread_count == 0) {
+    thread_count = defaultThreadCount();
+  }
+  thread_count = (unsigned int)std::min<size_t>(thread_count, count);
+
+  // small jobs aren't worth a thread
+  if(thread_count <= 1) {
+    for(size_t i = 0; i < count; i++) {
+      task(i);
+    }
+    return;
+  }
+
+  // workers pull the next index until there are none left
+  std::atomic<size_t> next(0);
+  auto work = [&]() {
+    for(size_t i = next++; i < count; i = next++) {
+      task(i);
+    }
+  };
+  std::vector<std::thread> workers;
+  workers.reserve(thread_count - 1);
+  for(unsigned int i = 1; i < thread_count; i++) {
+    workers.emplace_back(work);
+  }
+  work();
+  for(std::thread& worker : workers) {
+    worker.join();
+  }
+}
+} // namespace parallel
+} // namespace pokeman
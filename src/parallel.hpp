@@ -0,0 +1,29 @@
+/*
+* parallel.hpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*
+* Runs independent pieces of work across a pool of worker threads.
+*/
+#ifndef POKEMAN_PARALLEL_HPP_
+#define POKEMAN_PARALLEL_HPP_
+
+#include <cstddef>
+
+#include <functional>
+
+namespace pokeman {
+namespace parallel {
+/// Number of workers used when none is asked for.
+unsigned int defaultThreadCount();
+
+/// Calls task(i) for every i in [0, count), spread across worker threads.
+/// Returns once every call has finished. Each index is handed out once, in
+/// increasing order, so tasks should write only to their own slot.
+/// A thread_count of 0 uses defaultThreadCount().
+void forEachIndex(const size_t count, const std::function<void(size_t)>& task, unsigned int thread_count = 0);
+} // namespace parallel
+} // namespace pokeman
+
+#endif //POKEMAN_PARALLEL_HPP_
@@ -0,0 +1,379 @@
+/*
+* pmdb.cpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*/
+#include "pmdb.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cassert>
+#include <cstring>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+
+#include "resources.hpp"
+
+namespace pokeman {
+namespace resources {
+
+namespace {
+
+/// True, if count records of a size fit in the file at offset.
+bool sectionFits(const uint32_t offset, const uint32_t count, const size_t record_size, const size_t file_size) {
+  return offset >= sizeof(PmdbHeader) && offset % 4 == 0
+    && (uint64_t)offset + (uint64_t)count * record_size <= file_size;
+}
+
+bool fail(std::string* error, const std::string& message) {
+  if(error != nullptr)
+    *error = message;
+  return false;
+}
+
+/// Packs strings end to end, each once.
+class StringTable {
+private:
+  std::string bytes_;
+  std::map<std::string, uint32_t, std::less<>> offsets_;
+
+public:
+  uint32_t add(const std::string_view string) {
+    std::map<std::string, uint32_t, std::less<>>::const_iterator it = offsets_.find(string);
+    if(it != offsets_.end()) {
+      return it->second;
+    }
+    uint32_t offset = (uint32_t)bytes_.size();
+    bytes_.append(string);
+    bytes_.push_back('\0');
+    offsets_.emplace(string, offset);
+    return offset;
+  }
+
+  const std::string& getBytes() const {
+    return bytes_;
+  }
+};
+
+void copyStats(const MonsterStats& stats, int32_t out[6]) {
+  out[0] = stats.hp_;
+  out[1] = stats.attack_;
+  out[2] = stats.defense_;
+  out[3] = stats.special_attack_;
+  out[4] = stats.special_defense_;
+  out[5] = stats.speed_;
+}
+
+template<typename T>
+void appendRecords(const std::vector<T>& records, std::string* body) {
+  body->append(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(T));
+}
+
+} // namespace
+
+PmdbFile::PmdbFile() : data_(nullptr), size_(0), mapped_(false) {}
+
+PmdbFile::~PmdbFile() {
+  close();
+}
+
+bool PmdbFile::open(const std::string & filepath, std::string * error) {
+  close();
+#ifdef _WIN32
+  std::ifstream file(filepath, std::ios::binary);
+  if(!file) {
+    return fail(error, "cannot open " + filepath);
+  }
+  buffer_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  data_ = buffer_.data();
+  size_ = buffer_.size();
+#else
+  int descriptor = ::open(filepath.c_str(), O_RDONLY);
+  if(descriptor < 0) {
+    return fail(error, "cannot open " + filepath);
+  }
+  struct stat status;
+  if(fstat(descriptor, &status) != 0 || status.st_size < (off_t)sizeof(PmdbHeader)) {
+    ::close(descriptor);
+    return fail(error, filepath + " is too short");
+  }
+  void* mapping = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+  ::close(descriptor); // the mapping keeps the file
+  if(mapping == MAP_FAILED) {
+    return fail(error, "cannot map " + filepath);
+  }
+  data_ = static_cast<const uint8_t*>(mapping);
+  size_ = (size_t)status.st_size;
+  mapped_ = true;
+#endif
+
+  if(!validate(error)) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void PmdbFile::close() {
+#ifndef _WIN32
+  if(mapped_) {
+    munmap(const_cast<uint8_t*>(data_), size_);
+  }
+#endif
+  buffer_.clear();
+  data_ = nullptr;
+  size_ = 0;
+  mapped_ = false;
+}
+
+const PmdbHeader & PmdbFile::getHeader() const {
+  assert(data_ != nullptr);
+  return *reinterpret_cast<const PmdbHeader*>(data_);
+}
+
+const PmdbMove * PmdbFile::getMoves() const {
+  return reinterpret_cast<const PmdbMove*>(data_ + getHeader().moves_offset);
+}
+
+const PmdbSpecies * PmdbFile::getSpecies() const {
+  return reinterpret_cast<const PmdbSpecies*>(data_ + getHeader().species_offset);
+}
+
+const PmdbLearnsetMove * PmdbFile::getLearnset() const {
+  return reinterpret_cast<const PmdbLearnsetMove*>(data_ + getHeader().learnset_offset);
+}
+
+const PmdbTeamMember * PmdbFile::getTeam() const {
+  return reinterpret_cast<const PmdbTeamMember*>(data_ + getHeader().team_offset);
+}
+
+const MoveId * PmdbFile::getTeamMoves() const {
+  return reinterpret_cast<const MoveId*>(data_ + getHeader().team_moves_offset);
+}
+
+const char * PmdbFile::getString(const uint32_t offset) const {
+  assert(offset < getHeader().string_bytes);
+  return reinterpret_cast<const char*>(data_ + getHeader().strings_offset + offset);
+}
+
+/// Everything the loader reads by offset or id is checked here, so the
+/// accessors can trust the file.
+bool PmdbFile::validate(std::string * error) const {
+  if(size_ < sizeof(PmdbHeader)) {
+    return fail(error, "file is too short");
+  }
+  const PmdbHeader& header = getHeader();
+  if(std::memcmp(header.magic, PMDB_MAGIC, sizeof(header.magic)) != 0) {
+    return fail(error, "not a compiled database");
+  }
+  if(header.format != PMDB_FORMAT_VERSION) {
+    return fail(error, "format " + std::to_string(header.format) + " is not " + std::to_string(PMDB_FORMAT_VERSION));
+  }
+  if(!sectionFits(header.moves_offset, header.move_count, sizeof(PmdbMove), size_)
+    || !sectionFits(header.species_offset, header.species_count, sizeof(PmdbSpecies), size_)
+    || !sectionFits(header.learnset_offset, header.learnset_count, sizeof(PmdbLearnsetMove), size_)
+    || !sectionFits(header.team_offset, header.team_count, sizeof(PmdbTeamMember), size_)
+    || !sectionFits(header.team_moves_offset, header.team_move_count, sizeof(MoveId), size_)
+    || !sectionFits(header.strings_offset, header.string_bytes, 1, size_)) {
+    return fail(error, "a section runs past the end of the file");
+  }
+  if(header.checksum != getPmdbChecksum(data_ + sizeof(PmdbHeader), size_ - sizeof(PmdbHeader))) {
+    return fail(error, "checksum does not match");
+  }
+  if(header.string_bytes == 0 || data_[header.strings_offset + header.string_bytes - 1] != '\0') {
+    return fail(error, "string table is not terminated");
+  }
+
+  // references between records
+  const int32_t move_count = (int32_t)header.move_count;
+  for(uint32_t i = 0; i < header.move_count; i++) {
+    const PmdbMove& move = getMoves()[i];
+    if(move.name >= header.string_bytes || move.move_type < 0 || move.move_type >= kNullMoveType
+      || move.elemental_type < 0 || move.elemental_type >= kNullType
+      || move.target < 0 || move.target >= kNullTargetDescription) {
+      return fail(error, "move " + std::to_string(i) + " is malformed");
+    }
+  }
+  for(uint32_t i = 0; i < header.species_count; i++) {
+    const PmdbSpecies& species = getSpecies()[i];
+    // a single type leaves the second one null
+    if(species.name >= header.string_bytes || species.first_type < 0 || species.first_type >= kNullType
+      || (species.dual_type != 0 && (species.second_type < 0 || species.second_type >= kNullType))
+      || (uint64_t)species.learnset_first + species.learnset_count > header.learnset_count) {
+      return fail(error, "species " + std::to_string(i) + " is malformed");
+    }
+  }
+  for(uint32_t i = 0; i < header.learnset_count; i++) {
+    const PmdbLearnsetMove& move = getLearnset()[i];
+    if(move.move_name >= header.string_bytes || move.tutor_memo >= header.string_bytes
+      || move.move_id < kNullMoveId || move.move_id >= move_count) {
+      return fail(error, "learnset entry " + std::to_string(i) + " is malformed");
+    }
+  }
+  for(uint32_t i = 0; i < header.team_count; i++) {
+    const PmdbTeamMember& member = getTeam()[i];
+    if(member.name >= header.string_bytes || (uint64_t)member.moves_first + member.moves_count > header.team_move_count) {
+      return fail(error, "team member " + std::to_string(i) + " is malformed");
+    }
+  }
+  for(uint32_t i = 0; i < header.team_move_count; i++) {
+    if(getTeamMoves()[i] < 0 || getTeamMoves()[i] >= move_count) {
+      return fail(error, "team move " + std::to_string(i) + " is malformed");
+    }
+  }
+  return true;
+}
+
+uint64_t getPmdbSourceStamp(const Loader & loader) {
+  const LoaderTool::LoaderType sources[] = {LoaderTool::kSpecies, LoaderTool::kMoves, LoaderTool::kTeam};
+  uint64_t stamp = getPmdbChecksum(nullptr, 0);
+  auto mix = [&stamp](const uint64_t value) {
+    for(int i = 0; i < 8; i++) {
+      stamp = (stamp ^ ((value >> (8 * i)) & 0xFF)) * 0x100000001B3ull;
+    }
+  };
+  mix(PMDB_FORMAT_VERSION);
+  for(LoaderTool::LoaderType type : sources) {
+    std::string filepath;
+    if(!loader.getFilepath(type, &filepath)) {
+      mix(0);
+      continue;
+    }
+    mix(getPmdbChecksum(reinterpret_cast<const uint8_t*>(filepath.data()), filepath.size()));
+
+    // a missing file stamps as zeroes
+    std::error_code error;
+    uintmax_t size = std::filesystem::file_size(filepath, error);
+    mix(error ? 0 : (uint64_t)size);
+    std::filesystem::file_time_type time = std::filesystem::last_write_time(filepath, error);
+    mix(error ? 0 : (uint64_t)time.time_since_epoch().count());
+  }
+  return stamp;
+}
+
+uint64_t getPmdbChecksum(const uint8_t * data, const size_t size) {
+  uint64_t hash = 0xCBF29CE484222325ull;
+  for(size_t i = 0; i < size; i++) {
+    hash = (hash ^ data[i]) * 0x100000001B3ull;
+  }
+  return hash;
+}
+
+bool writePmdb(const PokemanDatabase & database, const uint64_t source_stamp, const std::string & filepath) {
+  StringTable strings;
+  strings.add(""); // offset 0 is the empty string
+
+  // moves, by id
+  const MoveLibrary& move_library = database.getMoves();
+  std::vector<PmdbMove> moves((size_t)move_library.size());
+  for(MoveId id = 0; id < move_library.size(); id++) {
+    const Move& move = move_library.get(id);
+    PmdbMove& record = moves[id];
+    record.name = strings.add(move.name_);
+    record.move_type = move.move_type_;
+    record.elemental_type = move.elemental_type_;
+    record.power = move.power_;
+    record.accuracy = move.accuracy_;
+    record.status_effect_chance_self = move.status_effect_chance_self_;
+    record.status_effect_chance_target = move.status_effect_change_target_;
+    copyStats(move.stat_modifiers_self_, record.stat_modifiers_self);
+    copyStats(move.stat_modifiers_target_, record.stat_modifiers_target);
+    record.hm = move.hm_;
+    record.tm = move.tm_;
+    record.target = move.target_;
+    record.pp = move.pp_;
+    record.number = move.number_;
+    record.flags = move.flags_;
+    record.valid_generations = (uint32_t)move.valid_generations_.to_ulong();
+  }
+
+  // species and their learnsets
+  std::vector<PmdbSpecies> species;
+  std::vector<PmdbLearnsetMove> learnset;
+  for(const MonsterSpecies* entry : database.getSpecies().getAll()) {
+    PmdbSpecies record;
+    record.name = strings.add(entry->name_);
+    record.number = entry->number_;
+    record.first_type = entry->type_.first_type_;
+    record.second_type = entry->type_.second_type_;
+    record.dual_type = entry->type_.b_dual_type_ ? 1 : 0;
+    copyStats(entry->base_stats_, record.base_stats);
+    record.valid_generations = (uint32_t)entry->valid_generations.to_ulong();
+    record.learnset_first = (uint32_t)learnset.size();
+    record.learnset_count = (uint32_t)entry->learnset_.size();
+    for(const LearnsetMove& move : entry->learnset_) {
+      PmdbLearnsetMove learnset_record;
+      learnset_record.move_name = strings.add(move.move_name_);
+      learnset_record.move_id = move.move_id_;
+      learnset_record.learned_at_level = move.learned_at_level_;
+      learnset_record.methods = (move.b_machine_able_ ? PMDB_LEARNSET_MACHINE : 0)
+        | (move.b_tutor_able_ ? PMDB_LEARNSET_TUTOR : 0);
+      learnset_record.tutor_memo = strings.add(move.tutor_memo_);
+      learnset.push_back(learnset_record);
+    }
+    species.push_back(record);
+  }
+
+  // team
+  std::vector<PmdbTeamMember> team;
+  std::vector<MoveId> team_moves;
+  for(const Monster& monster : database.getTeam()) {
+    PmdbTeamMember record;
+    record.name = strings.add(monster.name_);
+    record.species_number = monster.species_ != nullptr ? monster.species_->number_ : -1;
+    record.level = monster.level_;
+    record.moves_first = (uint32_t)team_moves.size();
+    record.moves_count = (uint32_t)monster.hm_moves_.size();
+    team_moves.insert(team_moves.end(), monster.hm_moves_.begin(), monster.hm_moves_.end());
+    team.push_back(record);
+  }
+
+  // sections follow the header in this order
+  PmdbHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, PMDB_MAGIC, sizeof(header.magic));
+  header.format = PMDB_FORMAT_VERSION;
+  header.source_stamp = source_stamp;
+  header.move_count = (uint32_t)moves.size();
+  header.species_count = (uint32_t)species.size();
+  header.learnset_count = (uint32_t)learnset.size();
+  header.team_count = (uint32_t)team.size();
+  header.team_move_count = (uint32_t)team_moves.size();
+  header.string_bytes = (uint32_t)strings.getBytes().size();
+
+  std::string body;
+  uint32_t base = sizeof(PmdbHeader);
+  header.moves_offset = base + (uint32_t)body.size();
+  appendRecords(moves, &body);
+  header.species_offset = base + (uint32_t)body.size();
+  appendRecords(species, &body);
+  header.learnset_offset = base + (uint32_t)body.size();
+  appendRecords(learnset, &body);
+  header.team_offset = base + (uint32_t)body.size();
+  appendRecords(team, &body);
+  header.team_moves_offset = base + (uint32_t)body.size();
+  appendRecords(team_moves, &body);
+  header.strings_offset = base + (uint32_t)body.size();
+  body.append(strings.getBytes());
+  header.checksum = getPmdbChecksum(reinterpret_cast<const uint8_t*>(body.data()), body.size());
+
+  std::ofstream file(filepath, std::ios::binary | std::ios::trunc);
+  if(!file) {
+    return false;
+  }
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(body.data(), (std::streamsize)body.size());
+  return (bool)file;
+}
+
+} // namespace resources
+} // namespace pokeman
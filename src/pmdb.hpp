@@ -0,0 +1,180 @@
+/*
+* pmdb.hpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*
+* Compiled database: the species, moves and team in fixed-width records,
+* written once by the compile driver and mapped straight into memory
+* instead of parsing the yaml each run.
+*/
+#ifndef POKEMAN_PMDB_HPP_
+#define POKEMAN_PMDB_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <vector>
+
+#include "pokeman.hpp"
+
+#define PMDB_MAGIC "PMDB"
+
+/// Bump whenever a record changes shape.
+#define PMDB_FORMAT_VERSION 1
+
+namespace pokeman {
+namespace resources {
+
+class Loader;
+class PokemanDatabase;
+
+/// Start of the file. Offsets are from the start of the file, and strings
+/// are offsets into the string table.
+struct PmdbHeader {
+  char magic[4];
+  uint32_t format;
+
+  /// FNV-1a of everything after the header.
+  uint64_t checksum;
+
+  /// Stamp of the source files compiled from. (see getPmdbSourceStamp)
+  uint64_t source_stamp;
+
+  uint32_t move_count;
+  uint32_t species_count;
+  uint32_t learnset_count;
+  uint32_t team_count;
+  uint32_t team_move_count;
+  uint32_t string_bytes;
+
+  uint32_t moves_offset;
+  uint32_t species_offset;
+  uint32_t learnset_offset;
+  uint32_t team_offset;
+  uint32_t team_moves_offset;
+  uint32_t strings_offset;
+};
+
+/// Move, in id order.
+struct PmdbMove {
+  uint32_t name;
+  int32_t move_type;
+  int32_t elemental_type;
+  int32_t power;
+  int32_t accuracy;
+  int32_t status_effect_chance_self;
+  int32_t status_effect_chance_target;
+
+  /// hp, attack, defense, special attack, special defense, speed
+  int32_t stat_modifiers_self[6];
+  int32_t stat_modifiers_target[6];
+
+  int32_t hm;
+  int32_t tm;
+  int32_t target;
+  int32_t pp;
+  int32_t number;
+  uint32_t flags;
+  uint32_t valid_generations;
+};
+
+/// Species, in pokedex order. Its learnset is a span of learnset records.
+struct PmdbSpecies {
+  uint32_t name;
+  int32_t number;
+  int32_t first_type;
+  int32_t second_type;
+  int32_t dual_type;
+  int32_t base_stats[6];
+  uint32_t valid_generations;
+  uint32_t learnset_first;
+  uint32_t learnset_count;
+};
+
+#define PMDB_LEARNSET_MACHINE 1
+#define PMDB_LEARNSET_TUTOR 2
+
+struct PmdbLearnsetMove {
+  uint32_t move_name;
+
+  /// Resolved id, or kNullMoveId.
+  int32_t move_id;
+  int32_t learned_at_level;
+
+  /// PMDB_LEARNSET_ bits
+  uint32_t methods;
+  uint32_t tutor_memo;
+};
+
+/// Team member. Its kept moves are a span of the team move ids.
+struct PmdbTeamMember {
+  uint32_t name;
+  int32_t species_number;
+  int32_t level;
+  uint32_t moves_first;
+  uint32_t moves_count;
+};
+
+/// Read only view of a compiled database file, mapped into memory. Records
+/// are read in place. Not copyable.
+class PmdbFile {
+private:
+  const uint8_t* data_;
+  size_t size_;
+
+  /// Holds the file where it can't be mapped.
+  std::vector<uint8_t> buffer_;
+  bool mapped_;
+
+public:
+  PmdbFile();
+
+  ~PmdbFile();
+
+  PmdbFile(const PmdbFile&) = delete;
+
+  PmdbFile& operator=(const PmdbFile&) = delete;
+
+  /// Maps the file and checks it over. False, if it is missing or isn't a
+  /// well formed database of this format; error says why, if given.
+  bool open(const std::string& filepath, std::string* error = nullptr);
+
+  /// Unmaps the file.
+  void close();
+
+  const PmdbHeader& getHeader() const;
+
+  const PmdbMove* getMoves() const;
+
+  const PmdbSpecies* getSpecies() const;
+
+  const PmdbLearnsetMove* getLearnset() const;
+
+  const PmdbTeamMember* getTeam() const;
+
+  const MoveId* getTeamMoves() const;
+
+  /// String at an offset into the string table.
+  const char* getString(const uint32_t offset) const;
+
+private:
+  /// False, if the bytes aren't a consistent database.
+  bool validate(std::string* error) const;
+};
+
+/// Stamp of the source files a loader points at: their paths, sizes and
+/// modification times. Changes when any of them does.
+uint64_t getPmdbSourceStamp(const Loader& loader);
+
+/// FNV-1a over bytes.
+uint64_t getPmdbChecksum(const uint8_t* data, const size_t size);
+
+/// Writes a loaded database out. False, if the file can't be written.
+bool writePmdb(const PokemanDatabase& database, const uint64_t source_stamp, const std::string& filepath);
+
+} // namespace resources
+} // namespace pokeman
+
+#endif //POKEMAN_PMDB_HPP_
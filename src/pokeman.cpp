@@ -9,6 +9,7 @@
 
 #include <cassert>
 
+#include <algorithm>
 #include <bitset>
 #include <iostream>
 #include <string>
@@ -140,6 +141,30 @@ std::string TypesHad::toString() const {
   return string;
 }
 
+int getTypingIndex(const TypesHad & typing) {
+  assert(typing.first_type_ != kNullType);
+  int low = typing.first_type_;
+  int high = typing.b_dual_type_ ? typing.second_type_ : low;
+  assert(high != kNullType);
+  if(low > high) {
+    std::swap(low, high);
+  }
+  // rows of pairs starting at each low type get shorter by one
+  return low * kNullType - low * (low - 1) / 2 + (high - low);
+}
+
+TypesHad getTypingFromIndex(const int index) {
+  assert(index >= 0 && index < POKEMAN_NUMBER_OF_TYPINGS);
+  int low = 0;
+  int row_start = 0;
+  while(index >= row_start + (kNullType - low)) {
+    row_start += kNullType - low;
+    low++;
+  }
+  int high = low + (index - row_start);
+  return low == high ? TypesHad((Type)low) : TypesHad((Type)low, (Type)high);
+}
+
 TypeChart::TypeChart() {
 	// clear all
 	for(int i = 0; i < kNullType; i++) {
@@ -345,16 +370,19 @@ TypeInfo TypeChart::getTypeInfo(const Type type1, const Type type2) const {
 	return TypeInfo::dualType(type_info_[type1], type_info_[type2]);
 }
 
-LearnsetMove::LearnsetMove(const std::string& name) : move_name_(name) {
+LearnsetMove::LearnsetMove(const std::string_view name) : move_name_(name) {
+  move_id_ = kNullMoveId;
+  b_machine_able_ = false;
+  b_tutor_able_ = false;
   learned_at_level_ = 0;
 }
 
-void LearnsetMove::setAsMoveTutorableWithMemo(std::string memo) {
+void LearnsetMove::setAsMoveTutorableWithMemo(const std::string_view memo) {
   b_tutor_able_ = true;
   tutor_memo_ = memo;
 }
 Monster::Monster(const std::string & name, const MonsterSpecies * species) : name_(name),
-  species_(species) {}
+  species_(species), level_(POKEMAN_DEFAULT_LEVEL) {}
 
 Monster::Monster() : Monster ("???", nullptr) {}
 
@@ -380,136 +408,505 @@ bool typeEffectivenessIsWeak(TypeEffectiveness effectiveness) {
 }
 
 MonsterSpecies* MonsterSpeciesLibrary::get(const int number) {
-  return !numberExists(number) ? nullptr : &number_to_species_.at(number);
+  return find(number);
 }
 
 MonsterSpecies* MonsterSpeciesLibrary::get(const std::string & name) {
-  return !nameExists(name) ? nullptr : &number_to_species_.at(name_to_number_.at(name));
+  return !nameExists(name) ? nullptr : find(name_to_number_.at(name));
 }
 
 const MonsterSpecies* MonsterSpeciesLibrary::get(const int number) const {
-  return !numberExists(number) ? nullptr : &number_to_species_.at(number);
+  return find(number);
 }
 
 const MonsterSpecies * MonsterSpeciesLibrary::get(const std::string & name) const {
-  return !nameExists(name) ? nullptr : &number_to_species_.at(name_to_number_.at(name));
+  return !nameExists(name) ? nullptr : find(name_to_number_.at(name));
 }
 
-void MonsterSpeciesLibrary::set(const int number, const MonsterSpecies & species) {
-  number_to_species_[number] = species;
+MonsterSpeciesLibrary::MonsterSpeciesLibrary() : names_(std::make_shared<StringArena>()) {}
+
+void MonsterSpeciesLibrary::set(const int number, MonsterSpecies species) {
   name_to_number_[species.name_] = number;
+  MonsterSpecies& entry = number_to_species_[number];
+  entry = std::move(species);
+  entry.number_ = number;
+  unread_.erase(number);
+}
+
+StringArena & MonsterSpeciesLibrary::getNames() {
+  return *names_;
 }
 
-bool MonsterSpeciesLibrary::numberExists(const int number) const {
-  return number_to_species_.find(number) != number_to_species_.end();
+const StringArena & MonsterSpeciesLibrary::getNames() const {
+  return *names_;
+}
+
+std::vector<const MonsterSpecies*> MonsterSpeciesLibrary::getAll() const {
+  if(source_ != nullptr) {
+    std::lock_guard<std::mutex> lock(source_->mutex_);
+    while(!unread_.empty()) {
+      read(*unread_.begin());
+    }
+  }
+  std::vector<const MonsterSpecies*> all;
+  all.reserve(number_to_species_.size());
+  for(const std::pair<const int, MonsterSpecies>& pair : number_to_species_) {
+    all.push_back(&pair.second);
+  }
+  return all;
+}
+
+void MonsterSpeciesLibrary::setSource(std::shared_ptr<SpeciesSource> source) {
+  source_ = source;
+  unread_.clear();
+  if(source_ == nullptr) {
+    return;
+  }
+  for(const std::pair<const std::string, int>& pair : source_->list()) {
+    name_to_number_[pair.first] = pair.second;
+    if(number_to_species_.find(pair.second) == number_to_species_.end())
+      unread_.insert(pair.second);
+  }
+}
+
+/// Species read later are resolved against a copy of the moves, since the
+/// library may outlive them or move away from them.
+int MonsterSpeciesLibrary::resolveMoves(const MoveLibrary & moves, std::vector<std::string>* dangling) {
+  int unresolved = 0;
+  for(std::pair<const int, MonsterSpecies>& pair : number_to_species_) {
+    unresolved += resolveSpecies(pair.second, moves, dangling);
+  }
+  if(source_ != nullptr && !unread_.empty()) {
+    resolved_moves_ = std::make_shared<const MoveLibrary>(moves);
+  }
+  return unresolved;
+}
+
+MonsterSpecies* MonsterSpeciesLibrary::find(const int number) const {
+  if(source_ == nullptr) {
+    auto found = number_to_species_.find(number);
+    return found == number_to_species_.end() ? nullptr : &found->second;
+  }
+  std::lock_guard<std::mutex> lock(source_->mutex_);
+  auto found = number_to_species_.find(number);
+  return found != number_to_species_.end() ? &found->second : read(number);
+}
+
+/// A species that can't be read is dropped, so it is only reported once.
+MonsterSpecies* MonsterSpeciesLibrary::read(const int number) const {
+  if(unread_.erase(number) == 0) {
+    return nullptr;
+  }
+  MonsterSpecies species;
+  if(!source_->read(number, names_.get(), &species)) {
+    return nullptr;
+  }
+  MonsterSpecies& entry = number_to_species_[number];
+  entry = std::move(species);
+  entry.number_ = number;
+  if(resolved_moves_ != nullptr) {
+    std::vector<std::string> dangling;
+    resolveSpecies(entry, *resolved_moves_, &dangling);
+    for(const std::string& reference : dangling) {
+      std::cerr << "[Warning] " << reference << std::endl;
+    }
+  }
+  return &entry;
+}
+
+int MonsterSpeciesLibrary::resolveSpecies(MonsterSpecies & species, const MoveLibrary & moves,
+  std::vector<std::string>* dangling) {
+  int unresolved = 0;
+  species.movepool_ = MoveSet();
+  for(LearnsetMove& learnset_move : species.learnset_) {
+    learnset_move.move_id_ = moves.getId(learnset_move.move_name_);
+    if(learnset_move.move_id_ == kNullMoveId) {
+      unresolved++;
+      if(dangling != nullptr)
+        dangling->push_back("species " + species.name_ + " learns unknown move " + std::string(learnset_move.move_name_));
+    } else {
+      species.movepool_.insert(learnset_move.move_id_);
+    }
+  }
+  species.indexLearnset();
+  return unresolved;
 }
 
 bool MonsterSpeciesLibrary::nameExists(const std::string & name) const {
-  if(name_to_number_.find(name) == name_to_number_.end()) {
-    std::cerr << "could not find " << name << std::endl;
-    return false;
+  return name_to_number_.find(name) != name_to_number_.end();
+}
+
+MonsterSpecies::MonsterSpecies() : number_(0), machine_start_(0), level_up_start_(0) {}
+
+MoveIdSpan MonsterSpecies::getMovepool() const {
+  return getMovepool(POKEMAN_MAX_LEVEL, kAllLearnMethods);
+}
+
+MoveIdSpan MonsterSpecies::getMovepool(const int level_cap, const LearnMethods methods) const {
+  size_t start = methods == kAllLearnMethods ? 0 : (methods == kLevelUpAndMachines ? machine_start_ : level_up_start_);
+  size_t end = level_up_start_ + (std::upper_bound(learnset_levels_.begin(), learnset_levels_.end(), level_cap) - learnset_levels_.begin());
+  const MoveId* data = learnset_index_.data();
+  return MoveIdSpan(data + start, data + end);
+}
+
+void MonsterSpecies::indexLearnset() {
+  learnset_index_.clear();
+  learnset_levels_.clear();
+
+  // tutor, then machine
+  for(const LearnsetMove& move : learnset_) {
+    if(move.move_id_ != kNullMoveId && move.b_tutor_able_)
+      learnset_index_.push_back(move.move_id_);
+  }
+  machine_start_ = learnset_index_.size();
+  for(const LearnsetMove& move : learnset_) {
+    if(move.move_id_ != kNullMoveId && move.b_machine_able_)
+      learnset_index_.push_back(move.move_id_);
+  }
+  level_up_start_ = learnset_index_.size();
+
+  // level up, lowest level first
+  std::vector<const LearnsetMove*> level_up;
+  for(const LearnsetMove& move : learnset_) {
+    if(move.move_id_ != kNullMoveId && move.learned_at_level_ > 0)
+      level_up.push_back(&move);
+  }
+  std::stable_sort(level_up.begin(), level_up.end(), [](const LearnsetMove* a, const LearnsetMove* b) {
+    return a->learned_at_level_ < b->learned_at_level_;
+  });
+  for(const LearnsetMove* move : level_up) {
+    learnset_index_.push_back(move->move_id_);
+    learnset_levels_.push_back(move->learned_at_level_);
+  }
+}
+
+MoveIdSpan::MoveIdSpan() : begin_(nullptr), end_(nullptr) {}
+
+MoveIdSpan::MoveIdSpan(const MoveId * begin, const MoveId * end) : begin_(begin), end_(end) {}
+
+MoveIdSpan::MoveIdSpan(const std::vector<MoveId>& moves) : begin_(moves.data()), end_(moves.data() + moves.size()) {}
+
+const MoveId * MoveIdSpan::begin() const {
+  return begin_;
+}
+
+const MoveId * MoveIdSpan::end() const {
+  return end_;
+}
+
+size_t MoveIdSpan::size() const {
+  return (size_t)(end_ - begin_);
+}
+
+bool MoveIdSpan::empty() const {
+  return begin_ == end_;
+}
+
+std::vector<MoveId> MoveIdSpan::toVector() const {
+  return std::vector<MoveId>(begin_, end_);
+}
+
+const Move& MoveLibrary::get(const MoveId id) const {
+  assert(contains(id));
+  return moves_[id];
+}
+
+const Move* MoveLibrary::get(const std::string & name) const {
+  MoveId id = getId(name);
+  return id == kNullMoveId ? nullptr : &moves_[id];
+}
+
+MoveId MoveLibrary::getId(const std::string_view name) const {
+  std::map<std::string, MoveId, std::less<>>::const_iterator it = name_to_id_.find(name);
+  return it == name_to_id_.end() ? kNullMoveId : it->second;
+}
+
+MoveFlags MoveLibrary::getFlags(const MoveId id) const {
+  assert(contains(id));
+  return flags_[id];
+}
+
+std::vector<MoveId> MoveLibrary::filterByFlags(const std::vector<MoveId>& moves, const MoveFlags mask, const MoveFlags value) const {
+  std::vector<MoveId> filtered;
+  filtered.reserve(moves.size());
+  const MoveFlags* flags = flags_.data();
+  for(MoveId id : moves) {
+    assert(contains(id));
+    if((flags[id] & mask) == value)
+      filtered.push_back(id);
+  }
+  return filtered;
+}
+
+const MoveSet& MoveLibrary::getFlagSet(const MoveFlag flag) const {
+  static const MoveSet kEmpty;
+  int bit = 0;
+  while((1u << bit) < (MoveFlags)flag) {
+    bit++;
+  }
+  return bit < (int)flag_sets_.size() ? flag_sets_[bit] : kEmpty;
+}
+
+const MoveSet& MoveLibrary::getTypeSet(const Type type) const {
+  assert(type != kNullType);
+  return type_sets_[type];
+}
+
+const MoveSet& MoveLibrary::getCategorySet(const MoveType category) const {
+  assert(category != kNullMoveType);
+  return category_sets_[category];
+}
+
+MoveId MoveLibrary::set(const Move & move) {
+  MoveId id = getId(move.name_);
+  if(id == kNullMoveId) {
+    id = (MoveId)moves_.size();
+    moves_.push_back(move);
+    flags_.push_back(move.flags_);
+    name_to_id_[move.name_] = id;
   } else {
-    return numberExists(name_to_number_.at(name));
+    indexMove(id, false);
+    moves_[id] = move;
+    flags_[id] = move.flags_;
+  }
+  indexMove(id, true);
+  return id;
+}
+
+void MoveLibrary::indexMove(const MoveId id, const bool present) {
+  const Move& move = moves_[id];
+  MoveFlags flags = flags_[id];
+  for(int bit = 0; (flags >> bit) != 0; bit++) {
+    if(((flags >> bit) & 1) == 0)
+      continue;
+    if(bit >= (int)flag_sets_.size())
+      flag_sets_.resize(bit + 1);
+    present ? flag_sets_[bit].insert(id) : flag_sets_[bit].erase(id);
+  }
+  if(move.elemental_type_ != kNullType)
+    present ? type_sets_[move.elemental_type_].insert(id) : type_sets_[move.elemental_type_].erase(id);
+  if(move.move_type_ != kNullMoveType)
+    present ? category_sets_[move.move_type_].insert(id) : category_sets_[move.move_type_].erase(id);
+}
+
+MoveCoverageTable::MoveCoverageTable() {}
+
+MoveCoverageTable::MoveCoverageTable(const MoveLibrary & moves, const TypeChart & chart) {
+  // coverage only depends on elemental type, so work it out per type
+  TypingSet type_super_effective[kNullType];
+  TypingSet type_resisted[kNullType];
+  for(int t = 0; t < kNullType; t++) {
+    for(int i = 0; i < POKEMAN_NUMBER_OF_TYPINGS; i++) {
+      TypeEffectiveness effectiveness = chart.getTypeEffectivenessXonY((Type)t, getTypingFromIndex(i));
+      type_super_effective[t][i] = typeEffectivenessIsWeak(effectiveness);
+      type_resisted[t][i] = typeEffectivenessIsStrong(effectiveness);
+    }
+  }
+
+  // hand out to moves
+  super_effective_.resize(moves.size());
+  resisted_.resize(moves.size());
+  has_entry_.resize(moves.size(), false);
+  for(MoveId id = 0; id < moves.size(); id++) {
+    const Move& move = moves.get(id);
+    bool attacks_foe = (moves.getFlags(id) & (kMoveDamaging | kMoveTargetsFoe)) == (kMoveDamaging | kMoveTargetsFoe);
+    if(attacks_foe && move.elemental_type_ != kNullType) {
+      super_effective_[id] = type_super_effective[move.elemental_type_];
+      resisted_[id] = type_resisted[move.elemental_type_];
+      has_entry_[id] = true;
+    }
   }
 }
 
+const TypingSet& MoveCoverageTable::getSuperEffective(const MoveId id) const {
+  assert(id >= 0 && id < (MoveId)super_effective_.size());
+  return super_effective_[id];
+}
+
+const TypingSet& MoveCoverageTable::getResisted(const MoveId id) const {
+  assert(id >= 0 && id < (MoveId)resisted_.size());
+  return resisted_[id];
+}
+
+bool MoveCoverageTable::hasEntry(const MoveId id) const {
+  assert(id >= 0 && id < (MoveId)has_entry_.size());
+  return has_entry_[id];
+}
 
-std::vector<std::string> MonsterSpecies::getMovepool() const {
-  std::vector<std::string> movepool;
-  for(LearnsetMove move : learnset_) {
-    movepool.push_back(move.move_name_);
+TypingSet MoveCoverageTable::getCoverage(const MoveId * moves, const int count) const {
+  TypingSet coverage;
+  for(int i = 0; i < count; i++) {
+    coverage |= getSuperEffective(moves[i]);
   }
-  return movepool;
+  return coverage;
+}
+
+TypingSet MoveCoverageTable::getWalls(const MoveId * moves, const int count) const {
+  TypingSet walls;
+  bool any_attacks = false;
+  for(int i = 0; i < count; i++) {
+    // moves without entries neither hit nor get walled
+    if(!hasEntry(moves[i]))
+      continue;
+    walls = any_attacks ? (walls & getResisted(moves[i])) : getResisted(moves[i]);
+    any_attacks = true;
+  }
+  return walls;
 }
 
-MoveTarget::MoveTarget(MoveTargetDescription description) {
-  // who does it target?
-  switch(description) {
-  case kAnyAdjacentFoe:
-  case kAllAdjacentFoes:
-  case kAllFoes:
-    target_foe = true;
-    break;
-
-  case kAnyOther:
-  case kAllAdjacent:
-  case kAnyAdjacent:
-    target_foe = true;
-    target_ally = true;
-    break;
-
-  case kAll:
-    target_self = true;
-    target_foe = true;
-    target_ally = true;
-    break;
-
-  case kSelf:
-    target_self = true;
-    break;
-
-  case kSelfOrAdjacentAlly:
-  case kWholeTeam:
-    target_ally = true;
-    target_self = true;
-    break;
-
-  case kAdjacentAlly:
-    target_ally = true;
-    break;
+MoveSet::MoveSet() {}
 
-  default:
-    assert(false);
-    break;
-  }
-
-  // what is the scope of the targeting?
-  switch(description) {
-  case kAnyAdjacentFoe:
-  case kAllAdjacentFoes:
-  case kAllAdjacent:
-  case kSelfOrAdjacentAlly:
-  case kAdjacentAlly:
-  case kAnyAdjacent:
-    target_adjacent = true;
-    break;
-
-  case kAllFoes:
-  case kAnyOther:
-  case kAll:
-  case kSelf:
-  case kWholeTeam:
-    target_adjacent = false;
-    break;
+MoveSet::MoveSet(const MoveIdSpan moves) {
+  for(MoveId id : moves) {
+    insert(id);
+  }
+}
 
-  default:
-    assert(false);
-    break;
-  }
-
-  // can the target be selected?
-  switch(description) {
-  case kAnyAdjacentFoe:
-  case kAnyOther:
-  case kSelfOrAdjacentAlly:
-  case kAdjacentAlly:
-  case kAnyAdjacent:
-    target_any = true;
-    break;
-
-  case kAllAdjacentFoes:
-  case kAllFoes:
-  case kAllAdjacent:
-  case kAll:
-  case kSelf:
-  case kWholeTeam:
-    target_any = false;
-    break;
+void MoveSet::insert(const MoveId id) {
+  assert(id >= 0);
+  size_t word = (size_t)id / 64;
+  if(word >= words_.size())
+    words_.resize(word + 1, 0);
+  words_[word] |= (std::uint64_t)1 << (id % 64);
+}
 
-  default:
-    assert(false);
-    break;
+void MoveSet::erase(const MoveId id) {
+  size_t word = (size_t)id / 64;
+  if(id >= 0 && word < words_.size())
+    words_[word] &= ~((std::uint64_t)1 << (id % 64));
+}
+
+bool MoveSet::contains(const MoveId id) const {
+  size_t word = (size_t)id / 64;
+  return id >= 0 && word < words_.size() && ((words_[word] >> (id % 64)) & 1) != 0;
+}
+
+int MoveSet::count() const {
+  int total = 0;
+  for(std::uint64_t word : words_) {
+    total += (int)std::bitset<64>(word).count();
   }
+  return total;
+}
+
+bool MoveSet::empty() const {
+  for(std::uint64_t word : words_) {
+    if(word != 0)
+      return false;
+  }
+  return true;
+}
+
+std::vector<MoveId> MoveSet::toVector() const {
+  std::vector<MoveId> moves;
+  for(size_t i = 0; i < words_.size(); i++) {
+    std::uint64_t word = words_[i];
+    for(int bit = 0; word != 0; bit++, word >>= 1) {
+      if((word & 1) != 0)
+        moves.push_back((MoveId)(i * 64 + bit));
+    }
+  }
+  return moves;
+}
+
+MoveSet& MoveSet::operator|=(const MoveSet & that) {
+  if(that.words_.size() > words_.size())
+    words_.resize(that.words_.size(), 0);
+  for(size_t i = 0; i < that.words_.size(); i++) {
+    words_[i] |= that.words_[i];
+  }
+  return *this;
+}
+
+MoveSet& MoveSet::operator&=(const MoveSet & that) {
+  if(words_.size() > that.words_.size())
+    words_.resize(that.words_.size());
+  for(size_t i = 0; i < words_.size(); i++) {
+    words_[i] &= that.words_[i];
+  }
+  return *this;
+}
+
+MoveSet& MoveSet::operator-=(const MoveSet & that) {
+  size_t common = std::min(words_.size(), that.words_.size());
+  for(size_t i = 0; i < common; i++) {
+    words_[i] &= ~that.words_[i];
+  }
+  return *this;
+}
+
+MoveSet MoveSet::operator|(const MoveSet & that) const {
+  MoveSet result(*this);
+  return result |= that;
+}
+
+MoveSet MoveSet::operator&(const MoveSet & that) const {
+  MoveSet result(*this);
+  return result &= that;
+}
+
+MoveSet MoveSet::operator-(const MoveSet & that) const {
+  MoveSet result(*this);
+  return result -= that;
+}
+
+bool MoveLibrary::contains(const MoveId id) const {
+  return id >= 0 && id < (MoveId)moves_.size();
+}
+
+int MoveLibrary::size() const {
+  return (int)moves_.size();
+}
+
+MoveTarget::MoveTarget(MoveTargetDescription description) {
+  assert(description >= 0 && description < kNullTargetDescription);
+  const MoveTargetTraits& traits = kMoveTargetTraits[description];
+  target_foe = traits.foe;
+  target_ally = traits.ally;
+  target_self = traits.self;
+  target_any = traits.any;
+  target_adjacent = traits.adjacent;
+}
+
+Move::Move() : move_type_(kNullMoveType), elemental_type_(kNullType), power_(-1), accuracy_(-1),
+  status_effect_chance_self_(0), status_effect_change_target_(0), hm_(0), tm_(0),
+  target_(kAnyAdjacent), pp_(0), number_(0), flags_(0) {}
+
+MoveFlags classifyMove(const Move & move) {
+  MoveFlags flags = 0;
+
+  // damage
+  if(move.move_type_ == kStatus) {
+    flags |= kMoveStatus;
+  } else if(move.power_ >= 0) {
+    flags |= kMoveDamaging;
+  }
+
+  // targeting
+  if(move.target_ != kNullTargetDescription) {
+    MoveTarget target(move.target_);
+    if(target.target_foe)
+      flags |= kMoveTargetsFoe;
+    if(target.target_ally)
+      flags |= kMoveTargetsAlly;
+    if(target.target_self)
+      flags |= kMoveTargetsSelf;
+    if(target.target_adjacent)
+      flags |= kMoveTargetsAdjacent;
+    if(target.target_any)
+      flags |= kMoveTargetSelectable;
+  }
+
+  // stat changes
+  if(!move.stat_modifiers_self_.isBlank())
+    flags |= kMoveSelfStatChange;
+  if(!move.stat_modifiers_target_.isBlank())
+    flags |= kMoveTargetStatChange;
+  if(move.stat_modifiers_self_.attack_ > 0)
+    flags |= kMoveBoostsAttack;
+  if(move.stat_modifiers_self_.special_attack_ > 0)
+    flags |= kMoveBoostsSpecialAttack;
+  return flags;
 }
 
 MonsterStats::MonsterStats() {
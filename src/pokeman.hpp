@@ -10,16 +10,43 @@
 #ifndef POKEMAN_POKEMAN_HPP_
 #define POKEMAN_POKEMAN_HPP_
 
+#include <cstdint>
+
 #include <bitset>
 #include <list>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "string_arena.hpp"
+
 #define POKEMAN_NUMBER_OF_GENERATIONS_TO_CAP 8
 
+/// Number of distinct mono and dual typings.
+#define POKEMAN_NUMBER_OF_TYPINGS (kNullType * (kNullType + 1) / 2)
+
+/// Level of monsters that don't say otherwise.
+#define POKEMAN_DEFAULT_LEVEL 50
+#define POKEMAN_MAX_LEVEL 100
+
+/// Most monsters one side has out at once, in a triple battle.
+#define POKEMAN_MAX_BATTLE_SLOTS 3
+
+/// Most moves a monster knows at once.
+#define MOVESET_SIZE 4
+
 namespace pokeman {
 
+/// Dense index of a move in a MoveLibrary.
+typedef int MoveId;
+
+/// Denotes a move that could not be found.
+const MoveId kNullMoveId = -1;
+
 /// Enumeration of types
 enum Type {
   kNormal,
@@ -71,6 +98,24 @@ enum MoveTargetDescription {
 
 };
 
+/// Classification flags of a move, computed once when it is loaded.
+typedef unsigned int MoveFlags;
+
+/// Bits of MoveFlags.
+enum MoveFlag : MoveFlags {
+  kMoveDamaging = 1 << 0,
+  kMoveStatus = 1 << 1,
+  kMoveTargetsFoe = 1 << 2,
+  kMoveTargetsAlly = 1 << 3,
+  kMoveTargetsSelf = 1 << 4,
+  kMoveTargetsAdjacent = 1 << 5,
+  kMoveTargetSelectable = 1 << 6,
+  kMoveSelfStatChange = 1 << 7,
+  kMoveTargetStatChange = 1 << 8,
+  kMoveBoostsAttack = 1 << 9,
+  kMoveBoostsSpecialAttack = 1 << 10
+};
+
 /// Strength of move
 enum TypeEffectiveness {
   kZeroTimes,
@@ -144,6 +189,15 @@ public:
   std::string toString() const;
 };
 
+/// Set of typings, one bit per typing index.
+typedef std::bitset<POKEMAN_NUMBER_OF_TYPINGS> TypingSet;
+
+/// Dense index of a mono or dual typing, regardless of type order.
+int getTypingIndex(const TypesHad& typing);
+
+/// Typing at a typing index.
+TypesHad getTypingFromIndex(const int index);
+
 
 
 /// Lookup Type Info across all types.
@@ -240,6 +294,79 @@ public:
 
 };
 
+/// Battles by how many monsters each side has out.
+enum BattleFormat {
+  kSingles = 1,
+  kDoubles = 2,
+  kTriples = 3
+};
+
+/// Who a move reaches on the board. Same fields as MoveTarget.
+struct MoveTargetTraits {
+  bool foe;
+  bool ally;
+  bool self;
+  bool any;
+  bool adjacent;
+};
+
+/// Traits of each description, in the order of MoveTargetDescription.
+constexpr MoveTargetTraits kMoveTargetTraits[kNullTargetDescription] = {
+  {true, false, false, true, true},   // kAnyAdjacentFoe
+  {true, false, false, false, true},  // kAllAdjacentFoes
+  {true, false, false, false, false}, // kAllFoes
+  {true, true, false, true, false},   // kAnyOther
+  {true, true, false, false, true},   // kAllAdjacent
+  {true, true, true, false, false},   // kAll
+  {false, false, true, false, false}, // kSelf
+  {false, true, true, true, true},    // kSelfOrAdjacentAlly
+  {false, true, false, true, true},   // kAdjacentAlly
+  {false, true, true, false, false},  // kWholeTeam
+  {true, true, false, true, true}     // kAnyAdjacent
+};
+
+/// Slots a move can reach, as bits. Bits 0 to 2 are the user's side, left
+/// to right, and bits 3 to 5 are the foes facing them in the same order.
+typedef uint8_t MoveTargetMask;
+
+/// Reachable slots for every description, format and user position.
+struct MoveTargetMaskTable {
+  MoveTargetMask masks[kNullTargetDescription][POKEMAN_MAX_BATTLE_SLOTS][POKEMAN_MAX_BATTLE_SLOTS];
+};
+
+/// Slots are adjacent when their lanes are at most one apart, on either side.
+constexpr MoveTargetMaskTable makeMoveTargetMaskTable() {
+  MoveTargetMaskTable table = {};
+  for(int description = 0; description < kNullTargetDescription; description++) {
+    const MoveTargetTraits& traits = kMoveTargetTraits[description];
+    for(int format = kSingles; format <= kTriples; format++) {
+      for(int position = 0; position < format; position++) {
+        MoveTargetMask mask = 0;
+        for(int slot = 0; slot < format; slot++) {
+          bool reachable = !traits.adjacent || (slot - position <= 1 && position - slot <= 1);
+          if(slot == position ? traits.self : traits.ally && reachable)
+            mask |= 1 << slot;
+          if(traits.foe && reachable)
+            mask |= 1 << (POKEMAN_MAX_BATTLE_SLOTS + slot);
+        }
+        table.masks[description][format - 1][position] = mask;
+      }
+    }
+  }
+  return table;
+}
+
+constexpr MoveTargetMaskTable kMoveTargetMasks = makeMoveTargetMaskTable();
+
+/// Slots a move used from position can reach, in a format.
+constexpr MoveTargetMask getMoveTargetMask(const MoveTargetDescription description, const BattleFormat format, const int position) {
+  return kMoveTargetMasks.masks[description][format - 1][position];
+}
+
+static_assert(getMoveTargetMask(kAllAdjacentFoes, kTriples, 0) == 0x18, "edge reaches two foes");
+static_assert(getMoveTargetMask(kAllAdjacent, kTriples, 1) == 0x3D, "middle reaches everyone else");
+static_assert(getMoveTargetMask(kAnyAdjacent, kSingles, 0) == 0x08, "singles has only the foe");
+
 class MonsterStats {
 public:
   /// Monster's stats
@@ -297,13 +424,193 @@ public:
 
   /// Index of move
   int number_;
+
+  /// Classification of move. (see classifyMove)
+  MoveFlags flags_;
+
+  /// Constructs as blank.
+  Move();
+};
+
+/// Derives the classification flags of a move from its fields.
+MoveFlags classifyMove(const Move& move);
+
+/// View of contiguous move ids owned by something else.
+class MoveIdSpan {
+private:
+  const MoveId* begin_;
+  const MoveId* end_;
+
+public:
+  /// Constructs as empty.
+  MoveIdSpan();
+
+  MoveIdSpan(const MoveId* begin, const MoveId* end);
+
+  /// Views the whole vector.
+  MoveIdSpan(const std::vector<MoveId>& moves);
+
+  const MoveId* begin() const;
+
+  const MoveId* end() const;
+
+  size_t size() const;
+
+  bool empty() const;
+
+  /// Copies the ids out.
+  std::vector<MoveId> toVector() const;
+};
+
+/// Set of moves, one bit per move id.
+/// Sets of different sizes combine as if padded with empty bits.
+class MoveSet {
+private:
+  std::vector<std::uint64_t> words_;
+
+public:
+  /// Constructs as empty.
+  MoveSet();
+
+  /// Constructs holding the given moves.
+  MoveSet(const MoveIdSpan moves);
+
+  /// Adds a move.
+  void insert(const MoveId id);
+
+  /// Removes a move.
+  void erase(const MoveId id);
+
+  /// True, if the move is in the set.
+  bool contains(const MoveId id) const;
+
+  /// Number of moves in the set.
+  int count() const;
+
+  /// True, if there are no moves in the set.
+  bool empty() const;
+
+  /// Moves in the set, by increasing id.
+  std::vector<MoveId> toVector() const;
+
+  /// Union.
+  MoveSet& operator|=(const MoveSet& that);
+
+  /// Intersection.
+  MoveSet& operator&=(const MoveSet& that);
+
+  /// Difference.
+  MoveSet& operator-=(const MoveSet& that);
+
+  MoveSet operator|(const MoveSet& that) const;
+
+  MoveSet operator&(const MoveSet& that) const;
+
+  MoveSet operator-(const MoveSet& that) const;
+};
+
+/// Interns moves to dense ids, and stores them contiguously.
+class MoveLibrary {
+private:
+  /// Moves, indexed by id
+  std::vector<Move> moves_;
+
+  /// Flags of moves, indexed by id
+  std::vector<MoveFlags> flags_;
+
+  /// Moves having each bit of MoveFlags
+  std::vector<MoveSet> flag_sets_;
+
+  /// Moves of each elemental type
+  MoveSet type_sets_[kNullType];
+
+  /// Moves of each category
+  MoveSet category_sets_[kNullMoveType];
+
+  /// Maps move name to id
+  std::map<std::string, MoveId, std::less<>> name_to_id_;
+
+public:
+  /// Retrieve move by id. Id must be valid.
+  const Move& get(const MoveId id) const;
+
+  /// Retrieve move by name, or nullptr if it does not exist.
+  const Move* get(const std::string& name) const;
+
+  /// Retrieve id by name, or kNullMoveId if it does not exist.
+  MoveId getId(const std::string_view name) const;
+
+  /// Retrieve flags of move by id. Id must be valid.
+  MoveFlags getFlags(const MoveId id) const;
+
+  /// Keeps the moves whose flags under mask equal value.
+  std::vector<MoveId> filterByFlags(const std::vector<MoveId>& moves, const MoveFlags mask, const MoveFlags value) const;
+
+  /// Retrieve set of all moves having the flag.
+  const MoveSet& getFlagSet(const MoveFlag flag) const;
+
+  /// Retrieve set of all moves of an elemental type.
+  const MoveSet& getTypeSet(const Type type) const;
+
+  /// Retrieve set of all moves of a category.
+  const MoveSet& getCategorySet(const MoveType category) const;
+
+  /// Add an entry, replacing any move of the same name. Returns its id.
+  MoveId set(const Move& move);
+
+  /// True, if id refers to a move in this library.
+  bool contains(const MoveId id) const;
+
+  /// Number of moves held.
+  int size() const;
+
+private:
+  /// Adds or removes a move from the sets it belongs in.
+  void indexMove(const MoveId id, const bool present);
+};
+
+/// Typings that each move of a library hits super effectively, and typings
+/// that resist or are immune to it. Only damaging moves that target foes
+/// have entries.
+class MoveCoverageTable {
+private:
+  std::vector<TypingSet> super_effective_;
+  std::vector<TypingSet> resisted_;
+  std::vector<bool> has_entry_;
+
+public:
+  /// Constructs as empty.
+  MoveCoverageTable();
+
+  /// Precomputes entries for every move in the library.
+  MoveCoverageTable(const MoveLibrary& moves, const TypeChart& chart);
+
+  /// Typings the move hits super effectively.
+  const TypingSet& getSuperEffective(const MoveId id) const;
+
+  /// Typings that resist or are immune to the move.
+  const TypingSet& getResisted(const MoveId id) const;
+
+  /// True, if the move is a damaging move that targets foes.
+  bool hasEntry(const MoveId id) const;
+
+  /// Typings hit super effectively by any of the moves.
+  TypingSet getCoverage(const MoveId* moves, const int count) const;
+
+  /// Typings that resist every one of the moves that has an entry.
+  /// If none do, nothing is walled.
+  TypingSet getWalls(const MoveId* moves, const int count) const;
 };
 
 /// Entry in a pokemon's learnset.
 class LearnsetMove {
 public:
-  /// Name of the move to be learned.
-  std::string move_name_;
+  /// Name of the move to be learned. (held by the species library's
+  /// names, or static)
+  std::string_view move_name_;
+
+  /// Id of the move to be learned. (kNullMoveId until resolved)
+  MoveId move_id_;
 
   /// Can be learned through HM or TM?
   bool b_machine_able_;
@@ -311,17 +618,24 @@ public:
   /// Can be learned through move tutor?
   bool b_tutor_able_;
 
-  /// Memo for move tutor.
-  std::string tutor_memo_;
+  /// Memo for move tutor. (held like the name)
+  std::string_view tutor_memo_;
 
   /// Which level is this learned at? (0 means it is not learned)
   int learned_at_level_;
 
   /// Blank constructor.
-  LearnsetMove(const std::string& name = "???");
+  LearnsetMove(const std::string_view name = "???");
 
   /// Set as a move tutorable move.
-  void setAsMoveTutorableWithMemo(std::string memo);
+  void setAsMoveTutorableWithMemo(const std::string_view memo);
+};
+
+/// Ways of learning moves, each including the ones before.
+enum LearnMethods {
+  kLevelUpOnly,
+  kLevelUpAndMachines,
+  kAllLearnMethods
 };
 
 /// Holds data for a pokemon's species.
@@ -330,20 +644,62 @@ public:
   /// What the species is called.
   std::string name_;
 
+  /// Pokedex number. (set when added to a library)
+  int number_;
+
   /// What type the species is.
   TypesHad type_;
 
   /// Learnset
   std::vector<LearnsetMove> learnset_;
 
+  /// Moves of the learnset, as a set. (filled when moves are resolved)
+  MoveSet movepool_;
+
+  /// Learnset ids laid out as tutor moves, then machine moves, then level
+  /// up moves by increasing level, so every query is one span.
+  /// A move learned more than one way shows up more than once.
+  /// (filled when moves are resolved)
+  std::vector<MoveId> learnset_index_;
+
+  /// Levels of the level up part of learnset_index_.
+  std::vector<int> learnset_levels_;
+
+  /// Where the machine and level up parts of learnset_index_ start.
+  size_t machine_start_;
+  size_t level_up_start_;
+
   /// Base stats
   MonsterStats base_stats_;
 
   /// What generation(s) this applies to
   std::bitset<POKEMAN_NUMBER_OF_GENERATIONS_TO_CAP> valid_generations;
 
-  /// retrieves movepool
-  std::vector<std::string> getMovepool() const;
+  MonsterSpecies();
+
+  /// Every move the species can learn.
+  MoveIdSpan getMovepool() const;
+
+  /// Moves learnable by the level cap, the ways allowed.
+  MoveIdSpan getMovepool(const int level_cap, const LearnMethods methods) const;
+
+  /// Rebuilds learnset_index_ from the learnset's resolved ids.
+  void indexLearnset();
+};
+
+/// Where a species library reads the species it hasn't loaded yet.
+class SpeciesSource {
+public:
+  /// Held while a library reads from the source.
+  std::mutex mutex_;
+
+  virtual ~SpeciesSource() {}
+
+  /// Dex number of every species in the source, by name.
+  virtual std::map<std::string, int> list() const = 0;
+
+  /// Reads a species, with its names kept by names. False, if it can't.
+  virtual bool read(const int number, StringArena* names, MonsterSpecies* species) = 0;
 };
 
 class MonsterSpeciesLibrary {
@@ -351,9 +707,24 @@ private:
   /// Maps species name to dex number
   std::map<std::string, int> name_to_number_;
 
-  /// Maps dex number to species
-  std::map<int, MonsterSpecies> number_to_species_;
+  /// Maps dex number to species. Species are read from the source into it
+  /// the first time they are asked for, even through const access.
+  mutable std::map<int, MonsterSpecies> number_to_species_;
+
+  /// Names the species' learnsets point into. Copies of the library share
+  /// them, and they are freed with the last one.
+  std::shared_ptr<StringArena> names_;
+
+  /// Species not read yet, if any, and the dex numbers still in it.
+  std::shared_ptr<SpeciesSource> source_;
+  mutable std::set<int> unread_;
+
+  /// Moves last resolved against, kept for species read afterwards.
+  std::shared_ptr<const MoveLibrary> resolved_moves_;
 public:
+  /// Constructs as empty.
+  MonsterSpeciesLibrary();
+
   /// Retrieve species by pokedex number
   MonsterSpecies* get(const int number);
   
@@ -366,12 +737,36 @@ public:
   /// Retrieve species by name
   const MonsterSpecies* get(const std::string& name) const;
 
-  /// Add an entry
-  void set(const int number, const MonsterSpecies& species);
+  /// Add an entry. Its learnset names must live as long as the library,
+  /// for instance by being interned in getNames.
+  void set(const int number, MonsterSpecies species);
+
+  /// Arena for names that species point to.
+  StringArena& getNames();
+
+  const StringArena& getNames() const;
+
+  /// Every species, in pokedex order. Reads any left in the source.
+  std::vector<const MonsterSpecies*> getAll() const;
+
+  /// Takes species from the source as they are asked for, instead of
+  /// holding them all. Every name and number in it is known right away.
+  void setSource(std::shared_ptr<SpeciesSource> source);
+
+  /// Looks up learnset move ids in the move library.
+  /// Returns the number of learnset moves that could not be found, and
+  /// describes each in dangling, if given.
+  int resolveMoves(const MoveLibrary& moves, std::vector<std::string>* dangling = nullptr);
 
 private:
-  /// True, if dex number has an entry.
-  bool numberExists(const int number) const;
+  /// Species by dex number, read from the source if need be, or null.
+  MonsterSpecies* find(const int number) const;
+
+  /// Reads a species from the source. The source's mutex must be held.
+  MonsterSpecies* read(const int number) const;
+
+  /// Looks up one species' learnset moves, counting those not found.
+  static int resolveSpecies(MonsterSpecies& species, const MoveLibrary& moves, std::vector<std::string>* dangling);
 
   /// True, if species name has an entry.
   bool nameExists(const std::string& name) const;
@@ -387,8 +782,11 @@ public:
   /// Species of the monster.
   const MonsterSpecies* species_;
 
-  /// HM/ moves to keep
-  std::vector<std::string> hm_moves_;
+  /// HM/ moves to keep; at most MOVESET_SIZE, each once
+  std::vector<MoveId> hm_moves_;
+
+  /// Level of the monster.
+  int level_;
 
 public:
   /// Construct with nickname & species/
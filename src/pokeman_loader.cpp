@@ -8,6 +8,7 @@
 
 #include <cassert>
 
+#include <algorithm>
 #include <iostream>
 
 #include "resources.hpp"
@@ -112,29 +113,142 @@ T parseOrError(Parser<T>* parser, YAML::Node node, ParserData* data) {
 
 //        finish private functions
 
-int ParserData::errorReport(YAML::Exception& exception) const {
-  printWhat();
-  printYAMLException(exception);
+int ParserData::errorReport(YAML::Exception& exception, std::ostream& out) const {
+  printWhat(out);
+  printYAMLException(exception, out);
   return 1;
 }
 
-int ParserData::errorReport() const {
-  printWhat();
+int ParserData::errorReport(std::ostream& out) const {
+  printWhat(out);
   return 1;
 }
 
-void ParserData::printWhat() const {
-  std::cerr << "[Error] Parsing: " << current_node_description_ << std::endl
+void ParserData::printWhat(std::ostream& out) const {
+  out << "[Error] Parsing: " << current_node_description_ << std::endl
     << " nodes scanned " << node_count_ << " status code: " << (int)state_ << std::endl;
 }
 
-void ParserData::printYAMLException(YAML::Exception & exception) const {
+void ParserData::printYAMLException(YAML::Exception & exception, std::ostream& out) const {
   if(!exception.mark.is_null()) {
-    std::cerr << "  Ln " << exception.mark.line << " Col "
+    out << "  Ln " << exception.mark.line << " Col "
       << exception.mark.column << " Pos"
       << exception.mark.pos << std::endl;
   }
-  std::cerr << exception.what() << std::endl;
+  out << exception.what() << std::endl;
+}
+
+RecordStreamHandler::RecordStreamHandler(const RecordCallback& callback) : callback_(callback), in_records_(false),
+  stopped_(false), record_count_(0) {}
+
+int RecordStreamHandler::getRecordCount() const {
+  return record_count_;
+}
+
+bool RecordStreamHandler::stopped() const {
+  return stopped_;
+}
+
+const std::string& RecordStreamHandler::getFailure() const {
+  return failure_;
+}
+
+const YAML::Mark& RecordStreamHandler::getFailureMark() const {
+  return failure_mark_;
+}
+
+void RecordStreamHandler::OnDocumentStart(const YAML::Mark& mark) {
+  open_.clear();
+  in_records_ = false;
+  anchors_.clear();
+}
+
+void RecordStreamHandler::OnDocumentEnd() {}
+
+void RecordStreamHandler::OnNull(const YAML::Mark& mark, YAML::anchor_t anchor) {
+  add(YAML::Node(YAML::NodeType::Null), anchor);
+}
+
+void RecordStreamHandler::OnAlias(const YAML::Mark& mark, YAML::anchor_t anchor) {
+  checkTopLevel(mark);
+  add(anchors_[anchor], YAML::NullAnchor);
+}
+
+void RecordStreamHandler::OnScalar(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor,
+  const std::string& value) {
+  checkTopLevel(mark);
+  add(YAML::Node(value), anchor);
+}
+
+void RecordStreamHandler::OnSequenceStart(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor,
+  YAML::EmitterStyle::value style) {
+  // the document's own sequence holds the items
+  if(open_.empty() && !in_records_) {
+    in_records_ = true;
+    return;
+  }
+  open(YAML::Node(YAML::NodeType::Sequence), anchor);
+}
+
+void RecordStreamHandler::OnSequenceEnd() {
+  if(open_.empty()) {
+    in_records_ = false;
+    return;
+  }
+  close();
+}
+
+void RecordStreamHandler::OnMapStart(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor,
+  YAML::EmitterStyle::value style) {
+  checkTopLevel(mark);
+  open(YAML::Node(YAML::NodeType::Map), anchor);
+}
+
+void RecordStreamHandler::OnMapEnd() {
+  close();
+}
+
+void RecordStreamHandler::add(YAML::Node node, const YAML::anchor_t anchor) {
+  // nodes share on assignment, so they are rebound with reset instead
+  if(anchor != YAML::NullAnchor) {
+    anchors_[anchor].reset(node);
+  }
+  if(open_.empty()) {
+    if(in_records_ && !stopped_) {
+      record_count_++;
+      stopped_ = !callback_(node);
+    }
+    return;
+  }
+
+  OpenNode& parent = open_.back();
+  if(parent.node.IsSequence()) {
+    parent.node.push_back(node);
+  } else if(!parent.has_key) {
+    parent.key.reset(node);
+    parent.has_key = true;
+  } else {
+    parent.node.force_insert(parent.key, node);
+    parent.has_key = false;
+  }
+}
+
+void RecordStreamHandler::open(YAML::Node node, const YAML::anchor_t anchor) {
+  open_.push_back({node, anchor, YAML::Node(), false});
+}
+
+void RecordStreamHandler::close() {
+  assert(!open_.empty());
+  OpenNode finished = open_.back();
+  open_.pop_back();
+  add(finished.node, finished.anchor);
+}
+
+void RecordStreamHandler::checkTopLevel(const YAML::Mark& mark) {
+  if(open_.empty() && !in_records_ && failure_.empty()) {
+    failure_ = "top level isn't a sequence";
+    failure_mark_ = mark;
+  }
 }
 
 ParserData::ParserData() {
@@ -198,29 +312,43 @@ MonsterSpeciesLibrary SpeciesParser::parse(YAML::Node species_library_root) {
   MonsterSpeciesLibrary species;
   int species_count = (int)species_library_root.size();
   for(int i = 0; i < species_count; i++) {
-    YAML::Node species_node = species_library_root[i];
-
-    // read number
-    int species_number = valueOrError<int>(species_node["number"], &data_);
-    if(!good()) {
-      data_.current_node_description_ = "reading number";
-      return MonsterSpeciesLibrary();
-    }
-
-    // read species
-    MonsterSpecies species_data = parseSpecies(species_node);
-    if(!good())
+    if(!parseInto(species_library_root[i], &species))
       return MonsterSpeciesLibrary();
-
-    // iterate
-    species.set(species_number, species_data);
-    data_.node_count_++;
   }
 
   // done
   return species;
 }
 
+bool SpeciesParser::parseInto(YAML::Node species_node, MonsterSpeciesLibrary * species) {
+  assert(species != nullptr);
+
+  // read number
+  int species_number = valueOrError<int>(species_node["number"], &data_);
+  if(!good()) {
+    data_.current_node_description_ = "reading number";
+    return false;
+  }
+
+  // read species, with names kept by the library
+  learnset_parser_.setNames(&species->getNames());
+  MonsterSpecies species_data = parseSpecies(species_node);
+  if(!good())
+    return false;
+
+  // iterate
+  species->set(species_number, std::move(species_data));
+  data_.node_count_++;
+  return true;
+}
+
+bool SpeciesParser::parseSpecies(YAML::Node species_node, StringArena * names, MonsterSpecies * species) {
+  assert(names != nullptr && species != nullptr);
+  learnset_parser_.setNames(names);
+  *species = parseSpecies(species_node);
+  return good();
+}
+
 MonsterSpecies SpeciesParser::parseSpecies(YAML::Node species_node) {
   MonsterSpecies species;
 
@@ -244,7 +372,14 @@ MonsterSpecies SpeciesParser::parseSpecies(YAML::Node species_node) {
   return species;
 }
 
-std::vector<LearnsetMove> LearnsetParser::parse(YAML::Node learnset_root) {std::map<std::string, LearnsetMove> learnset;
+LearnsetParser::LearnsetParser() : names_(nullptr) {}
+
+void LearnsetParser::setNames(StringArena * names) {
+  names_ = names;
+}
+
+std::vector<LearnsetMove> LearnsetParser::parse(YAML::Node learnset_root) {
+  assert(names_ != nullptr);
   data_.current_node_description_ = "Learnset";
   learnset_map_.clear();
   loadLearnsetOfLeveling(learnset_root["leveling"]);
@@ -255,7 +390,8 @@ std::vector<LearnsetMove> LearnsetParser::parse(YAML::Node learnset_root) {std::
 
 std::vector<LearnsetMove> LearnsetParser::learnsetMapToVector() {
   std::vector<LearnsetMove> learnset_list;
-  for(std::pair<std::string, LearnsetMove> pair : learnset_map_) {
+  learnset_list.reserve(learnset_map_.size());
+  for(const std::pair<const std::string_view, LearnsetMove>& pair : learnset_map_) {
     learnset_list.push_back(pair.second);
   }
   return learnset_list;
@@ -324,22 +460,26 @@ bool LearnsetParser::moveExists(const std::string & name) {
 
 void LearnsetParser::ensureMoveExists(const std::string & name) {
   if(!moveExists(name)) {
-    learnset_map_[name] = LearnsetMove(name);
+    std::string_view interned = names_->intern(name);
+    learnset_map_.emplace(interned, LearnsetMove(interned));
   }
 }
 
-MonsterParser::MonsterParser(const MonsterSpeciesLibrary * species_library) : species_library_(species_library) {}
+MonsterParser::MonsterParser(const MonsterSpeciesLibrary * species_library, const MoveLibrary * move_library) :
+  species_library_(species_library), move_library_(move_library) {}
 
 std::vector<Monster> MonsterParser::parse(YAML::Node team_root) {
   assert(species_library_ != nullptr);
+  assert(move_library_ != nullptr);
   data_.current_node_description_ = "Monster Team";
+  dangling_.clear();
   std::vector<Monster> team;
   const int team_count = (int)team_root.size();
   for(int i = 0; i < team_count; i++) {
     Monster monster = parseMonster(team_root[i]);
     if(!good()) {
       return std::vector<Monster>();
-    } else {
+    } else if(monster.species_ != nullptr) {
       team.push_back(monster);
     }
   }
@@ -348,26 +488,34 @@ std::vector<Monster> MonsterParser::parse(YAML::Node team_root) {
   return team; 
 }
 
+const std::vector<std::string>& MonsterParser::getDanglingReferences() const {
+  return dangling_;
+}
+
 void MonsterParser::setSpeciesLibrary(const MonsterSpeciesLibrary * species_library) {
   species_library_ = species_library;
 }
 
+void MonsterParser::setMoveLibrary(const MoveLibrary * move_library) {
+  move_library_ = move_library;
+}
+
 Monster MonsterParser::parseMonster(YAML::Node monster_node) {
   // Load species
-  data_.current_node_description_ = "Monster";
+  data_.current_node_description_ = valueOrDefault<std::string>(monster_node["name"],
+    valueOrDefault<std::string>(monster_node["species"], "Monster"));
   const MonsterSpecies* species = parseSpecies(monster_node["species"]);
-  if(!good() || species == nullptr) {
+  if(!good()) {
     data_.state_ = Parsing::Status::BadFieldValueError;
     return Monster();
-  } else {
-    data_.current_node_description_ = species->name_;
   }
 
-  // Load moves
-  std::vector<std::string> moves = parseMoves(monster_node["moves"]);
-  if(!good()) {
+  // Load moves, even for an unknown species, so they get reported too
+  std::vector<MoveId> moves = parseMoves(monster_node["moves"]);
+  if(!good() || species == nullptr) {
     return Monster();
   }
+  data_.current_node_description_ = species->name_;
 
   // get name
   std::string name = valueOrDefault(monster_node["name"], species->name_);
@@ -375,6 +523,7 @@ Monster MonsterParser::parseMonster(YAML::Node monster_node) {
   // make monster
   Monster monster(name, species);
   monster.hm_moves_ = moves;
+  monster.level_ = valueOrDefault<int>(monster_node["level"], POKEMAN_DEFAULT_LEVEL);
   return monster;
 }
 
@@ -388,52 +537,69 @@ const MonsterSpecies * MonsterParser::parseSpecies(YAML::Node species_node) {
   // get species pointer
   const MonsterSpecies* species_ptr = species_library_->get(species_name);
   if(species_ptr == nullptr) {
-    data_.current_node_description_ = "Pointer for "s + data_.current_node_description_ + " species "s + species_name;
-    data_.state_ = Parsing::Status::BadFieldValueError;
-    return nullptr;
-  } else {
-    return species_ptr;
+    dangling_.push_back("team member "s + data_.current_node_description_ + " is of unknown species "s + species_name);
   }
+  return species_ptr;
 
 }
 
-std::vector<std::string> MonsterParser::parseMoves(YAML::Node moves_sequence) {
-  std::vector<std::string> moves;
+/// A monster knows at most MOVESET_SIZE moves, each once.
+std::vector<MoveId> MonsterParser::parseMoves(YAML::Node moves_sequence) {
+  std::vector<MoveId> moves;
   int n_moves = (int)moves_sequence.size();
+  if(n_moves > MOVESET_SIZE) {
+    data_.current_node_description_ += " keeps more than " + std::to_string(MOVESET_SIZE) + " moves";
+    data_.state_ = Parsing::Status::BadFieldValueError;
+    return moves;
+  }
   for(int i = 0; i < n_moves; i++) {
-    std::string move = valueOrError<std::string>(moves_sequence[i], &data_);
+    std::string move_name = valueOrError<std::string>(moves_sequence[i], &data_);
     if(!good()) {
-      return std::vector<std::string>();
-    } else {
+      return std::vector<MoveId>();
+    }
+
+    // get move id
+    MoveId move = move_library_->getId(move_name);
+    if(move == kNullMoveId) {
+      dangling_.push_back("team member "s + data_.current_node_description_ + " keeps unknown move "s + move_name);
+    } else if(std::find(moves.begin(), moves.end(), move) == moves.end()) {
       moves.push_back(move);
     }
   }
   return moves;
 }
 
-std::map<std::string, Move> MoveLibraryParser::parse(YAML::Node moves_root) {
-  std::map<std::string, Move> moves;
+MoveLibrary MoveLibraryParser::parse(YAML::Node moves_root) {
+  MoveLibrary moves;
   int move_count = (int)moves_root.size();
   for(int i = 0; i < move_count; i++) {
-    // get name
-    std::string move_name = valueOrError<std::string>(moves_root[i]["name"], &data_);
-    if(!good()) {
-      return std::map<std::string, Move>();
-    } else {
-      data_.current_node_description_ = move_name;
-    }
-    
-    // get move
-    Move move = parseMove(moves_root[i]);
-    if(!good()) {
-      return std::map<std::string, Move>();
-    } else {
-      moves[move_name] = move;
-    }
+    if(!parseInto(moves_root[i], &moves))
+      return MoveLibrary();
   }
   return moves;
 }
 
+bool MoveLibraryParser::parseInto(YAML::Node move_node, MoveLibrary * moves) {
+  assert(moves != nullptr);
+
+  // get name
+  std::string move_name = valueOrError<std::string>(move_node["name"], &data_);
+  if(!good()) {
+    return false;
+  } else {
+    data_.current_node_description_ = move_name;
+  }
+
+  // get move
+  Move move = parseMove(move_node);
+  if(!good()) {
+    return false;
+  } else {
+    moves->set(move);
+  }
+  return true;
+}
+
 Move MoveLibraryParser::parseMove(YAML::Node move_node) {
 
   // Setup move with optionals
@@ -471,6 +637,9 @@ Move MoveLibraryParser::parseMove(YAML::Node move_node) {
   // Retrieve stat modifier node
   parseStatus(move_node["status"], &move);
 
+  // classify once, so analysis need not re-derive it
+  move.flags_ = classifyMove(move);
+
   // done
   return move;
 }
@@ -9,6 +9,12 @@
 #ifndef POKEMAN_POKEMAN_LOADER_HPP_
 #define POKEMAN_POKEMAN_LOADER_HPP_
 
+#include <functional>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include <yaml-cpp/eventhandler.h>
 #include <yaml-cpp/yaml.h>
 
 #include "pokeman.hpp"
@@ -53,14 +59,14 @@ public:
 
   /// print out an error
   /// returns 1, for error
-  int errorReport(YAML::Exception& exception) const;
+  int errorReport(YAML::Exception& exception, std::ostream& out = std::cerr) const;
 
   /// print out an error
   /// returns 1, for error
-  int errorReport() const;
+  int errorReport(std::ostream& out = std::cerr) const;
 private:
-  void printWhat() const;
-  void printYAMLException(YAML::Exception& exception) const;
+  void printWhat(std::ostream& out) const;
+  void printYAMLException(YAML::Exception& exception, std::ostream& out) const;
 };
 
 template<typename T>
@@ -80,6 +86,82 @@ public:
 
 };
 
+/// Builds the items of a document's top level sequence one at a time, as
+/// the yaml parser reads them, and hands each one over before the next is
+/// read. Only one item is held at once, not the whole document.
+class RecordStreamHandler : public YAML::EventHandler {
+public:
+  /// Takes an item. Returning false skips the rest.
+  typedef std::function<bool(YAML::Node)> RecordCallback;
+
+private:
+  /// A sequence or map being filled.
+  struct OpenNode {
+    YAML::Node node;
+    YAML::anchor_t anchor;
+
+    /// key waiting for its value, in a map
+    YAML::Node key;
+    bool has_key;
+  };
+
+  RecordCallback callback_;
+
+  /// Open nodes of the current item, outermost first.
+  std::vector<OpenNode> open_;
+
+  /// True, while inside the top level sequence.
+  bool in_records_;
+  bool stopped_;
+  int record_count_;
+
+  /// Why the document can't be read as items, if it can't, and where.
+  std::string failure_;
+  YAML::Mark failure_mark_;
+
+  /// Anchored nodes, so aliases can share them.
+  std::map<YAML::anchor_t, YAML::Node> anchors_;
+
+public:
+  RecordStreamHandler(const RecordCallback& callback);
+
+  /// Items handed over so far.
+  int getRecordCount() const;
+
+  /// True, if the callback asked to skip the rest.
+  bool stopped() const;
+
+  /// Empty, unless the document's top level isn't a sequence.
+  const std::string& getFailure() const;
+
+  const YAML::Mark& getFailureMark() const;
+
+  void OnDocumentStart(const YAML::Mark& mark) override;
+  void OnDocumentEnd() override;
+  void OnNull(const YAML::Mark& mark, YAML::anchor_t anchor) override;
+  void OnAlias(const YAML::Mark& mark, YAML::anchor_t anchor) override;
+  void OnScalar(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor, const std::string& value) override;
+  void OnSequenceStart(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor,
+    YAML::EmitterStyle::value style) override;
+  void OnSequenceEnd() override;
+  void OnMapStart(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor,
+    YAML::EmitterStyle::value style) override;
+  void OnMapEnd() override;
+
+private:
+  /// Places a finished node in the open node around it, or hands it over
+  /// if it is an item.
+  void add(YAML::Node node, const YAML::anchor_t anchor);
+
+  void open(YAML::Node node, const YAML::anchor_t anchor);
+
+  void close();
+
+  /// Fails, if a node starts at the top level. Null is let through, as an
+  /// empty document.
+  void checkTopLevel(const YAML::Mark& mark);
+};
+
 class TypeParser : public Parser<Type> {
 public:
   Type parse(YAML::Node type_node) override;
@@ -104,8 +186,15 @@ public:
 
 class LearnsetParser : public Parser<std::vector<LearnsetMove>> {
 private:
-  std::map<std::string, LearnsetMove> learnset_map_;
+  /// Keyed by interned name.
+  std::map<std::string_view, LearnsetMove> learnset_map_;
+  StringArena* names_;
 public:
+  LearnsetParser();
+
+  /// Move names and memos are interned here. Must be set before parsing.
+  void setNames(StringArena* names);
+
   std::vector<LearnsetMove> parse(YAML::Node learnset_root) override;
 
 private:
@@ -135,6 +224,13 @@ public:
   /// Parse data in node into returned library.
   MonsterSpeciesLibrary parse(YAML::Node species_library_root) override;
 
+  /// Parse one species into the library. False, on error.
+  bool parseInto(YAML::Node species_node, MonsterSpeciesLibrary* species);
+
+  /// Parse one species on its own, with its names kept by names. Its
+  /// number is left for the caller. False, on error.
+  bool parseSpecies(YAML::Node species_node, StringArena* names, MonsterSpecies* species);
+
 private:
   /// Parse one species.
   MonsterSpecies parseSpecies(YAML::Node species_node);
@@ -143,24 +239,33 @@ private:
 class MonsterParser : public Parser<std::vector<Monster>> {
 private:
   const MonsterSpeciesLibrary* species_library_;
+  const MoveLibrary* move_library_;
+  std::vector<std::string> dangling_;
 
 public:
-  MonsterParser(const MonsterSpeciesLibrary* species_library = nullptr);
+  MonsterParser(const MonsterSpeciesLibrary* species_library = nullptr, const MoveLibrary* move_library = nullptr);
 
+  /// Unknown species and moves don't stop the parse; they are collected
+  /// instead, and members of unknown species are left out.
   std::vector<Monster> parse(YAML::Node team_root) override;
 
+  /// Species and moves named by the last parse that don't exist.
+  const std::vector<std::string>& getDanglingReferences() const;
+
   void setSpeciesLibrary(const MonsterSpeciesLibrary* species_library);
 
+  void setMoveLibrary(const MoveLibrary* move_library);
+
 private:
   Monster parseMonster(YAML::Node monster_node);
 
   const MonsterSpecies* parseSpecies(YAML::Node species_node);
 
-  std::vector<std::string> parseMoves(YAML::Node moves_sequence);
+  std::vector<MoveId> parseMoves(YAML::Node moves_sequence);
 
 };
 
-class MoveLibraryParser : public Parser<std::map<std::string, Move>> {
+class MoveLibraryParser : public Parser<MoveLibrary> {
 private:
   MoveTargetParser move_target_parser_;
   TypeParser type_parser_;
@@ -168,7 +273,10 @@ private:
   MonsterStatsParser monster_stats_parser_;
 
 public:  
-  std::map<std::string, Move> parse(YAML::Node moves_root) override;
+  MoveLibrary parse(YAML::Node moves_root) override;
+
+  /// Parse one move into the library. False, on error.
+  bool parseInto(YAML::Node move_node, MoveLibrary* moves);
 
 private:
   Move parseMove(YAML::Node move_node);
@@ -0,0 +1,136 @@
+/*
+* rating_cache.cpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*/
+#include "rating_cache.hpp"
+
+#include <cassert>
+#include <cstring>
+
+#include <fstream>
+#include <vector>
+
+#define RATING_CACHE_MAGIC "PMRC"
+#define RATING_CACHE_FORMAT 1
+
+namespace pokeman {
+
+/// One rating as written to disk.
+struct RatingRecord {
+  int32_t species;
+  int32_t move;
+  int32_t level;
+  uint32_t version;
+  double rating;
+};
+
+bool RatingKey::operator==(const RatingKey & that) const {
+  return species == that.species && move == that.move && level == that.level && version == that.version;
+}
+
+size_t RatingKeyHash::operator()(const RatingKey & key) const {
+  uint64_t hash = (uint64_t)(uint32_t)key.species;
+  hash = hash * 0x9E3779B97F4A7C15ull + (uint32_t)key.move;
+  hash = hash * 0x9E3779B97F4A7C15ull + (uint32_t)key.level;
+  hash = hash * 0x9E3779B97F4A7C15ull + key.version;
+  return (size_t)(hash ^ (hash >> 32));
+}
+
+RatingCache::RatingCache() : hits_(0), misses_(0) {}
+
+bool RatingCache::find(const RatingKey & key, double * rating) const {
+  assert(rating != nullptr);
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unordered_map<RatingKey, double, RatingKeyHash>::const_iterator it = ratings_.find(key);
+  if(it == ratings_.end()) {
+    misses_++;
+    return false;
+  }
+  hits_++;
+  *rating = it->second;
+  return true;
+}
+
+void RatingCache::store(const RatingKey & key, const double rating) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ratings_[key] = rating;
+}
+
+size_t RatingCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return ratings_.size();
+}
+
+uint64_t RatingCache::hits() const {
+  return hits_;
+}
+
+uint64_t RatingCache::misses() const {
+  return misses_;
+}
+
+bool RatingCache::load(const std::string & filepath, const uint32_t version) {
+  std::ifstream file(filepath, std::ios::binary);
+  if(!file) {
+    return false;
+  }
+
+  // header
+  char magic[4];
+  uint32_t format = 0;
+  uint64_t count = 0;
+  file.read(magic, sizeof(magic));
+  file.read(reinterpret_cast<char*>(&format), sizeof(format));
+  file.read(reinterpret_cast<char*>(&count), sizeof(count));
+  if(!file || std::memcmp(magic, RATING_CACHE_MAGIC, sizeof(magic)) != 0 || format != RATING_CACHE_FORMAT) {
+    return false;
+  }
+
+  // records, refusing more than the file holds
+  std::streamoff start = file.tellg();
+  file.seekg(0, std::ios::end);
+  std::streamoff end = file.tellg();
+  file.seekg(start);
+  if(!file || start < 0 || end < start || count > (uint64_t)(end - start) / sizeof(RatingRecord)) {
+    return false;
+  }
+  std::vector<RatingRecord> records((size_t)count);
+  file.read(reinterpret_cast<char*>(records.data()), (std::streamsize)(records.size() * sizeof(RatingRecord)));
+  if(!file) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  for(const RatingRecord& record : records) {
+    if(record.version == version)
+      ratings_[{record.species, record.move, record.level, record.version}] = record.rating;
+  }
+  return true;
+}
+
+bool RatingCache::save(const std::string & filepath) const {
+  std::vector<RatingRecord> records;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    records.reserve(ratings_.size());
+    for(const std::pair<const RatingKey, double>& pair : ratings_) {
+      const RatingKey& key = pair.first;
+      records.push_back({key.species, key.move, key.level, key.version, pair.second});
+    }
+  }
+
+  std::ofstream file(filepath, std::ios::binary | std::ios::trunc);
+  if(!file) {
+    return false;
+  }
+  uint32_t format = RATING_CACHE_FORMAT;
+  uint64_t count = records.size();
+  file.write(RATING_CACHE_MAGIC, 4);
+  file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+  file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  file.write(reinterpret_cast<const char*>(records.data()), (std::streamsize)(records.size() * sizeof(RatingRecord)));
+  return (bool)file;
+}
+
+} // namespace pokeman
@@ -0,0 +1,75 @@
+/*
+* rating_cache.hpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*
+* Remembers move ratings by species, so they are worked out once.
+*/
+#ifndef POKEMAN_RATING_CACHE_HPP_
+#define POKEMAN_RATING_CACHE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "pokeman.hpp"
+
+namespace pokeman {
+
+/// What a rating depends on.
+struct RatingKey {
+  /// Pokedex number of the species.
+  int species;
+  MoveId move;
+  int level;
+
+  /// Stamp of the scoring rules and data the rating came from.
+  uint32_t version;
+
+  bool operator==(const RatingKey& that) const;
+};
+
+struct RatingKeyHash {
+  size_t operator()(const RatingKey& key) const;
+};
+
+/// Thread safe map from rating keys to ratings, that can be kept on disk.
+class RatingCache {
+private:
+  mutable std::mutex mutex_;
+  std::unordered_map<RatingKey, double, RatingKeyHash> ratings_;
+  mutable std::atomic<uint64_t> hits_;
+  mutable std::atomic<uint64_t> misses_;
+
+public:
+  RatingCache();
+
+  /// Sets rating and returns true, if the key is cached.
+  bool find(const RatingKey& key, double* rating) const;
+
+  /// Caches a rating.
+  void store(const RatingKey& key, const double rating);
+
+  /// Number of cached ratings.
+  size_t size() const;
+
+  uint64_t hits() const;
+
+  uint64_t misses() const;
+
+  /// Reads ratings saved with the version, skipping the rest.
+  /// False, if the file is missing or not a rating cache.
+  bool load(const std::string& filepath, const uint32_t version);
+
+  /// Writes every cached rating. False, if the file can't be written.
+  bool save(const std::string& filepath) const;
+};
+
+} // namespace pokeman
+
+#endif //POKEMAN_RATING_CACHE_HPP_
@@ -9,9 +9,17 @@
 #include <cassert>
 #include <cstring>
 
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <sstream>
 
+#include "event_readers.hpp"
+#include "pmdb.hpp"
 #include "pokeman_loader.hpp"
+#include "species_index.hpp"
 
 namespace pokeman {
 
@@ -99,8 +107,19 @@ static const TypeEffectivenessName kTimesDescriptionNames[] = {
   {"NULLish", kNullTimes}
 };
 
+/// Stats as laid out in compiled database records.
+static MonsterStats toStats(const int32_t stats[6]) {
+  MonsterStats result;
+  result.hp_ = stats[0];
+  result.attack_ = stats[1];
+  result.defense_ = stats[2];
+  result.special_attack_ = stats[3];
+  result.special_defense_ = stats[4];
+  result.speed_ = stats[5];
+  return result;
+}
 
-pokeman::resources::PokemanDatabase resources::initialize(bool* error_occured) {
+pokeman::resources::PokemanDatabase resources::initialize(bool* error_occured, const bool lazy_species) {
   assert(error_occured != nullptr);
   Loader loader(FILEPATH_CONFIG);
   if(loader.errorOccured()) {
@@ -108,7 +127,7 @@ pokeman::resources::PokemanDatabase resources::initialize(bool* error_occured) {
     return PokemanDatabase();
   } else {
     PokemanDatabase database;
-    *error_occured = !database.load(loader);
+    *error_occured = !database.load(loader, lazy_species);
     return database;
   }
 }
@@ -435,11 +454,11 @@ std::map<int, MonsterSpecies> resources::generateGen5Species() {
 }
 } //namespace resources
 
-pokeman::resources::Loader::Loader() {
-  // do nothing
-}
+pokeman::resources::Loader::Loader() : b_loaded_(false), bad_file_error_occured_(false),
+  file_parser_error_(false), uninitialized_error_(false), config_parse_error_(false),
+  unknown_error_occured_(false), log_(&std::cerr) {}
 
-pokeman::resources::Loader::Loader(const std::string & config_filepath) {
+pokeman::resources::Loader::Loader(const std::string & config_filepath) : Loader() {
   loadConfig(config_filepath);
 }
 
@@ -453,9 +472,82 @@ YAML::Node pokeman::resources::Loader::loadResource(LoaderTool::LoaderType type)
   if(!typeHasFilepathSet(type)) {
     uninitialized_error_ = true;
     return YAML::Node();
+  }
+  const std::string& filepath = filepath_.at(type);
+  if(getDataFormat(filepath) == kYamlFormat) {
+    return loadFromFile(filepath);
+  }
+
+  // the other formats only hold a sequence of records
+  YAML::Node node(YAML::NodeType::Sequence);
+  if(!streamResource(type, [&node](YAML::Node record) {
+    node.push_back(record);
+    return true;
+  })) {
+    return YAML::Node();
+  }
+  return node;
+}
+
+bool pokeman::resources::Loader::streamResource(LoaderTool::LoaderType type,
+  const std::function<bool(YAML::Node)>& record) {
+  if(!typeHasFilepathSet(type)) {
+    uninitialized_error_ = true;
+    return false;
+  }
+  const std::string& filepath = filepath_.at(type);
+  std::ifstream file(filepath, std::ios::binary);
+  if(!file) {
+    *log_ << "[Error] cannot load " << filepath << std::endl << "  "
+      << "bad file: " << filepath << std::endl;
+    bad_file_error_occured_ = true;
+    return false;
+  }
+
+  RecordStreamHandler handler(record);
+  DataFormat format = getDataFormat(filepath);
+  if(format == kJsonFormat) {
+    JsonEventReader reader(file);
+    if(!reader.read(handler)) {
+      reportParseError(filepath, reader.getErrorMark(), reader.getError());
+      return false;
+    }
+  } else if(format == kCsvFormat) {
+    CsvEventReader reader(file);
+    if(!reader.read(handler)) {
+      reportParseError(filepath, reader.getErrorMark(), reader.getError());
+      return false;
+    }
   } else {
-    return loadFromFile(filepath_.at(type));
+    try {
+      YAML::Parser parser(file);
+      parser.HandleNextDocument(handler);
+    } catch (YAML::ParserException& e) {
+      reportParseError(filepath, e.mark, e.what());
+      return false;
+    } catch (YAML::Exception& e) {
+      *log_ << "[Error] loading " << filepath << std::endl << "  "
+        << e.what() << std::endl;
+      unknown_error_occured_ = true;
+      return false;
+    }
+  }
+
+  // items are all there is, so anything else at the top is malformed
+  if(!handler.getFailure().empty()) {
+    reportParseError(filepath, handler.getFailureMark(), handler.getFailure());
+    return false;
   }
+  return !handler.stopped();
+}
+
+bool pokeman::resources::Loader::getFilepath(LoaderTool::LoaderType type, std::string * filepath) const {
+  assert(filepath != nullptr);
+  if(!typeHasFilepathSet(type)) {
+    return false;
+  }
+  *filepath = filepath_.at(type);
+  return true;
 }
 
 bool pokeman::resources::Loader::errorOccured() const {
@@ -463,6 +555,14 @@ bool pokeman::resources::Loader::errorOccured() const {
     || config_parse_error_;
 }
 
+void pokeman::resources::Loader::takeErrors(const Loader & that) {
+  bad_file_error_occured_ = bad_file_error_occured_ || that.bad_file_error_occured_;
+  file_parser_error_ = file_parser_error_ || that.file_parser_error_;
+  uninitialized_error_ = uninitialized_error_ || that.uninitialized_error_;
+  config_parse_error_ = config_parse_error_ || that.config_parse_error_;
+  unknown_error_occured_ = unknown_error_occured_ || that.unknown_error_occured_;
+}
+
 void pokeman::resources::Loader::parseConfig(YAML::Node node) {
   for(int i = 0; i < LoaderTool::kLoaderTypeSize; i++) {
     LoaderTool::LoaderType type = (LoaderTool::LoaderType)i;
@@ -471,7 +571,7 @@ void pokeman::resources::Loader::parseConfig(YAML::Node node) {
       try {
         filepath_[type] = filename_node.as<std::string>();
       } catch (YAML::BadConversion) {
-        std::cerr << "[Error] extracting info from '" << LoaderTool::toString(type)
+        *log_ << "[Error] extracting info from '" << LoaderTool::toString(type)
           << "' field" << std::endl;
         config_parse_error_ = true;
         return;
@@ -485,24 +585,29 @@ YAML::Node pokeman::resources::Loader::loadFromFile(const std::string & filepath
   try {
     return YAML::LoadFile(filepath);
   } catch (YAML::ParserException& e) {
-    std::cerr << "[Error] parsing " << filepath << std::endl 
-      << "  line " << e.mark.line << " col " << e.mark.column << " pos " << e.mark.pos << std::endl
-      << "  " << e.what() << std::endl;
-    file_parser_error_ = true;
+    reportParseError(filepath, e.mark, e.what());
     return YAML::Node();
   } catch (YAML::BadFile& e) {
-    std::cerr << "[Error] cannot load " << filepath << std::endl << "  "
+    *log_ << "[Error] cannot load " << filepath << std::endl << "  "
       << e.what() << std::endl;
     bad_file_error_occured_ = true;
     return YAML::Node();
   } catch (YAML::Exception& e) {
-    std::cerr << "[Error] loading " << filepath << std::endl << "  "
+    *log_ << "[Error] loading " << filepath << std::endl << "  "
       << e.what() << std::endl;
     unknown_error_occured_ = true;
     return YAML::Node();
   }
 }
 
+void pokeman::resources::Loader::reportParseError(const std::string & filepath, const YAML::Mark & mark,
+  const std::string & message) {
+  *log_ << "[Error] parsing " << filepath << std::endl
+    << "  line " << mark.line << " col " << mark.column << " pos " << mark.pos << std::endl
+    << "  " << message << std::endl;
+  file_parser_error_ = true;
+}
+
 bool pokeman::resources::Loader::typeHasFilepathSet(LoaderTool::LoaderType type) const {
   return filepath_.find(type) != filepath_.end();
 }
@@ -521,6 +626,22 @@ std::string pokeman::resources::LoaderTool::toString(LoaderType type) {
     return "moves";
     break;
 
+  case kRatingCache:
+    return "ratings";
+    break;
+
+  case kMovesetTable:
+    return "movesets";
+    break;
+
+  case kScoring:
+    return "scoring";
+    break;
+
+  case kCompiledDatabase:
+    return "database";
+    break;
+
   default:
     assert(false);
     return "???";
@@ -538,17 +659,144 @@ pokeman::resources::LoaderTool::LoaderType pokeman::resources::LoaderTool::toCod
   return kLoaderTypeSize;
 }
 
-bool pokeman::resources::PokemanDatabase::load(Loader & loader) {
+bool pokeman::resources::PokemanDatabase::load(Loader & loader, const bool lazy_species) {
+  std::string filepath;
+  if(loader.getFilepath(LoaderTool::kCompiledDatabase, &filepath) && std::filesystem::exists(filepath)) {
+    loader_ = &loader;
+    std::string error;
+    if(loadCompiled(filepath, getPmdbSourceStamp(loader), &error)) {
+      return true;
+    }
+    std::cerr << "[Warning] ignoring " << filepath << ": " << error << std::endl;
+  }
+  return loadSources(loader, lazy_species);
+}
+
+/// Species and moves don't need each other, so moves load on another
+/// thread, with their own copy of the loader. Their errors are held back
+/// and only shown if the species loaded, as if loaded one after the other.
+bool pokeman::resources::PokemanDatabase::loadSources(Loader & loader, const bool lazy_species) {
   loader_ = &loader;
   chart_ = generateTypeChartGen5(); // todo: file it?
-  return loadSpecies() && loadMoves() && loadTeam();
+
+  Loader move_loader = loader;
+  std::ostringstream move_log;
+  move_loader.log_ = &move_log;
+  std::future<bool> moves_loaded = std::async(std::launch::async, [this, &move_loader, &move_log]() {
+    return loadMoves(move_loader, move_log);
+  });
+  bool species_loaded = lazy_species ? loadSpeciesIndex(loader, *loader.log_) : loadSpecies(loader, *loader.log_);
+  bool moves_good = moves_loaded.get();
+  if(!species_loaded) {
+    return false;
+  }
+  *loader.log_ << move_log.str();
+  loader.takeErrors(move_loader);
+  std::vector<std::string> dangling;
+  return moves_good && loadTeam(&dangling) && resolveReferences(&dangling);
+}
+
+/// Ids in the file are already resolved, so the libraries are filled
+/// straight from the records without looking up any names. The records
+/// are copied out rather than viewed in place, so the analysis code only
+/// ever sees one kind of library; the mapping is closed once they are.
+bool pokeman::resources::PokemanDatabase::loadCompiled(const std::string & filepath, const uint64_t source_stamp,
+  std::string * error) {
+  assert(error != nullptr);
+  PmdbFile file;
+  if(!file.open(filepath, error)) {
+    return false;
+  }
+  const PmdbHeader& header = file.getHeader();
+  if(header.source_stamp != source_stamp) {
+    *error = "out of date with its sources";
+    return false;
+  }
+  chart_ = generateTypeChartGen5();
+
+  // moves, in id order
+  moves_ = MoveLibrary();
+  for(uint32_t i = 0; i < header.move_count; i++) {
+    const PmdbMove& record = file.getMoves()[i];
+    Move move;
+    move.name_ = file.getString(record.name);
+    move.move_type_ = (MoveType)record.move_type;
+    move.elemental_type_ = (Type)record.elemental_type;
+    move.power_ = record.power;
+    move.accuracy_ = record.accuracy;
+    move.status_effect_chance_self_ = record.status_effect_chance_self;
+    move.status_effect_change_target_ = record.status_effect_chance_target;
+    move.stat_modifiers_self_ = toStats(record.stat_modifiers_self);
+    move.stat_modifiers_target_ = toStats(record.stat_modifiers_target);
+    move.hm_ = record.hm;
+    move.tm_ = record.tm;
+    move.target_ = (MoveTargetDescription)record.target;
+    move.pp_ = record.pp;
+    move.number_ = record.number;
+    move.flags_ = record.flags;
+    move.valid_generations_ = std::bitset<POKEMAN_NUMBER_OF_GENERATIONS_TO_CAP>(record.valid_generations);
+    if(moves_.set(move) != (MoveId)i) {
+      *error = "move " + move.name_ + " is listed twice";
+      return false;
+    }
+  }
+
+  // species, with their learnsets
+  species_ = MonsterSpeciesLibrary();
+  for(uint32_t i = 0; i < header.species_count; i++) {
+    const PmdbSpecies& record = file.getSpecies()[i];
+    MonsterSpecies species;
+    species.name_ = file.getString(record.name);
+    species.type_ = record.dual_type ? TypesHad((Type)record.first_type, (Type)record.second_type)
+      : TypesHad((Type)record.first_type);
+    species.base_stats_ = toStats(record.base_stats);
+    species.valid_generations = std::bitset<POKEMAN_NUMBER_OF_GENERATIONS_TO_CAP>(record.valid_generations);
+    species.learnset_.reserve(record.learnset_count);
+    for(uint32_t j = 0; j < record.learnset_count; j++) {
+      const PmdbLearnsetMove& learnset_record = file.getLearnset()[record.learnset_first + j];
+      LearnsetMove move(species_.getNames().intern(file.getString(learnset_record.move_name)));
+      move.move_id_ = learnset_record.move_id;
+      move.learned_at_level_ = learnset_record.learned_at_level;
+      move.b_machine_able_ = (learnset_record.methods & PMDB_LEARNSET_MACHINE) != 0;
+      move.b_tutor_able_ = (learnset_record.methods & PMDB_LEARNSET_TUTOR) != 0;
+      move.tutor_memo_ = species_.getNames().intern(file.getString(learnset_record.tutor_memo));
+      if(move.move_id_ != kNullMoveId)
+        species.movepool_.insert(move.move_id_);
+      species.learnset_.push_back(move);
+    }
+    species.indexLearnset();
+    species_.set(record.number, std::move(species));
+  }
+
+  // team
+  team_.clear();
+  for(uint32_t i = 0; i < header.team_count; i++) {
+    const PmdbTeamMember& record = file.getTeam()[i];
+    Monster monster(file.getString(record.name), species_.get(record.species_number));
+    if(monster.species_ == nullptr) {
+      *error = "team member " + monster.name_ + " is of an unknown species";
+      return false;
+    }
+    monster.level_ = record.level;
+    if(record.moves_count > MOVESET_SIZE) {
+      *error = "team member " + monster.name_ + " keeps more than " + std::to_string(MOVESET_SIZE) + " moves";
+      return false;
+    }
+    const MoveId* moves = file.getTeamMoves() + record.moves_first;
+    for(uint32_t j = 0; j < record.moves_count; j++) {
+      if(std::find(monster.hm_moves_.begin(), monster.hm_moves_.end(), moves[j]) == monster.hm_moves_.end())
+        monster.hm_moves_.push_back(moves[j]);
+    }
+    team_.push_back(monster);
+  }
+  return true;
 }
 
 const std::vector<pokeman::Monster>& pokeman::resources::PokemanDatabase::getTeam() const {
   return team_;
 }
 
-const std::map<std::string, pokeman::Move>& pokeman::resources::PokemanDatabase::getMoves() const {
+const pokeman::MoveLibrary& pokeman::resources::PokemanDatabase::getMoves() const {
   return moves_;
 }
 
@@ -560,30 +808,77 @@ const pokeman::TypeChart & pokeman::resources::PokemanDatabase::getChart() const
   return chart_;
 }
 
-bool pokeman::resources::PokemanDatabase::loadTeam() {
+bool pokeman::resources::PokemanDatabase::loadTeam(std::vector<std::string>* dangling) {
+  assert(dangling != nullptr);
   MonsterParser parser;
   parser.setSpeciesLibrary(&species_);
+  parser.setMoveLibrary(&moves_);
   team_ = parser.parse(loader_->loadResource(resources::LoaderTool::kTeam));
   if(!parser.good()) {
     parser.getParserData().errorReport();
   }
+  dangling->insert(dangling->end(), parser.getDanglingReferences().begin(), parser.getDanglingReferences().end());
   return !loader_->errorOccured() && parser.good();
 }
 
-bool pokeman::resources::PokemanDatabase::loadMoves() {
+bool pokeman::resources::PokemanDatabase::loadMoves(Loader & loader, std::ostream & log) {
   MoveLibraryParser parser;
-  moves_ = parser.parse(loader_->loadResource(resources::LoaderTool::kMoves));
+  moves_ = MoveLibrary();
+  bool streamed = loader.streamResource(resources::LoaderTool::kMoves, [this, &parser](YAML::Node move_node) {
+    return parser.parseInto(move_node, &moves_);
+  });
   if(!parser.good()) {
-    parser.getParserData().errorReport();
+    moves_ = MoveLibrary();
+    // a file that can't be read was already reported by the loader
+    if(!loader.errorOccured())
+      parser.getParserData().errorReport(log);
   }
-  return !loader_->errorOccured() && parser.good();
+  return streamed && !loader.errorOccured() && parser.good();
 }
 
-bool pokeman::resources::PokemanDatabase::loadSpecies() {
+/// Every name is looked up here, once, so analysis only ever sees ids.
+bool pokeman::resources::PokemanDatabase::resolveReferences(std::vector<std::string>* dangling) {
+  assert(dangling != nullptr);
+  species_.resolveMoves(moves_, dangling);
+  if(dangling->empty()) {
+    return true;
+  }
+  *loader_->log_ << "[Error] " << dangling->size() << " references to species or moves that don't exist:" << std::endl;
+  for(const std::string& reference : *dangling) {
+    *loader_->log_ << "  " << reference << std::endl;
+  }
+  return false;
+}
+
+bool pokeman::resources::PokemanDatabase::loadSpecies(Loader & loader, std::ostream & log) {
   SpeciesParser parser;
-  species_ = parser.parse(loader_->loadResource(resources::LoaderTool::kSpecies));
+  species_ = MonsterSpeciesLibrary();
+  bool streamed = loader.streamResource(resources::LoaderTool::kSpecies, [this, &parser](YAML::Node species_node) {
+    return parser.parseInto(species_node, &species_);
+  });
   if(!parser.good()) {
-    parser.getParserData().errorReport();
+    species_ = MonsterSpeciesLibrary();
+    // a file that can't be read was already reported by the loader
+    if(!loader.errorOccured())
+      parser.getParserData().errorReport(log);
   }
-  return !loader_->errorOccured() && parser.good();
+  return streamed && !loader.errorOccured() && parser.good();
+}
+
+/// Only yaml files are indexed. Species are parsed as the team and the
+/// drivers ask for them, so unknown moves in species nobody asks for go
+/// unreported.
+bool pokeman::resources::PokemanDatabase::loadSpeciesIndex(Loader & loader, std::ostream & log) {
+  std::string filepath;
+  if(loader.getFilepath(resources::LoaderTool::kSpecies, &filepath) && getDataFormat(filepath) == kYamlFormat) {
+    std::shared_ptr<SpeciesIndex> index = std::make_shared<SpeciesIndex>();
+    std::string error;
+    if(index->open(filepath, &error)) {
+      species_ = MonsterSpeciesLibrary();
+      species_.setSource(index);
+      return true;
+    }
+    log << "[Warning] reading every species, since " << filepath << " can't be indexed: " << error << std::endl;
+  }
+  return loadSpecies(loader, log);
 }
@@ -10,7 +10,11 @@
 #ifndef POKEMAN_RESOURCES_HPP_
 #define POKEMAN_RESOURCES_HPP_
 
+#include <cstdint>
+
+#include <functional>
 #include <map>
+#include <ostream>
 #include <string>
 
 #include <yaml-cpp/yaml.h>
@@ -34,6 +38,10 @@ enum LoaderType {
   kSpecies,
   kTeam,
   kMoves,
+  kRatingCache,
+  kMovesetTable,
+  kScoring,
+  kCompiledDatabase,
   kLoaderTypeSize
 };
 
@@ -65,6 +73,9 @@ public:
   /// When true, unknown error occured.
   bool unknown_error_occured_;
 
+  /// Where errors are written. (std::cerr by default)
+  std::ostream* log_;
+
 public:
   /// Initializes as blank
   Loader();
@@ -75,12 +86,24 @@ public:
   /// reads configuration.
   void loadConfig(const std::string& filepath);
 
-  /// loads up node from file corresponding to the code
+  /// loads up node from file corresponding to the code. Files ending in
+  /// .json or .csv are read as those, the rest as yaml.
   YAML::Node loadResource(LoaderTool::LoaderType type);
 
+  /// Reads the file corresponding to the code as a stream, handing record
+  /// each item of its top level sequence as soon as it is read. Stops
+  /// handing them over once record returns false. False, on error.
+  bool streamResource(LoaderTool::LoaderType type, const std::function<bool(YAML::Node)>& record);
+
+  /// Sets filepath to the configured path for the code. False, if there is none.
+  bool getFilepath(LoaderTool::LoaderType type, std::string* filepath) const;
+
   /// if true, last operation caused an error.
   bool errorOccured() const;
 
+  /// Raises the error flags raised in another loader.
+  void takeErrors(const Loader& that);
+
 private:
   /// Loads in changes from config
   void parseConfig(YAML::Node node);
@@ -88,6 +111,9 @@ private:
   /// Exception safe.
   YAML::Node loadFromFile(const std::string& filepath);
 
+  /// Logs where a file failed to parse.
+  void reportParseError(const std::string& filepath, const YAML::Mark& mark, const std::string& message);
+
   /// false, if type does not exist in filepath map.
   bool typeHasFilepathSet(LoaderTool::LoaderType type) const;
 };
@@ -95,20 +121,30 @@ private:
 class PokemanDatabase {
 private:
   std::vector<Monster> team_;
-  std::map<std::string, Move> moves_;
+  MoveLibrary moves_;
   MonsterSpeciesLibrary species_;
   resources::Loader* loader_;
   TypeChart chart_;
 
 public:
-  /// When true, successful.
-  bool load(Loader& loader);
+  /// When true, successful. Takes the compiled database, if there is one
+  /// compiled from the current sources, and the sources otherwise.
+  /// With lazy_species, species are only read from the sources as they are
+  /// asked for. (see loadSpeciesIndex)
+  bool load(Loader& loader, const bool lazy_species = false);
+
+  /// Loads the yaml sources, ignoring any compiled database.
+  bool loadSources(Loader& loader, const bool lazy_species = false);
+
+  /// Loads a compiled database, refusing one compiled from other sources
+  /// than the stamp says. On failure, error says why.
+  bool loadCompiled(const std::string& filepath, const uint64_t source_stamp, std::string* error);
 
   /// retrieve reference to team
   const std::vector<Monster>& getTeam() const;
 
   /// retrieve reference to moves
-  const std::map<std::string, Move>& getMoves() const;
+  const MoveLibrary& getMoves() const;
 
   /// retrieve reference to species
   const MonsterSpeciesLibrary& getSpecies() const;
@@ -116,15 +152,24 @@ public:
   const TypeChart& getChart() const;
 
 private:
-  bool loadTeam();
+  /// Unknown species and moves in the team are kept for resolveReferences.
+  bool loadTeam(std::vector<std::string>* dangling);
+
+  bool loadMoves(Loader& loader, std::ostream& log);
+
+  bool loadSpecies(Loader& loader, std::ostream& log);
 
-  bool loadMoves();
+  /// Indexes the species file instead of reading it, so species are read
+  /// the first time they are asked for. Reads them all if it can't.
+  bool loadSpeciesIndex(Loader& loader, std::ostream& log);
 
-  bool loadSpecies();
+  /// Resolves learnset move names into ids. Fails, reporting every
+  /// reference that doesn't exist, if there are any, here or in dangling.
+  bool resolveReferences(std::vector<std::string>* dangling);
 };
 
 /// Loads up all the resources from file.
-PokemanDatabase initialize(bool* error_occured);
+PokemanDatabase initialize(bool* error_occured, const bool lazy_species = false);
 
 /// picks up string corresponding to a type
 std::string getTypeName(Type type);
@@ -0,0 +1,418 @@
+/*
+* scoring_expression.cpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*/
+#include "scoring_expression.hpp"
+
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+
+namespace pokeman {
+
+static const char* const kScoringVariableNames[kScoringVariableCount] = {
+  "power",
+  "accuracy",
+  "pp",
+  "physical",
+  "special",
+  "status",
+  "stab",
+  "suited",
+  "damage",
+  "hp",
+  "attack",
+  "defense",
+  "special_attack",
+  "special_defense",
+  "speed",
+  "level"
+};
+
+const char* getScoringVariableName(const ScoringVariable variable) {
+  assert(variable >= 0 && variable < kScoringVariableCount);
+  return kScoringVariableNames[variable];
+}
+
+ScoringBatch::ScoringBatch() : size_(0) {}
+
+void ScoringBatch::resize(const size_t count) {
+  size_ = count;
+  for(int i = 0; i < kScoringVariableCount; i++) {
+    columns_[i].assign(count, 0.0);
+  }
+}
+
+size_t ScoringBatch::size() const {
+  return size_;
+}
+
+double* ScoringBatch::column(const ScoringVariable variable) {
+  return columns_[variable].data();
+}
+
+const double* ScoringBatch::column(const ScoringVariable variable) const {
+  return columns_[variable].data();
+}
+
+/// Recursive descent over the source, emitting code as it goes.
+class ScoringExpression::Compiler {
+private:
+  const std::string& source_;
+  size_t position_;
+  std::vector<Instruction>* code_;
+  std::vector<double>* constants_;
+  int depth_;
+  int max_depth_;
+  std::string error_;
+
+public:
+  Compiler(const std::string& source, std::vector<Instruction>* code, std::vector<double>* constants) :
+    source_(source), position_(0), code_(code), constants_(constants), depth_(0), max_depth_(0) {}
+
+  /// False, with the error set, if the source doesn't compile.
+  bool run() {
+    parseTernary();
+    skipSpace();
+    if(error_.empty() && position_ < source_.size()) {
+      fail(std::string("unexpected '") + source_[position_] + "'");
+    }
+    return error_.empty();
+  }
+
+  const std::string& getError() const {
+    return error_;
+  }
+
+  int getMaxDepth() const {
+    return max_depth_;
+  }
+
+private:
+  void fail(const std::string& message) {
+    if(error_.empty()) {
+      error_ = message + " at column " + std::to_string(position_ + 1);
+    }
+  }
+
+  /// Emits an instruction that takes pops values and leaves one.
+  void emit(const Op op, const int pops, const int argument = 0) {
+    code_->push_back({op, argument});
+    depth_ += 1 - pops;
+    max_depth_ = std::max(max_depth_, depth_);
+  }
+
+  void skipSpace() {
+    while(position_ < source_.size() && std::isspace((unsigned char)source_[position_]))
+      position_++;
+  }
+
+  /// Consumes the token, if it is next.
+  bool accept(const char* token) {
+    skipSpace();
+    size_t length = std::strlen(token);
+    if(source_.compare(position_, length, token) != 0) {
+      return false;
+    }
+    // keep < from eating the start of <=, and so on
+    if(length == 1 && position_ + 1 < source_.size() && source_[position_ + 1] == '='
+      && std::strchr("<>=!", token[0]) != nullptr) {
+      return false;
+    }
+    position_ += length;
+    return true;
+  }
+
+  void expect(const char* token) {
+    if(!accept(token))
+      fail(std::string("expected '") + token + "'");
+  }
+
+  void parseTernary() {
+    parseOr();
+    if(accept("?")) {
+      parseTernary();
+      expect(":");
+      parseTernary();
+      emit(kSelect, 3);
+    }
+  }
+
+  void parseOr() {
+    parseAnd();
+    while(error_.empty() && accept("||")) {
+      parseAnd();
+      emit(kOr, 2);
+    }
+  }
+
+  void parseAnd() {
+    parseEquality();
+    while(error_.empty() && accept("&&")) {
+      parseEquality();
+      emit(kAnd, 2);
+    }
+  }
+
+  void parseEquality() {
+    parseRelational();
+    while(error_.empty()) {
+      if(accept("==")) {
+        parseRelational();
+        emit(kEqual, 2);
+      } else if(accept("!=")) {
+        parseRelational();
+        emit(kNotEqual, 2);
+      } else {
+        break;
+      }
+    }
+  }
+
+  void parseRelational() {
+    parseAdditive();
+    while(error_.empty()) {
+      Op op;
+      if(accept("<="))
+        op = kLessEqual;
+      else if(accept(">="))
+        op = kGreaterEqual;
+      else if(accept("<"))
+        op = kLess;
+      else if(accept(">"))
+        op = kGreater;
+      else
+        break;
+      parseAdditive();
+      emit(op, 2);
+    }
+  }
+
+  void parseAdditive() {
+    parseMultiplicative();
+    while(error_.empty()) {
+      if(accept("+")) {
+        parseMultiplicative();
+        emit(kAdd, 2);
+      } else if(accept("-")) {
+        parseMultiplicative();
+        emit(kSubtract, 2);
+      } else {
+        break;
+      }
+    }
+  }
+
+  void parseMultiplicative() {
+    parseUnary();
+    while(error_.empty()) {
+      if(accept("*")) {
+        parseUnary();
+        emit(kMultiply, 2);
+      } else if(accept("/")) {
+        parseUnary();
+        emit(kDivide, 2);
+      } else {
+        break;
+      }
+    }
+  }
+
+  void parseUnary() {
+    if(accept("-")) {
+      parseUnary();
+      emit(kNegate, 1);
+    } else if(accept("!")) {
+      parseUnary();
+      emit(kNot, 1);
+    } else {
+      parsePrimary();
+    }
+  }
+
+  void parsePrimary() {
+    skipSpace();
+    if(position_ >= source_.size()) {
+      fail("unexpected end");
+      return;
+    }
+
+    // parentheses
+    if(accept("(")) {
+      parseTernary();
+      expect(")");
+      return;
+    }
+
+    // number
+    char c = source_[position_];
+    if(std::isdigit((unsigned char)c) || c == '.') {
+      const char* start = source_.c_str() + position_;
+      char* end = nullptr;
+      double value = std::strtod(start, &end);
+      position_ += end - start;
+      constants_->push_back(value);
+      emit(kPushConstant, 0, (int)constants_->size() - 1);
+      return;
+    }
+
+    // name
+    if(!std::isalpha((unsigned char)c) && c != '_') {
+      fail(std::string("unexpected '") + c + "'");
+      return;
+    }
+    size_t start = position_;
+    while(position_ < source_.size() && (std::isalnum((unsigned char)source_[position_]) || source_[position_] == '_'))
+      position_++;
+    std::string name = source_.substr(start, position_ - start);
+
+    // function
+    if(name == "min" || name == "max" || name == "abs") {
+      expect("(");
+      parseTernary();
+      if(name == "abs") {
+        expect(")");
+        emit(kAbs, 1);
+        return;
+      }
+      expect(",");
+      parseTernary();
+      expect(")");
+      emit(name == "min" ? kMin : kMax, 2);
+      return;
+    }
+
+    // variable
+    for(int i = 0; i < kScoringVariableCount; i++) {
+      if(name == kScoringVariableNames[i]) {
+        emit(kLoadVariable, 0, i);
+        return;
+      }
+    }
+    position_ = start;
+    fail("unknown name '" + name + "'");
+  }
+};
+
+ScoringExpression::ScoringExpression() : max_depth_(0) {
+  std::string error;
+  compile("0", &error);
+}
+
+bool ScoringExpression::compile(const std::string & source, std::string * error) {
+  assert(error != nullptr);
+  std::vector<Instruction> code;
+  std::vector<double> constants;
+  Compiler compiler(source, &code, &constants);
+  if(!compiler.run()) {
+    *error = compiler.getError();
+    return false;
+  }
+  source_ = source;
+  code_.swap(code);
+  constants_.swap(constants);
+  max_depth_ = compiler.getMaxDepth();
+  return true;
+}
+
+const std::string & ScoringExpression::getSource() const {
+  return source_;
+}
+
+bool ScoringExpression::usesVariable(const ScoringVariable variable) const {
+  for(const Instruction& instruction : code_) {
+    if(instruction.op == kLoadVariable && instruction.argument == variable)
+      return true;
+  }
+  return false;
+}
+
+/// Runs each instruction over a whole chunk of moves before the next, so
+/// the dispatch is paid once per chunk and the inner loops vectorize.
+void ScoringExpression::evaluate(const ScoringBatch & batch, double * out) const {
+  const size_t count = batch.size();
+  std::vector<double> stack((size_t)max_depth_ * SCORING_CHUNK);
+  for(size_t first = 0; first < count; first += SCORING_CHUNK) {
+    const size_t n = std::min<size_t>(SCORING_CHUNK, count - first);
+    int top = 0; // number of values on the stack
+    for(const Instruction& instruction : code_) {
+      double* a = stack.data() + (size_t)(top - 1) * SCORING_CHUNK;
+      double* b = a + SCORING_CHUNK;
+      switch(instruction.op) {
+      case kPushConstant: {
+        double* to = stack.data() + (size_t)top++ * SCORING_CHUNK;
+        std::fill(to, to + n, constants_[instruction.argument]);
+        break;
+      }
+      case kLoadVariable: {
+        double* to = stack.data() + (size_t)top++ * SCORING_CHUNK;
+        const double* from = batch.column((ScoringVariable)instruction.argument) + first;
+        std::copy(from, from + n, to);
+        break;
+      }
+      case kNegate:
+        for(size_t i = 0; i < n; i++) a[i] = -a[i];
+        break;
+      case kNot:
+        for(size_t i = 0; i < n; i++) a[i] = a[i] == 0.0 ? 1.0 : 0.0;
+        break;
+      case kAbs:
+        for(size_t i = 0; i < n; i++) a[i] = std::fabs(a[i]);
+        break;
+      case kSelect: {
+        // condition, then value, else value
+        double* condition = stack.data() + (size_t)(top - 3) * SCORING_CHUNK;
+        double* then_value = condition + SCORING_CHUNK;
+        double* else_value = then_value + SCORING_CHUNK;
+        for(size_t i = 0; i < n; i++) condition[i] = condition[i] != 0.0 ? then_value[i] : else_value[i];
+        top -= 2;
+        break;
+      }
+      default:
+        // binary: a is the left side, and gets the result
+        a -= SCORING_CHUNK;
+        b -= SCORING_CHUNK;
+        switch(instruction.op) {
+        case kAdd: for(size_t i = 0; i < n; i++) a[i] = a[i] + b[i]; break;
+        case kSubtract: for(size_t i = 0; i < n; i++) a[i] = a[i] - b[i]; break;
+        case kMultiply: for(size_t i = 0; i < n; i++) a[i] = a[i] * b[i]; break;
+        case kDivide: for(size_t i = 0; i < n; i++) a[i] = b[i] != 0.0 ? a[i] / b[i] : 0.0; break;
+        case kLess: for(size_t i = 0; i < n; i++) a[i] = a[i] < b[i] ? 1.0 : 0.0; break;
+        case kLessEqual: for(size_t i = 0; i < n; i++) a[i] = a[i] <= b[i] ? 1.0 : 0.0; break;
+        case kGreater: for(size_t i = 0; i < n; i++) a[i] = a[i] > b[i] ? 1.0 : 0.0; break;
+        case kGreaterEqual: for(size_t i = 0; i < n; i++) a[i] = a[i] >= b[i] ? 1.0 : 0.0; break;
+        case kEqual: for(size_t i = 0; i < n; i++) a[i] = a[i] == b[i] ? 1.0 : 0.0; break;
+        case kNotEqual: for(size_t i = 0; i < n; i++) a[i] = a[i] != b[i] ? 1.0 : 0.0; break;
+        case kAnd: for(size_t i = 0; i < n; i++) a[i] = a[i] != 0.0 && b[i] != 0.0 ? 1.0 : 0.0; break;
+        case kOr: for(size_t i = 0; i < n; i++) a[i] = a[i] != 0.0 || b[i] != 0.0 ? 1.0 : 0.0; break;
+        case kMin: for(size_t i = 0; i < n; i++) a[i] = std::min(a[i], b[i]); break;
+        case kMax: for(size_t i = 0; i < n; i++) a[i] = std::max(a[i], b[i]); break;
+        default: assert(false); break;
+        }
+        top--;
+        break;
+      }
+    }
+    assert(top == 1);
+    std::copy(stack.data(), stack.data() + n, out + first);
+  }
+}
+
+double ScoringExpression::evaluate(const double variables[kScoringVariableCount]) const {
+  ScoringBatch batch;
+  batch.resize(1);
+  for(int i = 0; i < kScoringVariableCount; i++) {
+    *batch.column((ScoringVariable)i) = variables[i];
+  }
+  double result = 0.0;
+  evaluate(batch, &result);
+  return result;
+}
+
+} // namespace pokeman
@@ -0,0 +1,132 @@
+/*
+* scoring_expression.hpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*
+* Small expression language for rating moves, compiled to bytecode so
+* that formulas can be tuned from config without rebuilding.
+*/
+#ifndef POKEMAN_SCORING_EXPRESSION_HPP_
+#define POKEMAN_SCORING_EXPRESSION_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <vector>
+
+/// Moves evaluated together, one instruction at a time.
+#define SCORING_CHUNK 64
+
+namespace pokeman {
+
+/// Values an expression can refer to, for one move used by one monster.
+enum ScoringVariable {
+  kScoringPower,
+  kScoringAccuracy,
+  kScoringPp,
+  kScoringPhysical,
+  kScoringSpecial,
+  kScoringStatus,
+  kScoringStab,
+  kScoringSuited,
+  kScoringDamage,
+  kScoringHp,
+  kScoringAttack,
+  kScoringDefense,
+  kScoringSpecialAttack,
+  kScoringSpecialDefense,
+  kScoringSpeed,
+  kScoringLevel,
+  kScoringVariableCount
+};
+
+/// Name of a variable, as written in expressions.
+const char* getScoringVariableName(const ScoringVariable variable);
+
+/// Variables of a batch of moves, one column per variable.
+class ScoringBatch {
+private:
+  std::vector<double> columns_[kScoringVariableCount];
+  size_t size_;
+
+public:
+  ScoringBatch();
+
+  /// Makes room for count moves, zeroing every column.
+  void resize(const size_t count);
+
+  size_t size() const;
+
+  double* column(const ScoringVariable variable);
+
+  const double* column(const ScoringVariable variable) const;
+};
+
+class ScoringExpression {
+private:
+  enum Op : uint8_t {
+    kPushConstant,
+    kLoadVariable,
+    kNegate,
+    kNot,
+    kAbs,
+    kAdd,
+    kSubtract,
+    kMultiply,
+    kDivide,
+    kLess,
+    kLessEqual,
+    kGreater,
+    kGreaterEqual,
+    kEqual,
+    kNotEqual,
+    kAnd,
+    kOr,
+    kMin,
+    kMax,
+    kSelect
+  };
+
+  struct Instruction {
+    Op op;
+    int argument;
+  };
+
+  std::string source_;
+  std::vector<Instruction> code_;
+  std::vector<double> constants_;
+  int max_depth_;
+
+public:
+  /// Compiles to a constant 0.
+  ScoringExpression();
+
+  /// Compiles source. On failure, sets error, keeps the old program and
+  /// returns false.
+  ///
+  /// Expressions use numbers, variables, parentheses, - ! * / + -
+  /// < <= > >= == != && || and ?:, with C precedence, plus min(a, b),
+  /// max(a, b) and abs(a). Truth is nonzero; comparisons give 1 or 0.
+  /// Dividing by zero gives 0. Both sides of ?: && and || are evaluated.
+  bool compile(const std::string& source, std::string* error);
+
+  const std::string& getSource() const;
+
+  /// True if the program reads the variable, so callers can skip filling it.
+  bool usesVariable(const ScoringVariable variable) const;
+
+  /// Sets out[i] to the value for move i of the batch.
+  void evaluate(const ScoringBatch& batch, double* out) const;
+
+  /// Value for a single move.
+  double evaluate(const double variables[kScoringVariableCount]) const;
+
+private:
+  class Compiler;
+};
+
+} // namespace pokeman
+
+#endif //POKEMAN_SCORING_EXPRESSION_HPP_
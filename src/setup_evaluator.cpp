@@ -0,0 +1,263 @@
+/*
+* setup_evaluator.cpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*/
+#include "setup_evaluator.hpp"
+
+#include <cassert>
+
+#include <algorithm>
+
+#define SETUP_ATTACK 0
+#define SETUP_SPECIAL_ATTACK 1
+#define SETUP_FOE_DEFENSE 2
+#define SETUP_FOE_SPECIAL_DEFENSE 3
+
+namespace pokeman {
+
+SetupDamageTable::SetupDamageTable(const DamageCalculator * damage_calculator,
+  const std::vector<const MonsterSpecies*>& roster) : damage_calculator_(damage_calculator), roster_(roster),
+  fixed_targets_(false) {}
+
+SetupDamageTable::SetupDamageTable(const DamageCalculator * damage_calculator, const std::vector<Combatant>& targets) :
+  damage_calculator_(damage_calculator), fixed_targets_(true) {
+  targets_[0].combatants = targets;
+}
+
+const DamageCalculator * SetupDamageTable::getDamageCalculator() const {
+  return damage_calculator_;
+}
+
+/// Worked out without the lock, so threads only wait on each other for
+/// the lookups. Two threads may both work out the same entry; they agree.
+double SetupDamageTable::getDamage(const Combatant & attacker, const MoveId move_id, const int attack_stage,
+  const int defense_stage) {
+  assert(damage_calculator_ != nullptr);
+  const Move& move = damage_calculator_->move_library_->get(move_id);
+  const bool physical = move.move_type_ == kPhysical;
+  Combatant staged = attacker;
+  int* attacking_stat = physical ? &staged.stats.attack_ : &staged.stats.special_attack_;
+  *attacking_stat = SetupEvaluator::stagedStat(*attacking_stat, attack_stage);
+  const bool stab = move.elemental_type_ == attacker.type.first_type_
+    || (attacker.type.b_dual_type_ && move.elemental_type_ == attacker.type.second_type_);
+  const uint64_t key = getKey(attacker.level, move_id, *attacking_stat, stab, defense_stage);
+
+  const Targets* targets;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = damage_.find(key);
+    if(found != damage_.end())
+      return found->second;
+    targets = &getTargets(attacker.level);
+  }
+
+  // a move without a type hits everything neutrally
+  const bool typed = move.elemental_type_ >= 0 && move.elemental_type_ < kNullType;
+  const std::vector<Combatant>& combatants = targets->combatants;
+  double total = 0.0;
+  for(size_t j = 0; j < combatants.size(); j++) {
+    Combatant defender = combatants[j];
+    int* defending_stat = physical ? &defender.stats.defense_ : &defender.stats.special_defense_;
+    *defending_stat = SetupEvaluator::stagedStat(*defending_stat, defense_stage);
+    TypeEffectiveness effectiveness = typed ? targets->defending[j * kNullType + move.elemental_type_] : kOneTimes;
+    total += damage_calculator_->calculate(staged, move_id, defender, effectiveness).expectedFraction();
+  }
+  double damage = combatants.empty() ? 0.0 : total / combatants.size();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  damage_[key] = damage;
+  return damage;
+}
+
+/// Targets are kept once made, so the reference stays good without the
+/// mutex.
+const SetupDamageTable::Targets& SetupDamageTable::getTargets(const int level) {
+  Targets& targets = targets_[fixed_targets_ ? 0 : level];
+  if(!fixed_targets_ && targets.combatants.empty()) {
+    targets.combatants.reserve(roster_.size());
+    for(const MonsterSpecies* species : roster_) {
+      targets.combatants.push_back(Combatant(*species, level));
+    }
+  }
+  if(targets.defending.size() != targets.combatants.size() * kNullType) {
+    targets.defending.resize(targets.combatants.size() * kNullType);
+    for(size_t j = 0; j < targets.combatants.size(); j++) {
+      for(int type = 0; type < kNullType; type++) {
+        targets.defending[j * kNullType + type] =
+          damage_calculator_->chart_->getTypeEffectivenessXonY(TypesHad((Type)type), targets.combatants[j].type);
+      }
+    }
+  }
+  return targets;
+}
+
+uint64_t SetupDamageTable::getKey(const int level, const MoveId move_id, const int attacking_stat, const bool stab,
+  const int defense_stage) {
+  assert(level >= 0 && level < (1 << 12));
+  assert(move_id >= 0 && move_id < (1 << 24));
+  assert(attacking_stat >= 0 && attacking_stat < (1 << 23));
+  return (uint64_t)level << 52 | (uint64_t)move_id << 28 | (uint64_t)attacking_stat << 5 | (uint64_t)stab << 4
+    | (uint64_t)(defense_stage + SETUP_MAX_STAGE);
+}
+
+SetupEvaluator::SetupEvaluator() : damage_calculator_(nullptr), turns_(SETUP_DEFAULT_TURNS), damage_table_(nullptr),
+  generation_(0), move_count_(0) {}
+
+void SetupEvaluator::prepare(const Combatant & attacker, const std::vector<Combatant>& targets, const int turns) {
+  own_damage_table_.reset(new SetupDamageTable(damage_calculator_, targets));
+  prepare(attacker, own_damage_table_.get(), turns);
+}
+
+void SetupEvaluator::prepare(const Combatant & attacker, SetupDamageTable * damage_table, const int turns) {
+  assert(damage_table != nullptr);
+  assert(turns > 0 && turns <= SETUP_MAX_TURNS);
+  if(damage_table != own_damage_table_.get()) {
+    own_damage_table_.reset();
+  }
+  damage_table_ = damage_table;
+  damage_calculator_ = damage_table->getDamageCalculator();
+  attacker_.reset(new Combatant(attacker));
+  turns_ = turns;
+  tables_.clear();
+
+  // the memo keeps its size, so only grows the first time
+  size_t entries = (size_t)turns_ * SETUP_STATE_COUNT;
+  if(values_.size() < entries) {
+    values_.resize(entries);
+    choices_.resize(entries);
+    stamps_.assign(entries, 0);
+    generation_ = 0;
+  }
+}
+
+double SetupEvaluator::evaluate(const MoveId * moves, const int count, std::vector<MoveId>* sequence) {
+  assert(attacker_ != nullptr);
+  assert(count <= MOVESET_SIZE);
+  move_count_ = count;
+  for(int i = 0; i < count; i++) {
+    moves_[i] = &getTable(moves[i]);
+    move_ids_[i] = moves[i];
+  }
+
+  // a new stamp forgets the last moveset
+  if(++generation_ == 0) {
+    std::fill(stamps_.begin(), stamps_.end(), 0);
+    generation_ = 1;
+  }
+  int stages[SETUP_TRACKED_STAGES] = {0, 0, 0, 0};
+  double value = best(0, stages);
+
+  // follow the choices from the start
+  if(sequence != nullptr) {
+    sequence->clear();
+    for(int turn = 0; turn < turns_; turn++) {
+      int choice = choices_[(size_t)turn * SETUP_STATE_COUNT + encode(stages)];
+      if(choice < 0)
+        break;
+      sequence->push_back(move_ids_[choice]);
+      for(int i = 0; i < SETUP_TRACKED_STAGES; i++) {
+        stages[i] = std::max(-SETUP_MAX_STAGE, std::min(stages[i] + moves_[choice]->stage_changes[i], SETUP_MAX_STAGE));
+      }
+      best(turn + 1, stages); // memo entry for the next turn
+    }
+  }
+  return value;
+}
+
+int SetupEvaluator::stagedStat(const int stat, const int stage) {
+  return stage >= 0 ? stat * (2 + stage) / 2 : stat * 2 / (2 - stage);
+}
+
+SetupEvaluator::MoveTable& SetupEvaluator::getTable(const MoveId move_id) {
+  assert(damage_calculator_ != nullptr);
+  assert(move_id >= 0);
+  if(tables_.size() <= (size_t)move_id) {
+    tables_.resize(move_id + 1);
+  }
+  std::unique_ptr<MoveTable>& table = tables_[move_id];
+  if(table != nullptr) {
+    return *table;
+  }
+
+  table.reset(new MoveTable());
+  const Move& move = damage_calculator_->move_library_->get(move_id);
+  MoveFlags flags = damage_calculator_->move_library_->getFlags(move_id);
+  table->damaging = (flags & kMoveDamaging) != 0;
+  table->physical = move.move_type_ == kPhysical;
+  table->accuracy = move.accuracy_ < 0 ? 1.0 : (double)move.accuracy_ / 100;
+  bool hits_foe = (flags & kMoveTargetsFoe) != 0;
+  table->stage_changes[SETUP_ATTACK] = (int8_t)move.stat_modifiers_self_.attack_;
+  table->stage_changes[SETUP_SPECIAL_ATTACK] = (int8_t)move.stat_modifiers_self_.special_attack_;
+  table->stage_changes[SETUP_FOE_DEFENSE] = (int8_t)(hits_foe ? move.stat_modifiers_target_.defense_ : 0);
+  table->stage_changes[SETUP_FOE_SPECIAL_DEFENSE] = (int8_t)(hits_foe ? move.stat_modifiers_target_.special_defense_ : 0);
+  std::fill(&table->damage[0][0], &table->damage[0][0] + SETUP_STAGE_COUNT * SETUP_STAGE_COUNT, -1.0);
+  return *table;
+}
+
+/// A physical move's damage only depends on attack and defense stages, and
+/// a special move's on the special ones, so one square covers either.
+double SetupEvaluator::getDamage(const int move, const int attack_stage, const int defense_stage) {
+  double& damage = moves_[move]->damage[attack_stage + SETUP_MAX_STAGE][defense_stage + SETUP_MAX_STAGE];
+  if(damage < 0.0) {
+    damage = damage_table_->getDamage(*attacker_, move_ids_[move], attack_stage, defense_stage);
+  }
+  return damage;
+}
+
+/// Each turn, either the move lands, with its damage and stat changes, or
+/// it misses and nothing changes. Damage already counts accuracy.
+double SetupEvaluator::best(const int turn, const int stages[SETUP_TRACKED_STAGES]) {
+  if(turn == turns_) {
+    return 0.0;
+  }
+  size_t index = (size_t)turn * SETUP_STATE_COUNT + encode(stages);
+  if(stamps_[index] == generation_) {
+    return values_[index];
+  }
+
+  double best_value = 0.0;
+  int best_choice = -1;
+  double stay = -1.0; // value of the next turn with nothing changed
+  for(int i = 0; i < move_count_; i++) {
+    const MoveTable& table = *moves_[i];
+    double value = 0.0;
+    if(table.damaging) {
+      int attack = table.physical ? stages[SETUP_ATTACK] : stages[SETUP_SPECIAL_ATTACK];
+      int defense = table.physical ? stages[SETUP_FOE_DEFENSE] : stages[SETUP_FOE_SPECIAL_DEFENSE];
+      value += getDamage(i, attack, defense);
+    }
+
+    int next[SETUP_TRACKED_STAGES];
+    bool changed = false;
+    for(int s = 0; s < SETUP_TRACKED_STAGES; s++) {
+      next[s] = std::max(-SETUP_MAX_STAGE, std::min(stages[s] + table.stage_changes[s], SETUP_MAX_STAGE));
+      changed = changed || next[s] != stages[s];
+    }
+    if(stay < 0.0) {
+      stay = best(turn + 1, stages);
+    }
+    value += changed ? table.accuracy * best(turn + 1, next) + (1 - table.accuracy) * stay : stay;
+
+    if(value > best_value) {
+      best_value = value;
+      best_choice = i;
+    }
+  }
+
+  stamps_[index] = generation_;
+  values_[index] = best_value;
+  choices_[index] = (int8_t)best_choice;
+  return best_value;
+}
+
+int SetupEvaluator::encode(const int stages[SETUP_TRACKED_STAGES]) {
+  int code = 0;
+  for(int i = 0; i < SETUP_TRACKED_STAGES; i++) {
+    code = code * SETUP_STAGE_COUNT + stages[i] + SETUP_MAX_STAGE;
+  }
+  return code;
+}
+
+} // namespace pokeman
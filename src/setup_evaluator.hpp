@@ -0,0 +1,166 @@
+/*
+* setup_evaluator.hpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*
+* Works out the best way to use a moveset over a few turns, when stat
+* changes like Swords Dance can make later attacks hit harder.
+*/
+#ifndef POKEMAN_SETUP_EVALUATOR_HPP_
+#define POKEMAN_SETUP_EVALUATOR_HPP_
+
+#include <cstdint>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "damage_calculator.hpp"
+#include "moveset_optimizer.hpp"
+#include "pokeman.hpp"
+
+/// Turns looked ahead, unless asked otherwise.
+#define SETUP_DEFAULT_TURNS 4
+#define SETUP_MAX_TURNS 8
+
+#define SETUP_MAX_STAGE 6
+#define SETUP_STAGE_COUNT (2 * SETUP_MAX_STAGE + 1)
+
+/// Stages tracked: own attack, own special attack, foe defense and foe
+/// special defense.
+#define SETUP_TRACKED_STAGES 4
+#define SETUP_STATE_COUNT (SETUP_STAGE_COUNT * SETUP_STAGE_COUNT * SETUP_STAGE_COUNT * SETUP_STAGE_COUNT)
+
+namespace pokeman {
+
+/// Damage of moves at stages, shared by every evaluator against the same
+/// targets. It only depends on the level, the move, the attacking stat
+/// with its stage, STAB and the defending stage, so each is worked out
+/// once for all species and movesets that need it. Thread safe.
+class SetupDamageTable {
+private:
+  struct Targets {
+    std::vector<Combatant> combatants;
+
+    /// Effectiveness of each type on each target, a row per target.
+    std::vector<TypeEffectiveness> defending;
+  };
+
+  const DamageCalculator* damage_calculator_;
+  std::vector<const MonsterSpecies*> roster_;
+
+  /// True, if the targets were given instead of taken from the roster at
+  /// the attacker's level.
+  bool fixed_targets_;
+
+  std::mutex mutex_;
+
+  /// Targets by level.
+  std::map<int, Targets> targets_;
+
+  /// Share of the targets' hp taken off, averaged over them. (see getKey)
+  std::unordered_map<uint64_t, double> damage_;
+
+public:
+  /// Against the roster, at the level of whoever attacks.
+  SetupDamageTable(const DamageCalculator* damage_calculator, const std::vector<const MonsterSpecies*>& roster);
+
+  /// Against these targets only.
+  SetupDamageTable(const DamageCalculator* damage_calculator, const std::vector<Combatant>& targets);
+
+  SetupDamageTable(const SetupDamageTable&) = delete;
+
+  SetupDamageTable& operator=(const SetupDamageTable&) = delete;
+
+  const DamageCalculator* getDamageCalculator() const;
+
+  /// Share of the targets' hp the attacker's move takes off, averaged over
+  /// the targets, with the attacking stat at one stage and the defending
+  /// stat at another.
+  double getDamage(const Combatant& attacker, const MoveId move_id, const int attack_stage, const int defense_stage);
+
+private:
+  /// Targets of an attacker at the level. The mutex must be held.
+  const Targets& getTargets(const int level);
+
+  static uint64_t getKey(const int level, const MoveId move_id, const int attacking_stat, const bool stab,
+    const int defense_stage);
+};
+
+/// Not thread safe; use one per thread.
+class SetupEvaluator {
+public:
+  const DamageCalculator* damage_calculator_;
+
+private:
+  /// A move's damage at pairs of attacking and defending stages, each
+  /// filled in from the damage table the first time a moveset reaches it.
+  struct MoveTable {
+    bool damaging;
+    bool physical;
+    double accuracy;
+    int8_t stage_changes[SETUP_TRACKED_STAGES];
+
+    /// share of the targets' hp taken off, averaged over the targets;
+    /// negative until filled in
+    double damage[SETUP_STAGE_COUNT][SETUP_STAGE_COUNT];
+  };
+
+  std::unique_ptr<Combatant> attacker_;
+  int turns_;
+
+  /// Table in use, and the one made for targets given to prepare.
+  SetupDamageTable* damage_table_;
+  std::unique_ptr<SetupDamageTable> own_damage_table_;
+
+  /// Indexed by move id.
+  std::vector<std::unique_ptr<MoveTable>> tables_;
+
+  /// Memo of the current moveset, per turn and state. Entries are only good
+  /// if their stamp matches generation_, so a new moveset clears them all
+  /// by bumping it.
+  std::vector<double> values_;
+  std::vector<int8_t> choices_;
+  std::vector<uint32_t> stamps_;
+  uint32_t generation_;
+
+  /// Moveset being evaluated.
+  MoveTable* moves_[MOVESET_SIZE];
+  MoveId move_ids_[MOVESET_SIZE];
+  int move_count_;
+
+public:
+  SetupEvaluator();
+
+  /// Sets who attacks whom over how many turns, dropping the tables.
+  void prepare(const Combatant& attacker, const std::vector<Combatant>& targets, const int turns = SETUP_DEFAULT_TURNS);
+
+  /// Same, with the targets and damage of a table shared with other
+  /// evaluators. The table must outlive the evaluator's use of it.
+  void prepare(const Combatant& attacker, SetupDamageTable* damage_table, const int turns = SETUP_DEFAULT_TURNS);
+
+  /// Most expected damage the moves can do over the turns, in targets' hp.
+  /// If sequence is given, sets it to the moves to use, turn by turn,
+  /// assuming every stat change lands.
+  double evaluate(const MoveId* moves, const int count, std::vector<MoveId>* sequence = nullptr);
+
+  /// Stat with its stage applied.
+  static int stagedStat(const int stat, const int stage);
+
+private:
+  MoveTable& getTable(const MoveId move_id);
+
+  /// Damage of the moveset's move at stages, from the damage table if need be.
+  double getDamage(const int move, const int attack_stage, const int defense_stage);
+
+  double best(const int turn, const int stages[SETUP_TRACKED_STAGES]);
+
+  static int encode(const int stages[SETUP_TRACKED_STAGES]);
+};
+
+} // namespace pokeman
+
+#endif //POKEMAN_SETUP_EVALUATOR_HPP_
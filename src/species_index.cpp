@@ -0,0 +1,346 @@
+/*
+* species_index.cpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*/
+#include "species_index.hpp"
+
+#include <cassert>
+#include <cstring>
+
+#include <filesystem>
+#include <iterator>
+
+#include <yaml-cpp/eventhandler.h>
+#include <yaml-cpp/yaml.h>
+
+#include "pokeman_loader.hpp"
+
+namespace pokeman {
+namespace resources {
+
+/// Notes where each item of the top level sequence starts, with its name
+/// and number, without building any nodes.
+class SpeciesScanHandler : public YAML::EventHandler {
+public:
+  /// Where each item's map starts.
+  std::vector<uint64_t> starts_;
+  std::vector<std::string> names_;
+  std::vector<std::string> numbers_;
+
+  /// Why the file can't be indexed, if it can't.
+  std::string failure_;
+
+private:
+  int depth_;
+  bool expect_key_;
+  std::string key_;
+
+public:
+  SpeciesScanHandler() : depth_(0), expect_key_(true) {}
+
+  void OnDocumentStart(const YAML::Mark& mark) override {}
+
+  void OnDocumentEnd() override {}
+
+  void OnNull(const YAML::Mark& mark, YAML::anchor_t anchor) override {
+    OnScalar(mark, "", anchor, "");
+  }
+
+  void OnAlias(const YAML::Mark& mark, YAML::anchor_t anchor) override {
+    fail("it uses aliases");
+  }
+
+  void OnScalar(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor,
+    const std::string& value) override {
+    start(mark, anchor, false);
+    if(depth_ != 2) {
+      return;
+    }
+    if(expect_key_) {
+      key_ = value;
+    } else if(key_ == "name") {
+      names_.back() = value;
+    } else if(key_ == "number") {
+      numbers_.back() = value;
+    }
+    expect_key_ = !expect_key_;
+  }
+
+  void OnSequenceStart(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor,
+    YAML::EmitterStyle::value style) override {
+    if(depth_ == 0 && style == YAML::EmitterStyle::Flow) {
+      fail("its sequence isn't in block style");
+    }
+    if(depth_ > 0) {
+      start(mark, anchor, false);
+    } else if(anchor != YAML::NullAnchor) {
+      fail("it uses anchors");
+    }
+    if(depth_ == 2) {
+      expect_key_ = true; // a value that is a sequence
+    }
+    depth_++;
+  }
+
+  void OnSequenceEnd() override {
+    depth_--;
+  }
+
+  void OnMapStart(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor,
+    YAML::EmitterStyle::value style) override {
+    start(mark, anchor, true);
+    if(depth_ == 1 || depth_ == 2) {
+      expect_key_ = true; // an item's first key, or after a value that is a map
+    }
+    depth_++;
+  }
+
+  void OnMapEnd() override {
+    depth_--;
+  }
+
+private:
+  /// Checks a node as it starts, noting it if it is an item.
+  void start(const YAML::Mark& mark, const YAML::anchor_t anchor, const bool map) {
+    if(anchor != YAML::NullAnchor) {
+      fail("it uses anchors");
+    } else if(depth_ == 0) {
+      fail("its top level isn't a sequence");
+    } else if(depth_ == 1 && !map) {
+      fail("an item isn't a map");
+    } else if(depth_ == 1) {
+      starts_.push_back((uint64_t)mark.pos);
+      names_.emplace_back();
+      numbers_.emplace_back();
+    }
+  }
+
+  void fail(const std::string& message) {
+    if(failure_.empty())
+      failure_ = message;
+  }
+};
+
+SpeciesIndex::SpeciesIndex() : file_size_(0), file_time_(0), read_count_(0), log_(&std::cerr) {}
+
+bool SpeciesIndex::open(const std::string & filepath, std::string * error) {
+  assert(error != nullptr);
+  filepath_ = filepath;
+  entries_.clear();
+  by_number_.clear();
+  read_count_ = 0;
+
+  std::error_code code;
+  file_size_ = (uint64_t)std::filesystem::file_size(filepath, code);
+  if(!code) {
+    file_time_ = (int64_t)std::filesystem::last_write_time(filepath, code).time_since_epoch().count();
+  }
+  file_.close();
+  file_.open(filepath, std::ios::binary);
+  if(code || !file_) {
+    *error = "can't read " + filepath;
+    return false;
+  }
+
+  // a sidecar that can't be written only costs the next run a scan
+  const std::string index_path = filepath + SPECIES_INDEX_EXTENSION;
+  if(!load(index_path)) {
+    if(!build(error))
+      return false;
+    save(index_path);
+  }
+  for(size_t i = 0; i < entries_.size(); i++) {
+    by_number_[entries_[i].number] = i;
+  }
+  return true;
+}
+
+const std::vector<SpeciesIndexEntry>& SpeciesIndex::getEntries() const {
+  return entries_;
+}
+
+size_t SpeciesIndex::getReadCount() const {
+  return read_count_;
+}
+
+std::map<std::string, int> SpeciesIndex::list() const {
+  std::map<std::string, int> numbers;
+  for(const SpeciesIndexEntry& entry : entries_) {
+    numbers[entry.name] = entry.number;
+  }
+  return numbers;
+}
+
+/// The item is read as a sequence of one, the way it sits in the file.
+bool SpeciesIndex::read(const int number, StringArena * names, MonsterSpecies * species) {
+  auto found = by_number_.find(number);
+  if(found == by_number_.end()) {
+    return false;
+  }
+  const SpeciesIndexEntry& entry = entries_[found->second];
+  std::string text((size_t)entry.size, '\0');
+  file_.clear();
+  file_.seekg((std::streamoff)entry.offset);
+  file_.read(&text[0], (std::streamsize)text.size());
+  if(!file_) {
+    *log_ << "[Error] cannot load " << filepath_ << std::endl << "  "
+      << "species " << entry.name << " is past the end of the file" << std::endl;
+    return false;
+  }
+  read_count_++;
+
+  try {
+    YAML::Node items = YAML::Load(text);
+    if(!items.IsSequence() || items.size() != 1) {
+      *log_ << "[Error] parsing " << filepath_ << std::endl << "  "
+        << "species " << entry.name << " isn't where its index says" << std::endl;
+      return false;
+    }
+    SpeciesParser parser;
+    if(!parser.parseSpecies(items[0], names, species)) {
+      parser.getParserData().errorReport(*log_);
+      return false;
+    }
+  } catch (YAML::Exception& e) {
+    *log_ << "[Error] parsing " << filepath_ << std::endl << "  "
+      << "species " << entry.name << ": " << e.what() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+/// An item starts at the beginning of the line with its dash, and runs up
+/// to where the next one starts.
+bool SpeciesIndex::build(std::string * error) {
+  file_.clear();
+  file_.seekg(0);
+  std::string text((std::istreambuf_iterator<char>(file_)), std::istreambuf_iterator<char>());
+  if(text.size() != file_size_) {
+    *error = "it changed while being read";
+    return false;
+  }
+
+  SpeciesScanHandler handler;
+  std::ifstream input(filepath_, std::ios::binary);
+  try {
+    YAML::Parser parser(input);
+    parser.HandleNextDocument(handler);
+  } catch (YAML::Exception& e) {
+    *error = e.what();
+    return false;
+  }
+  if(!handler.failure_.empty()) {
+    *error = handler.failure_;
+    return false;
+  }
+
+  entries_.resize(handler.starts_.size());
+  for(size_t i = 0; i < entries_.size(); i++) {
+    SpeciesIndexEntry& entry = entries_[i];
+    entry.name = handler.names_[i];
+    try {
+      entry.number = std::stoi(handler.numbers_[i]);
+    } catch (std::exception&) {
+      *error = "species " + entry.name + " has no number";
+      return false;
+    }
+
+    // back to the dash, then to the start of its line
+    size_t position = (size_t)handler.starts_[i];
+    while(position > 0 && position <= text.size() && std::strchr(" \t\r\n", text[position - 1]) != nullptr) {
+      position--;
+    }
+    if(position == 0 || position > text.size() || text[position - 1] != '-') {
+      *error = "species " + entry.name + " isn't on its own lines";
+      return false;
+    }
+    position--;
+    while(position > 0 && text[position - 1] == ' ') {
+      position--;
+    }
+    if((position > 0 && text[position - 1] != '\n') || (i > 0 && position <= entries_[i - 1].offset)) {
+      *error = "species " + entry.name + " isn't on its own lines";
+      return false;
+    }
+    entry.offset = position;
+  }
+  for(size_t i = 0; i < entries_.size(); i++) {
+    uint64_t end = i + 1 < entries_.size() ? entries_[i + 1].offset : (uint64_t)text.size();
+    entries_[i].size = end - entries_[i].offset;
+  }
+  return true;
+}
+
+bool SpeciesIndex::load(const std::string & filepath) {
+  std::ifstream file(filepath, std::ios::binary);
+  if(!file) {
+    return false;
+  }
+
+  // header
+  char magic[4];
+  uint32_t format = 0;
+  uint64_t file_size = 0;
+  int64_t file_time = 0;
+  uint64_t count = 0;
+  file.read(magic, sizeof(magic));
+  file.read(reinterpret_cast<char*>(&format), sizeof(format));
+  file.read(reinterpret_cast<char*>(&file_size), sizeof(file_size));
+  file.read(reinterpret_cast<char*>(&file_time), sizeof(file_time));
+  file.read(reinterpret_cast<char*>(&count), sizeof(count));
+  if(!file || std::memcmp(magic, SPECIES_INDEX_MAGIC, sizeof(magic)) != 0 || format != SPECIES_INDEX_FORMAT
+    || file_size != file_size_ || file_time != file_time_ || count > file_size) {
+    return false;
+  }
+
+  // entries
+  std::vector<SpeciesIndexEntry> entries((size_t)count);
+  for(SpeciesIndexEntry& entry : entries) {
+    int32_t number = 0;
+    uint32_t name_size = 0;
+    file.read(reinterpret_cast<char*>(&number), sizeof(number));
+    file.read(reinterpret_cast<char*>(&name_size), sizeof(name_size));
+    file.read(reinterpret_cast<char*>(&entry.offset), sizeof(entry.offset));
+    file.read(reinterpret_cast<char*>(&entry.size), sizeof(entry.size));
+    if(!file || name_size > file_size || entry.offset > file_size || entry.size > file_size - entry.offset) {
+      return false;
+    }
+    entry.number = number;
+    entry.name.resize(name_size);
+    file.read(&entry.name[0], name_size);
+  }
+  if(!file) {
+    return false;
+  }
+  entries_ = std::move(entries);
+  return true;
+}
+
+bool SpeciesIndex::save(const std::string & filepath) const {
+  std::ofstream file(filepath, std::ios::binary | std::ios::trunc);
+  if(!file) {
+    return false;
+  }
+  uint32_t format = SPECIES_INDEX_FORMAT;
+  uint64_t count = entries_.size();
+  file.write(SPECIES_INDEX_MAGIC, 4);
+  file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+  file.write(reinterpret_cast<const char*>(&file_size_), sizeof(file_size_));
+  file.write(reinterpret_cast<const char*>(&file_time_), sizeof(file_time_));
+  file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  for(const SpeciesIndexEntry& entry : entries_) {
+    int32_t number = entry.number;
+    uint32_t name_size = (uint32_t)entry.name.size();
+    file.write(reinterpret_cast<const char*>(&number), sizeof(number));
+    file.write(reinterpret_cast<const char*>(&name_size), sizeof(name_size));
+    file.write(reinterpret_cast<const char*>(&entry.offset), sizeof(entry.offset));
+    file.write(reinterpret_cast<const char*>(&entry.size), sizeof(entry.size));
+    file.write(entry.name.data(), name_size);
+  }
+  return (bool)file;
+}
+
+} // namespace resources
+} // namespace pokeman
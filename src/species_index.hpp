@@ -0,0 +1,95 @@
+/*
+* species_index.hpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*
+* Index of where each species sits in the yaml species file, kept in a
+* sidecar next to it, so only the species asked for are ever parsed.
+*/
+#ifndef POKEMAN_SPECIES_INDEX_HPP_
+#define POKEMAN_SPECIES_INDEX_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "pokeman.hpp"
+
+#define SPECIES_INDEX_MAGIC "PMSI"
+
+/// Bump whenever the sidecar changes shape.
+#define SPECIES_INDEX_FORMAT 1
+
+/// Added to the species file's path for the sidecar's.
+#define SPECIES_INDEX_EXTENSION ".idx"
+
+namespace pokeman {
+namespace resources {
+
+/// Where a species is in the file.
+struct SpeciesIndexEntry {
+  int number;
+  std::string name;
+
+  /// Bytes of its item in the top level sequence, from its dash.
+  uint64_t offset;
+  uint64_t size;
+};
+
+/// Reads species out of a yaml file one at a time, by their byte ranges.
+/// The file's top level has to be a block sequence of maps, without
+/// anchors, so each item can be read on its own.
+class SpeciesIndex : public SpeciesSource {
+private:
+  std::string filepath_;
+  std::ifstream file_;
+  std::vector<SpeciesIndexEntry> entries_;
+
+  /// Maps dex number to entry.
+  std::map<int, size_t> by_number_;
+
+  /// Size and modification time of the file the entries are for.
+  uint64_t file_size_;
+  int64_t file_time_;
+  size_t read_count_;
+
+public:
+  /// Where parse errors are reported.
+  std::ostream* log_;
+
+  SpeciesIndex();
+
+  /// Takes the sidecar, if it matches the file's size and modification
+  /// time, and otherwise scans the file and writes a new one. False, if
+  /// the file can't be indexed; error says why.
+  bool open(const std::string& filepath, std::string* error);
+
+  const std::vector<SpeciesIndexEntry>& getEntries() const;
+
+  /// Number of species read so far.
+  size_t getReadCount() const;
+
+  std::map<std::string, int> list() const override;
+
+  bool read(const int number, StringArena* names, MonsterSpecies* species) override;
+
+private:
+  /// Finds every species' byte range in the file.
+  bool build(std::string* error);
+
+  /// False, if the sidecar is missing or out of date.
+  bool load(const std::string& filepath);
+
+  bool save(const std::string& filepath) const;
+};
+
+} // namespace resources
+} // namespace pokeman
+
+#endif //POKEMAN_SPECIES_INDEX_HPP_
@@ -0,0 +1,48 @@
+/*
+* string_arena.cpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*/
+#include "string_arena.hpp"
+
+#include <cstring>
+
+namespace pokeman {
+
+StringArena::StringArena() : block_used_(0), block_size_(0), bytes_(0) {}
+
+std::string_view StringArena::intern(const std::string_view string) {
+  if(string.empty()) {
+    return std::string_view();
+  }
+  std::unordered_set<std::string_view>::const_iterator it = interned_.find(string);
+  if(it != interned_.end()) {
+    return *it;
+  }
+
+  // room in the last block, or a new one
+  if(block_used_ + string.size() > block_size_) {
+    block_size_ = string.size() > STRING_ARENA_BLOCK_SIZE ? string.size() : STRING_ARENA_BLOCK_SIZE;
+    blocks_.emplace_back(new char[block_size_]);
+    block_used_ = 0;
+  }
+  char* copy = blocks_.back().get() + block_used_;
+  std::memcpy(copy, string.data(), string.size());
+  block_used_ += string.size();
+  bytes_ += string.size();
+
+  std::string_view interned(copy, string.size());
+  interned_.insert(interned);
+  return interned;
+}
+
+size_t StringArena::size() const {
+  return interned_.size();
+}
+
+size_t StringArena::bytes() const {
+  return bytes_;
+}
+
+} // namespace pokeman
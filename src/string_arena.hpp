@@ -0,0 +1,58 @@
+/*
+* string_arena.hpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*
+* Keeps one copy of each name in a few big blocks, instead of a heap
+* string for every place the name shows up.
+*/
+#ifndef POKEMAN_STRING_ARENA_HPP_
+#define POKEMAN_STRING_ARENA_HPP_
+
+#include <cstddef>
+
+#include <memory>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+/// Bytes in each block. Longer strings get a block of their own.
+#define STRING_ARENA_BLOCK_SIZE 4096
+
+namespace pokeman {
+
+/// Interned strings live until the arena does, and are all freed with it.
+/// Not copyable, since views point into it. Not thread safe.
+class StringArena {
+private:
+  std::vector<std::unique_ptr<char[]>> blocks_;
+
+  /// Bytes used of the last block.
+  size_t block_used_;
+  size_t block_size_;
+
+  /// Views of every interned string, into the blocks.
+  std::unordered_set<std::string_view> interned_;
+  size_t bytes_;
+
+public:
+  StringArena();
+
+  StringArena(const StringArena&) = delete;
+
+  StringArena& operator=(const StringArena&) = delete;
+
+  /// The arena's copy of a string, made the first time it is seen.
+  std::string_view intern(const std::string_view string);
+
+  /// Number of distinct strings.
+  size_t size() const;
+
+  /// Bytes of the distinct strings.
+  size_t bytes() const;
+};
+
+} // namespace pokeman
+
+#endif //POKEMAN_STRING_ARENA_HPP_
@@ -0,0 +1,206 @@
+/*
+* team_optimizer.cpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*/
+#include "team_optimizer.hpp"
+
+#include <cassert>
+
+#include <algorithm>
+
+#include "parallel.hpp"
+
+/// Smallest change in score worth taking.
+#define TEAM_SEARCH_EPSILON 1e-9
+
+namespace pokeman {
+
+TeamWeights::TeamWeights() {
+  threat = 2.0;
+  redundancy = 0.5;
+}
+
+TeamOptimizer::TeamOptimizer() : coverage_table_(nullptr), thread_count_(0), restarts_(TEAM_SEARCH_RESTARTS),
+  rounds_(TEAM_SEARCH_ROUNDS), budget_(TEAM_SEARCH_BUDGET_MS) {}
+
+TeamPlan TeamOptimizer::optimize(const std::vector<std::vector<Moveset>>& candidates, const std::vector<double>& threats,
+  const uint64_t seed) const {
+  assert(coverage_table_ != nullptr);
+  assert(restarts_ > 0);
+  Problem problem = prepare(candidates, threats);
+  const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + budget_;
+
+  // restarts are independent, and seeded by index
+  std::vector<State> results((size_t)restarts_);
+  parallel::forEachIndex(results.size(), [&](size_t restart) {
+    std::seed_seq seeds = {(uint32_t)seed, (uint32_t)(seed >> 32), (uint32_t)restart};
+    std::mt19937_64 rng(seeds);
+    results[restart] = search(problem, restart, &rng, deadline);
+  }, thread_count_);
+
+  // earliest restart wins ties
+  size_t best = 0;
+  for(size_t i = 1; i < results.size(); i++) {
+    if(results[i].score > results[best].score + TEAM_SEARCH_EPSILON)
+      best = i;
+  }
+  return {results[best].choices, results[best].score};
+}
+
+double TeamOptimizer::score(const std::vector<std::vector<Moveset>>& candidates, const std::vector<double>& threats,
+  const std::vector<int>& choices) const {
+  Problem problem = prepare(candidates, threats);
+  State state;
+  state.choices = choices;
+  evaluate(problem, &state);
+  return state.score;
+}
+
+uint32_t TeamOptimizer::getThreatHits(const Moveset & moveset) const {
+  assert(coverage_table_ != nullptr);
+  uint32_t hits = 0;
+  for(int i = 0; i < moveset.count; i++) {
+    MoveId id = moveset.moves[i];
+    if(!coverage_table_->hasEntry(id))
+      continue;
+    const TypingSet& super_effective = coverage_table_->getSuperEffective(id);
+    for(int t = 0; t < kNullType; t++) {
+      if(super_effective[getTypingIndex(TypesHad((Type)t))])
+        hits |= 1u << t;
+    }
+  }
+  return hits;
+}
+
+TeamOptimizer::Problem TeamOptimizer::prepare(const std::vector<std::vector<Moveset>>& candidates,
+  const std::vector<double>& threats) const {
+  assert(threats.size() == kNullType);
+  Problem problem;
+  problem.scores.resize(candidates.size());
+  problem.hits.resize(candidates.size());
+  for(size_t m = 0; m < candidates.size(); m++) {
+    for(const Moveset& moveset : candidates[m]) {
+      problem.scores[m].push_back(moveset.score);
+      problem.hits[m].push_back(getThreatHits(moveset));
+    }
+  }
+  std::copy(threats.begin(), threats.end(), problem.threats);
+  return problem;
+}
+
+double TeamOptimizer::coverageValue(const Problem & problem, const int type, const int count) const {
+  double value = count > 0 ? weights_.threat : 0.0;
+  value -= weights_.redundancy * std::max(count - TEAM_REDUNDANT_COVERAGE, 0);
+  return problem.threats[type] * value;
+}
+
+void TeamOptimizer::evaluate(const Problem & problem, State * state) const {
+  assert(state->choices.size() == problem.scores.size());
+  std::fill(state->counts, state->counts + kNullType, 0);
+  state->score = 0.0;
+  for(size_t m = 0; m < problem.scores.size(); m++) {
+    int choice = state->choices[m];
+    if(choice < 0)
+      continue;
+    state->score += problem.scores[m][choice];
+    for(int t = 0; t < kNullType; t++) {
+      state->counts[t] += (problem.hits[m][choice] >> t) & 1;
+    }
+  }
+  for(int t = 0; t < kNullType; t++) {
+    state->score += coverageValue(problem, t, state->counts[t]);
+  }
+}
+
+double TeamOptimizer::delta(const Problem & problem, const State & state, const size_t member, const int candidate) const {
+  const int current = state.choices[member];
+  double change = problem.scores[member][candidate] - problem.scores[member][current];
+  uint32_t old_hits = problem.hits[member][current];
+  uint32_t new_hits = problem.hits[member][candidate];
+
+  // only types one hits and the other doesn't move
+  for(uint32_t differ = old_hits ^ new_hits; differ != 0; differ &= differ - 1) {
+    int t = 0;
+    while(((differ >> t) & 1) == 0)
+      t++;
+    int count = state.counts[t] + ((new_hits >> t) & 1 ? 1 : -1);
+    change += coverageValue(problem, t, count) - coverageValue(problem, t, state.counts[t]);
+  }
+  return change;
+}
+
+void TeamOptimizer::change(const Problem & problem, State * state, const size_t member, const int candidate) const {
+  state->score += delta(problem, *state, member, candidate);
+  uint32_t old_hits = problem.hits[member][state->choices[member]];
+  uint32_t new_hits = problem.hits[member][candidate];
+  for(int t = 0; t < kNullType; t++) {
+    state->counts[t] += (int)((new_hits >> t) & 1) - (int)((old_hits >> t) & 1);
+  }
+  state->choices[member] = candidate;
+}
+
+void TeamOptimizer::climb(const Problem & problem, State * state) const {
+  while(true) {
+    double best_delta = TEAM_SEARCH_EPSILON;
+    size_t best_member = 0;
+    int best_candidate = -1;
+    for(size_t m = 0; m < problem.scores.size(); m++) {
+      if(state->choices[m] < 0)
+        continue;
+      for(int c = 0; c < (int)problem.scores[m].size(); c++) {
+        double d = delta(problem, *state, m, c);
+        if(d > best_delta) {
+          best_delta = d;
+          best_member = m;
+          best_candidate = c;
+        }
+      }
+    }
+    if(best_candidate < 0)
+      return;
+    change(problem, state, best_member, best_candidate);
+  }
+}
+
+/// The first restart starts from each member's own best set; the rest start
+/// at random. Perturbations that don't end up at least as good are undone.
+TeamOptimizer::State TeamOptimizer::search(const Problem & problem, const size_t restart, std::mt19937_64 * rng,
+  const std::chrono::steady_clock::time_point deadline) const {
+  const size_t member_count = problem.scores.size();
+  std::vector<size_t> members; // members with something to pick
+  State state;
+  state.choices.assign(member_count, -1);
+  for(size_t m = 0; m < member_count; m++) {
+    if(problem.scores[m].empty())
+      continue;
+    members.push_back(m);
+    state.choices[m] = restart == 0 ? 0 : (int)((*rng)() % problem.scores[m].size());
+  }
+  evaluate(problem, &state);
+  climb(problem, &state);
+  if(members.empty()) {
+    return state;
+  }
+
+  State best = state;
+  for(int round = 0; round < rounds_ && std::chrono::steady_clock::now() < deadline; round++) {
+    for(int i = 0; i < TEAM_SEARCH_NEIGHBORHOOD; i++) {
+      size_t m = members[(*rng)() % members.size()];
+      change(problem, &state, m, (int)((*rng)() % problem.scores[m].size()));
+    }
+    climb(problem, &state);
+    if(state.score >= best.score - TEAM_SEARCH_EPSILON) {
+      best = state;
+    } else {
+      state = best;
+    }
+  }
+
+  // keep drift in the running score out of the result
+  evaluate(problem, &best);
+  return best;
+}
+
+} // namespace pokeman
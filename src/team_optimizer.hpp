@@ -0,0 +1,124 @@
+/*
+* team_optimizer.hpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*
+* Picks movesets for a whole team at once, so that between them they hit
+* the types the team is weak to without all piling onto the same ones.
+*/
+#ifndef POKEMAN_TEAM_OPTIMIZER_HPP_
+#define POKEMAN_TEAM_OPTIMIZER_HPP_
+
+#include <cstdint>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "moveset_optimizer.hpp"
+#include "pokeman.hpp"
+
+/// Independent searches, each from its own starting team.
+#define TEAM_SEARCH_RESTARTS 8
+
+/// Perturb and climb rounds per search, if time allows.
+#define TEAM_SEARCH_ROUNDS 400
+
+/// Members given a random set in each perturbation.
+#define TEAM_SEARCH_NEIGHBORHOOD 2
+
+/// Wall clock time for the whole search, in milliseconds.
+#define TEAM_SEARCH_BUDGET_MS 3000
+
+/// Members hitting a threat beyond this many count as redundant.
+#define TEAM_REDUNDANT_COVERAGE 2
+
+namespace pokeman {
+
+/// How much the team-wide parts of a plan are worth, per unit of threat.
+struct TeamWeights {
+  /// for a threat hit super effectively by anyone
+  double threat;
+
+  /// per member hitting a threat beyond TEAM_REDUNDANT_COVERAGE, taken off
+  double redundancy;
+
+  /// Default weights.
+  TeamWeights();
+};
+
+/// One candidate set picked per member.
+struct TeamPlan {
+  /// Index into each member's candidates; -1 for members with none.
+  std::vector<int> choices;
+  double score;
+};
+
+class TeamOptimizer {
+public:
+  const MoveCoverageTable* coverage_table_;
+  TeamWeights weights_;
+
+  /// Worker threads; 0 uses every core.
+  unsigned int thread_count_;
+  int restarts_;
+  int rounds_;
+  std::chrono::milliseconds budget_;
+
+private:
+  /// Candidates boiled down to what the score needs.
+  struct Problem {
+    /// per member, per candidate
+    std::vector<std::vector<double>> scores;
+    std::vector<std::vector<uint32_t>> hits;
+    double threats[kNullType];
+  };
+
+  struct State {
+    std::vector<int> choices;
+    int counts[kNullType];
+    double score;
+  };
+
+public:
+  TeamOptimizer();
+
+  /// Picks one of each member's candidate sets, maximizing their own scores
+  /// plus coverage of threats, which holds what hitting each type is worth.
+  /// The same seed gives the same plan, as long as the budget isn't hit.
+  TeamPlan optimize(const std::vector<std::vector<Moveset>>& candidates, const std::vector<double>& threats,
+    const uint64_t seed) const;
+
+  /// Score of a plan.
+  double score(const std::vector<std::vector<Moveset>>& candidates, const std::vector<double>& threats,
+    const std::vector<int>& choices) const;
+
+  /// Types that a moveset hits super effectively, as bits.
+  uint32_t getThreatHits(const Moveset& moveset) const;
+
+private:
+  Problem prepare(const std::vector<std::vector<Moveset>>& candidates, const std::vector<double>& threats) const;
+
+  /// Worth of a threat hit by count members.
+  double coverageValue(const Problem& problem, const int type, const int count) const;
+
+  /// Sets choices, counts and score from scratch.
+  void evaluate(const Problem& problem, State* state) const;
+
+  /// Change in score from switching a member to a candidate.
+  double delta(const Problem& problem, const State& state, const size_t member, const int candidate) const;
+
+  void change(const Problem& problem, State* state, const size_t member, const int candidate) const;
+
+  /// Takes the best single member change until none helps.
+  void climb(const Problem& problem, State* state) const;
+
+  /// One restart: climb, then perturb and climb again, keeping the best.
+  State search(const Problem& problem, const size_t restart, std::mt19937_64* rng,
+    const std::chrono::steady_clock::time_point deadline) const;
+};
+
+} // namespace pokeman
+
+#endif //POKEMAN_TEAM_OPTIMIZER_HPP_
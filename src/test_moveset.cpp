@@ -0,0 +1,849 @@
+﻿/*
+* test_moveset.cpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*/
+#include "test_moveset.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "battle_simulator.hpp"
+#include "damage_calculator.hpp"
+#include "moveset_analysis.hpp"
+#include "moveset_optimizer.hpp"
+#include "moveset_table.hpp"
+#include "rating_cache.hpp"
+#include "resources.hpp"
+#include "scoring_expression.hpp"
+#include "setup_evaluator.hpp"
+#include "team_optimizer.hpp"
+
+namespace pokeman {
+namespace test {
+
+// optimizer tests
+int test_optimizer_matches_brute_force();
+int test_optimizer_keeps_locked_moves();
+int test_coverage_table();
+
+// damage tests
+int test_calculate_stats();
+int test_damage_rolls();
+int test_damage_matrix();
+
+// battle tests
+int test_battle_reproducible();
+int test_battle_mismatch();
+
+// rating cache tests
+int test_rating_cache();
+
+// moveset table tests
+int test_moveset_table();
+
+// scoring expression tests
+int test_scoring_expression();
+int test_scoring_batch();
+
+// format tests
+int test_format_multipliers();
+
+// niche tests
+int test_hm_niches();
+
+// team tests
+int test_team_optimizer();
+
+// setup tests
+int test_setup_evaluator();
+
+static const TestNode test_moveset_tests[] = {
+  {"optimizer vs brute force", "checks that pruning finds the same best sets as trying every set.", test_optimizer_matches_brute_force},
+  {"optimizer locked moves", "checks that locked moves are in every recommended set.", test_optimizer_keeps_locked_moves},
+  {"coverage table", "checks which typings a move hits hard and which resist it.", test_coverage_table},
+  {"calculate stats", "checks stats worked out from base stats and level.", test_calculate_stats},
+  {"damage rolls", "checks damage over rolls with STAB, effectiveness and immunity.", test_damage_rolls},
+  {"damage matrix", "checks that batch damage matches one at a time.", test_damage_matrix},
+  {"battle reproducible", "checks that a seed gives the same result on any number of threads.", test_battle_reproducible},
+  {"battle mismatch", "checks that a much stronger team nearly always wins, and a mirror is close.", test_battle_mismatch},
+  {"rating cache", "checks cached ratings are found, saved & loaded by version.", test_rating_cache},
+  {"moveset table", "checks precomputed sets are saved & loaded with their stamp.", test_moveset_table},
+  {"scoring expression", "checks precedence, values and compile errors of rating formulas.", test_scoring_expression},
+  {"scoring batch", "checks that a batch of moves rates the same as one at a time.", test_scoring_batch},
+  {"format multipliers", "checks spread moves gain per foe and lose per ally by board position.", test_format_multipliers},
+  {"hm niches", "checks kept moves go to the quadrants they fill, one each.", test_hm_niches},
+  {"team optimizer", "checks the team-wide search finds the best plan on a small team.", test_team_optimizer},
+  {"setup evaluator", "checks boosting first is taken only when it pays off over the turns.", test_setup_evaluator},
+  {nullptr, nullptr, NULL}
+};
+
+const TestNode* moveset_suite() {
+  return test_moveset_tests;
+}
+
+/// Builds a library of assorted moves for testing.
+static MoveLibrary makeTestLibrary() {
+  MoveLibrary library;
+  for(int i = 0; i < 24; i++) {
+    Move move;
+    move.name_ = "Move " + std::to_string(i);
+    move.elemental_type_ = (Type)((i * 7) % kFairy);
+    move.move_type_ = i % 5 == 0 ? kStatus : (i % 2 == 0 ? kPhysical : kSpecial);
+    move.power_ = move.move_type_ == kStatus ? -1 : 40 + (i * 13) % 80;
+    move.accuracy_ = 70 + (i * 11) % 31;
+    move.pp_ = 10 + i % 4 * 5;
+    move.target_ = i % 5 == 0 ? kSelf : kAnyAdjacentFoe;
+    move.flags_ = classifyMove(move);
+    library.set(move);
+  }
+  return library;
+}
+
+int test_optimizer_matches_brute_force() {
+  MoveLibrary library = makeTestLibrary();
+  TypeChart chart = resources::generateTypeChartGen5();
+  MonsterSpecies species;
+  species.type_ = TypesHad(kFire, kFighting);
+  species.base_stats_.attack_ = 120;
+  species.base_stats_.special_attack_ = 80;
+  Monster monster("test", &species);
+
+  MoveCoverageTable coverage(library, chart);
+  MovesetOptimizer optimizer;
+  optimizer.move_library_ = &library;
+  optimizer.coverage_table_ = &coverage;
+
+  // try every set
+  std::vector<double> scores;
+  for(MoveId a = 0; a < library.size(); a++)
+    for(MoveId b = a + 1; b < library.size(); b++)
+      for(MoveId c = b + 1; c < library.size(); c++)
+        for(MoveId d = c + 1; d < library.size(); d++) {
+          MoveId moves[MOVESET_SIZE] = {a, b, c, d};
+          scores.push_back(optimizer.score(monster, moves, MOVESET_SIZE));
+        }
+  std::sort(scores.begin(), scores.end(), [](double x, double y) { return x > y; });
+
+  // compare with search
+  std::vector<MoveId> movepool;
+  for(MoveId id = 0; id < library.size(); id++)
+    movepool.push_back(id);
+  std::vector<Moveset> best = optimizer.findBest(monster, movepool, std::vector<MoveId>(), 5);
+  if(best.size() != 5) {
+    std::cout << "[Fail] expected 5 sets, got " << best.size() << std::endl;
+    return 100;
+  }
+  for(size_t i = 0; i < best.size(); i++) {
+    if(std::fabs(best[i].score - scores[i]) > 1e-9) {
+      std::cout << "[Fail] set " << i << " scored " << best[i].score << " instead of " << scores[i] << std::endl;
+      return 200;
+    }
+  }
+  return 0;
+}
+
+int test_optimizer_keeps_locked_moves() {
+  MoveLibrary library = makeTestLibrary();
+  TypeChart chart = resources::generateTypeChartGen5();
+  MonsterSpecies species;
+  species.type_ = TypesHad(kWater);
+  Monster monster("test", &species);
+
+  MoveCoverageTable coverage(library, chart);
+  MovesetOptimizer optimizer;
+  optimizer.move_library_ = &library;
+  optimizer.coverage_table_ = &coverage;
+
+  std::vector<MoveId> movepool = {0, 1, 2, 3, 4, 5, 6, 7};
+  std::vector<MoveId> locked = {9, 3};
+  std::vector<Moveset> best = optimizer.findBest(monster, movepool, locked, 3);
+  if(best.empty()) {
+    std::cout << "[Fail] no sets were found" << std::endl;
+    return 100;
+  }
+  for(const Moveset& moveset : best) {
+    if(moveset.count != MOVESET_SIZE || moveset.moves[0] != 9 || moveset.moves[1] != 3) {
+      std::cout << "[Fail] locked moves were not kept" << std::endl;
+      return 200;
+    }
+    for(int i = 2; i < moveset.count; i++) {
+      if(moveset.moves[i] == 3 || moveset.moves[i] == 9) {
+        std::cout << "[Fail] locked move was picked twice" << std::endl;
+        return 300;
+      }
+    }
+  }
+  return 0;
+}
+
+int test_coverage_table() {
+  MoveLibrary library;
+  Move move;
+  move.name_ = "Splash Attack";
+  move.elemental_type_ = kWater;
+  move.move_type_ = kSpecial;
+  move.power_ = 80;
+  move.target_ = kAnyAdjacentFoe;
+  move.flags_ = classifyMove(move);
+  library.set(move);
+  move.name_ = "Growl";
+  move.elemental_type_ = kNormal;
+  move.move_type_ = kStatus;
+  move.power_ = -1;
+  move.flags_ = classifyMove(move);
+  library.set(move);
+  TypeChart chart = resources::generateTypeChartGen5();
+  MoveCoverageTable coverage(library, chart);
+
+  MoveId splash = library.getId("Splash Attack");
+  const TypingSet& super_effective = coverage.getSuperEffective(splash);
+  if(!super_effective.test(getTypingIndex(TypesHad(kFire))) || !super_effective.test(getTypingIndex(TypesHad(kFire, kGround)))) {
+    std::cout << "[Fail] water should hit fire and fire/ground hard" << std::endl;
+    return 100;
+  }
+  if(super_effective.test(getTypingIndex(TypesHad(kFire, kWater)))) {
+    std::cout << "[Fail] water should be neutral on fire/water" << std::endl;
+    return 200;
+  }
+  if(!coverage.getResisted(splash).test(getTypingIndex(TypesHad(kWater, kGrass)))) {
+    std::cout << "[Fail] water/grass should resist water" << std::endl;
+    return 300;
+  }
+
+  // status moves don't attack anything
+  MoveId growl = library.getId("Growl");
+  if(coverage.hasEntry(growl) || coverage.getSuperEffective(growl).any()) {
+    std::cout << "[Fail] status move has coverage" << std::endl;
+    return 400;
+  }
+  MoveId both[] = {splash, growl};
+  if(coverage.getWalls(both, 2) != coverage.getResisted(splash)) {
+    std::cout << "[Fail] walls should only count damaging moves" << std::endl;
+    return 500;
+  }
+  return 0;
+}
+
+int test_calculate_stats() {
+  MonsterStats base;
+  base.hp_ = 100;
+  base.attack_ = 100;
+  base.speed_ = 50;
+  MonsterStats stats = calculateStats(base, 50);
+  if(stats.hp_ != 175 || stats.attack_ != 120 || stats.speed_ != 70 || stats.defense_ != 20) {
+    std::cout << "[Fail] level 50 stats came out as " << stats.hp_ << " hp, " << stats.attack_ << " attack, "
+      << stats.speed_ << " speed, " << stats.defense_ << " defense" << std::endl;
+    return 100;
+  }
+  return 0;
+}
+
+int test_damage_rolls() {
+  // 37 before the roll, with STAB, super effective
+  int rolls[DAMAGE_ROLLS];
+  DamageCalculator::rollDamage(37, 3, 1, 0, rolls);
+  if(rolls[0] != 92 || rolls[DAMAGE_ROLLS - 1] != 110) {
+    std::cout << "[Fail] rolls went from " << rolls[0] << " to " << rolls[DAMAGE_ROLLS - 1] << " instead of 92 to 110" << std::endl;
+    return 100;
+  }
+  for(int i = 1; i < DAMAGE_ROLLS; i++) {
+    if(rolls[i] < rolls[i - 1]) {
+      std::cout << "[Fail] rolls went down" << std::endl;
+      return 200;
+    }
+  }
+
+  // quarter damage still does something
+  DamageCalculator::rollDamage(3, 2, 0, 2, rolls);
+  if(rolls[0] != 1) {
+    std::cout << "[Fail] resisted damage should be at least 1" << std::endl;
+    return 300;
+  }
+
+  // immune
+  MoveLibrary library;
+  Move move;
+  move.name_ = "Tackle";
+  move.elemental_type_ = kNormal;
+  move.move_type_ = kPhysical;
+  move.power_ = 80;
+  library.set(move);
+  TypeChart chart = resources::generateTypeChartGen5();
+  DamageCalculator calculator;
+  calculator.move_library_ = &library;
+  calculator.chart_ = &chart;
+  MonsterSpecies attacker, ghost;
+  attacker.type_ = TypesHad(kNormal);
+  ghost.type_ = TypesHad(kGhost);
+  DamageRange range = calculator.calculate(Combatant(attacker, 50), library.getId("Tackle"), Combatant(ghost, 50));
+  if(range.max != 0 || range.expected != 0.0) {
+    std::cout << "[Fail] ghost took damage from a normal move" << std::endl;
+    return 400;
+  }
+  return 0;
+}
+
+int test_damage_matrix() {
+  MoveLibrary library = makeTestLibrary();
+  TypeChart chart = resources::generateTypeChartGen5();
+  DamageCalculator calculator;
+  calculator.move_library_ = &library;
+  calculator.chart_ = &chart;
+
+  MonsterSpecies species;
+  species.type_ = TypesHad(kFire, kFighting);
+  species.base_stats_.hp_ = 80;
+  species.base_stats_.attack_ = 120;
+  species.base_stats_.defense_ = 70;
+  species.base_stats_.special_attack_ = 80;
+  species.base_stats_.special_defense_ = 70;
+  Combatant attacker(species, 40);
+
+  std::vector<MoveId> moves;
+  for(MoveId id = 0; id < library.size(); id++)
+    moves.push_back(id);
+  std::vector<Combatant> targets;
+  for(int i = 0; i < 5; i++) {
+    MonsterSpecies target;
+    target.type_ = i % 2 == 0 ? TypesHad((Type)(i * 3)) : TypesHad((Type)i, (Type)(i + 7));
+    target.base_stats_.hp_ = 50 + i * 20;
+    target.base_stats_.defense_ = 40 + i * 15;
+    target.base_stats_.special_defense_ = 90 - i * 10;
+    targets.push_back(Combatant(target, 40 + i));
+  }
+
+  std::vector<DamageRange> matrix = calculator.calculateMatrix(attacker, moves, targets);
+  if(matrix.size() != moves.size() * targets.size()) {
+    std::cout << "[Fail] matrix has " << matrix.size() << " entries" << std::endl;
+    return 100;
+  }
+  for(size_t i = 0; i < moves.size(); i++) {
+    for(size_t j = 0; j < targets.size(); j++) {
+      DamageRange single = calculator.calculate(attacker, moves[i], targets[j]);
+      const DamageRange& batch = matrix[i * targets.size() + j];
+      if(single.min != batch.min || single.max != batch.max || std::fabs(single.expected - batch.expected) > 1e-9) {
+        std::cout << "[Fail] move " << i << " on target " << j << " differs" << std::endl;
+        return 200;
+      }
+    }
+  }
+  return 0;
+}
+
+/// A team of one, using the first four moves of the test library.
+static BattleTeam makeBattleTeam(const MonsterSpecies& species, const int level) {
+  Moveset moveset;
+  moveset.count = MOVESET_SIZE;
+  moveset.score = 0.0;
+  for(int i = 0; i < MOVESET_SIZE; i++)
+    moveset.moves[i] = i + 1;
+  BattleTeam team;
+  team.add(Combatant(species, level), moveset);
+  return team;
+}
+
+int test_battle_reproducible() {
+  MoveLibrary library = makeTestLibrary();
+  TypeChart chart = resources::generateTypeChartGen5();
+  MonsterSpecies species;
+  species.type_ = TypesHad(kWater);
+  species.base_stats_.hp_ = species.base_stats_.attack_ = species.base_stats_.defense_ = 80;
+  species.base_stats_.special_attack_ = species.base_stats_.special_defense_ = species.base_stats_.speed_ = 80;
+  BattleTeam team = makeBattleTeam(species, 50);
+
+  BattleSimulator simulator;
+  simulator.move_library_ = &library;
+  simulator.chart_ = &chart;
+  simulator.thread_count_ = 1;
+  BattleResult one = simulator.simulate(team, team, 5000, 7);
+  simulator.thread_count_ = 4;
+  BattleResult four = simulator.simulate(team, team, 5000, 7);
+  if(one.games != 5000 || one.wins != four.wins || one.losses != four.losses || one.turns != four.turns) {
+    std::cout << "[Fail] results differ with thread count" << std::endl;
+    return 100;
+  }
+  BattleResult other_seed = simulator.simulate(team, team, 5000, 8);
+  if(other_seed.wins == one.wins && other_seed.turns == one.turns) {
+    std::cout << "[Fail] another seed gave the same games" << std::endl;
+    return 200;
+  }
+  return 0;
+}
+
+int test_battle_mismatch() {
+  MoveLibrary library = makeTestLibrary();
+  TypeChart chart = resources::generateTypeChartGen5();
+  MonsterSpecies species;
+  species.type_ = TypesHad(kWater);
+  species.base_stats_.hp_ = species.base_stats_.attack_ = species.base_stats_.defense_ = 80;
+  species.base_stats_.special_attack_ = species.base_stats_.special_defense_ = species.base_stats_.speed_ = 80;
+
+  BattleSimulator simulator;
+  simulator.move_library_ = &library;
+  simulator.chart_ = &chart;
+
+  // same level and moves, so the first team wins about half the time
+  BattleResult mirror = simulator.simulate(makeBattleTeam(species, 50), makeBattleTeam(species, 50), 20000, 1);
+  double low, high;
+  mirror.confidenceInterval(&low, &high);
+  if(low > 0.5 || high < 0.5) {
+    std::cout << "[Fail] mirror match won " << mirror.winRate() << " of the time" << std::endl;
+    return 100;
+  }
+
+  // much higher level
+  BattleResult mismatch = simulator.simulate(makeBattleTeam(species, 80), makeBattleTeam(species, 20), 2000, 1);
+  if(mismatch.winRate() < 0.95) {
+    std::cout << "[Fail] level 80 beat level 20 only " << mismatch.winRate() << " of the time" << std::endl;
+    return 200;
+  }
+  return 0;
+}
+
+int test_rating_cache() {
+  RatingCache cache;
+  double rating = 0.0;
+  if(cache.find({1, 2, 50, 7}, &rating)) {
+    std::cout << "[Fail] empty cache found a rating" << std::endl;
+    return 100;
+  }
+  cache.store({1, 2, 50, 7}, 0.25);
+  cache.store({1, 2, 51, 7}, 0.5);
+  cache.store({1, 2, 50, 8}, 0.75);
+  if(!cache.find({1, 2, 50, 7}, &rating) || rating != 0.25 || cache.hits() != 1 || cache.misses() != 1) {
+    std::cout << "[Fail] stored rating was not found" << std::endl;
+    return 200;
+  }
+
+  // only version 7 comes back
+  const std::string filepath = "test_rating_cache.tmp";
+  if(!cache.save(filepath)) {
+    std::cout << "[Fail] couldn't save" << std::endl;
+    return 300;
+  }
+  RatingCache loaded;
+  bool ok = loaded.load(filepath, 7);
+  if(!ok || loaded.size() != 2 || !loaded.find({1, 2, 51, 7}, &rating) || rating != 0.5 || loaded.find({1, 2, 50, 8}, &rating)) {
+    std::remove(filepath.c_str());
+    std::cout << "[Fail] loaded cache is wrong" << std::endl;
+    return 400;
+  }
+
+  // a count past the end of the file, by one record or by far
+  const uint64_t counts[] = {4, (uint64_t)1 << 61};
+  for(uint64_t count : counts) {
+    {
+      std::fstream file(filepath, std::ios::binary | std::ios::in | std::ios::out);
+      file.seekp(sizeof(uint32_t) + 4);
+      file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    }
+    RatingCache refused;
+    if(refused.load(filepath, 7) || refused.size() != 0) {
+      std::remove(filepath.c_str());
+      std::cout << "[Fail] loaded a cache claiming " << count << " records" << std::endl;
+      return 450;
+    }
+  }
+  std::remove(filepath.c_str());
+  if(loaded.load("no such file", 7)) {
+    std::cout << "[Fail] missing file loaded" << std::endl;
+    return 500;
+  }
+  return 0;
+}
+
+int test_moveset_table() {
+  MoveLibrary library = makeTestLibrary();
+  MonsterSpeciesLibrary species_library;
+  MonsterSpecies species;
+  species.name_ = "Tester";
+  species_library.set(42, species);
+
+  MovesetTable table;
+  table.version_ = 1234;
+  table.level_ = 25;
+  table.level_cap_ = 30;
+  table.learn_methods_ = kLevelUpAndMachines;
+  Moveset full = {{3, 1, 4, 5}, 4, 12.5};
+  Moveset partial = {{9, 2, 0, 0}, 2, 7.25};
+  table.set(42, std::vector<Moveset>({full, partial}));
+
+  const std::string filepath = "test_moveset_table.tmp";
+  MovesetTable loaded;
+  bool ok = table.save(filepath, library, species_library) && loaded.load(filepath, library);
+  std::remove(filepath.c_str());
+  if(!ok) {
+    std::cout << "[Fail] couldn't save & load" << std::endl;
+    return 100;
+  }
+  if(!loaded.matches(1234, 30, kLevelUpAndMachines) || loaded.matches(1234, 31, kLevelUpAndMachines)
+    || loaded.level_ != 25) {
+    std::cout << "[Fail] stamp was not kept" << std::endl;
+    return 200;
+  }
+  const std::vector<Moveset>* sets = loaded.find(42);
+  if(sets == nullptr || sets->size() != 2 || loaded.find(1) != nullptr) {
+    std::cout << "[Fail] wrong entries" << std::endl;
+    return 300;
+  }
+  const Moveset& second = (*sets)[1];
+  if((*sets)[0].count != 4 || (*sets)[0].moves[2] != 4 || second.count != 2 || second.moves[0] != 9 || second.score != 7.25) {
+    std::cout << "[Fail] sets came back different" << std::endl;
+    return 400;
+  }
+
+  // a learnset edit leaves ratings alone, but not the sets
+  driver::MovesetAnalyzer analyzer;
+  analyzer.move_library_ = &library;
+  analyzer.roster_ = {species_library.get(42)};
+  uint32_t rating_version = analyzer.getRatingVersion();
+  loaded.version_ = analyzer.getMovesetVersion();
+  MonsterSpecies edited = *species_library.get(42);
+  LearnsetMove learned("Move 2");
+  learned.move_id_ = 2;
+  learned.learned_at_level_ = 2;
+  edited.learnset_.push_back(learned);
+  analyzer.roster_ = {&edited};
+  if(analyzer.getRatingVersion() != rating_version
+    || loaded.matches(analyzer.getMovesetVersion(), 30, kLevelUpAndMachines)) {
+    std::cout << "[Fail] table was kept after a learnset edit" << std::endl;
+    return 500;
+  }
+  return 0;
+}
+
+int test_scoring_expression() {
+  double variables[kScoringVariableCount] = {};
+  variables[kScoringPower] = 90;
+  variables[kScoringAccuracy] = -1;
+  variables[kScoringStatus] = 1;
+  struct Case {
+    const char* source;
+    double expected;
+  };
+  const Case cases[] = {
+    {"1 + 2 * 3", 7},
+    {"(1 + 2) * 3", 9},
+    {"10 - 4 - 3", 3},
+    {"-2 * -3", 6},
+    {"1 < 2 == 1", 1},
+    {"0 || 1 && 0", 0},
+    {"!0 + !5", 1},
+    {"status ? 0.8 : power / 90", 0.8},
+    {"0 ? 1 : 0 ? 2 : 3", 3},
+    {"min(power, 100) + max(2, 3) - abs(accuracy)", 92},
+    {"power / 0", 0},
+    {"special_attack + level", 0}
+  };
+  ScoringExpression expression;
+  for(const Case& c : cases) {
+    std::string error;
+    if(!expression.compile(c.source, &error) || std::fabs(expression.evaluate(variables) - c.expected) > 1e-9) {
+      std::cout << "[Fail] '" << c.source << "' should be " << c.expected << " " << error << std::endl;
+      return 100;
+    }
+  }
+
+  // errors name the problem and keep the old program
+  const char* bad[] = {"1 +", "power * (2", "speeed", "min(1)", "1 2", "3 $ 4"};
+  for(const char* source : bad) {
+    std::string error;
+    if(expression.compile(source, &error) || error.empty()) {
+      std::cout << "[Fail] '" << source << "' should not compile" << std::endl;
+      return 200;
+    }
+  }
+  if(expression.getSource() != "special_attack + level" || !expression.usesVariable(kScoringLevel)
+    || expression.usesVariable(kScoringDamage)) {
+    std::cout << "[Fail] failed compile changed the program" << std::endl;
+    return 300;
+  }
+  return 0;
+}
+
+int test_scoring_batch() {
+  // the rating moves had before it was configurable
+  ScoringExpression expression;
+  std::string error;
+  if(!expression.compile("!suited ? 0 : status ? 0.8 : min((accuracy < 0 ? 1 : (accuracy - 100) / 10) * pp / 20 * power / 90, 1)", &error)) {
+    std::cout << "[Fail] " << error << std::endl;
+    return 100;
+  }
+
+  // more than a chunk, and not a whole number of them
+  MoveLibrary library = makeTestLibrary();
+  const size_t count = SCORING_CHUNK * 2 + 7;
+  ScoringBatch batch;
+  batch.resize(count);
+  for(size_t i = 0; i < count; i++) {
+    const Move& move = library.get((MoveId)(i % library.size()));
+    batch.column(kScoringPower)[i] = move.power_;
+    batch.column(kScoringAccuracy)[i] = i % 3 == 0 ? -1 : move.accuracy_;
+    batch.column(kScoringPp)[i] = move.pp_;
+    batch.column(kScoringStatus)[i] = move.move_type_ == kStatus;
+    batch.column(kScoringSuited)[i] = i % 4 != 1;
+  }
+  std::vector<double> ratings(count);
+  expression.evaluate(batch, ratings.data());
+
+  for(size_t i = 0; i < count; i++) {
+    double variables[kScoringVariableCount];
+    for(int v = 0; v < kScoringVariableCount; v++)
+      variables[v] = batch.column((ScoringVariable)v)[i];
+    double accuracy = variables[kScoringAccuracy] < 0 ? 1.0 : (variables[kScoringAccuracy] - 100) / 10;
+    double expected = variables[kScoringSuited] == 0 ? 0.0 : variables[kScoringStatus] != 0 ? 0.8
+      : std::fmin(accuracy * variables[kScoringPp] / 20 * variables[kScoringPower] / 90, 1.0);
+    if(std::fabs(ratings[i] - expected) > 1e-9 || ratings[i] != expression.evaluate(variables)) {
+      std::cout << "[Fail] move " << i << " rated " << ratings[i] << ", expected " << expected << std::endl;
+      return 200;
+    }
+  }
+  return 0;
+}
+
+int test_format_multipliers() {
+  // one damaging move per description, plus a spread status move
+  MoveLibrary library;
+  for(int i = 0; i <= kNullTargetDescription; i++) {
+    Move move;
+    move.name_ = "Move " + std::to_string(i);
+    move.elemental_type_ = kNormal;
+    move.move_type_ = i < kNullTargetDescription ? kPhysical : kStatus;
+    move.power_ = move.move_type_ == kStatus ? -1 : 80;
+    move.target_ = i < kNullTargetDescription ? (MoveTargetDescription)i : kAllAdjacent;
+    move.flags_ = classifyMove(move);
+    library.set(move);
+  }
+  std::vector<MoveId> moves;
+  for(MoveId id = 0; id < library.size(); id++)
+    moves.push_back(id);
+
+  driver::MovesetAnalyzer analyzer;
+  analyzer.move_library_ = &library;
+  std::vector<double> singles = analyzer.getFormatMultipliers(moves);
+  if(std::count(singles.begin(), singles.end(), 1.0) != (long)singles.size()) {
+    std::cout << "[Fail] singles should leave ratings alone" << std::endl;
+    return 100;
+  }
+
+  // the middle of a triple reaches every foe, and both allies
+  analyzer.format_ = kTriples;
+  analyzer.board_position_ = 1;
+  std::vector<double> middle = analyzer.getFormatMultipliers(moves);
+  if(middle[kAnyAdjacentFoe] != 1.0 || middle[kAllAdjacentFoes] != 2.25 || middle[kAllAdjacent] != 0.75
+    || middle[kSelf] != 1.0 || middle[kNullTargetDescription] != 2.25) {
+    std::cout << "[Fail] wrong multipliers in the middle" << std::endl;
+    return 200;
+  }
+
+  // the edge only reaches two foes and one ally
+  analyzer.board_position_ = 0;
+  std::vector<double> edge = analyzer.getFormatMultipliers(moves);
+  if(edge[kAllAdjacentFoes] != 1.5 || edge[kAllAdjacent] != 0.75 || edge[kAllFoes] != 2.25 || edge[kAll] != 0.75) {
+    std::cout << "[Fail] wrong multipliers on the edge" << std::endl;
+    return 300;
+  }
+  return 0;
+}
+
+int test_hm_niches() {
+  // status, second type STAB, off type and first type STAB
+  MoveLibrary library;
+  const Type types[] = {kNormal, kWater, kIce, kFire};
+  for(int i = 0; i < 4; i++) {
+    Move move;
+    move.name_ = "Move " + std::to_string(i);
+    move.elemental_type_ = types[i];
+    move.move_type_ = i == 0 ? kStatus : kSpecial;
+    move.power_ = i == 0 ? -1 : 80;
+    move.pp_ = 15;
+    move.flags_ = classifyMove(move);
+    library.set(move);
+  }
+  MonsterSpecies species;
+  species.type_ = TypesHad(kFire, kWater);
+  Monster monster("test", &species);
+  driver::MovesetAnalyzer analyzer;
+  analyzer.move_library_ = &library;
+
+  // each lands in its own quadrant, whatever order they are kept in
+  monster.hm_moves_ = {0, 1, 2, 3};
+  std::vector<MoveId> kept;
+  std::bitset<4> taken = analyzer.analyzeHMniches(monster, &kept);
+  if(!taken.all() || kept != std::vector<MoveId>({3, 1, 2, 0})) {
+    std::cout << "[Fail] moves were put in the wrong quadrants" << std::endl;
+    return 100;
+  }
+
+  // two of the same kind still get a quadrant each
+  monster.hm_moves_ = {2, 3, 0, 3};
+  taken = analyzer.analyzeHMniches(monster, &kept);
+  if(!taken.all() || kept[3] != 0 || kept[2] != 2 || kept[0] != 3 || kept[1] != 3) {
+    std::cout << "[Fail] doubled moves weren't spread out" << std::endl;
+    return 200;
+  }
+
+  monster.hm_moves_ = {0};
+  taken = analyzer.analyzeHMniches(monster, &kept);
+  if(taken.count() != 1 || !taken[3] || kept[0] != kNullMoveId) {
+    std::cout << "[Fail] status move should take only the last quadrant" << std::endl;
+    return 300;
+  }
+  return 0;
+}
+
+int test_team_optimizer() {
+  MoveLibrary library = makeTestLibrary();
+  TypeChart chart = resources::generateTypeChartGen5();
+  MoveCoverageTable coverage(library, chart);
+
+  // four members with four two-move candidates each, made so that each
+  // member's own favorite overlaps with the others'
+  const int members = 4;
+  const int options = 4;
+  std::vector<std::vector<Moveset>> candidates(members);
+  for(int m = 0; m < members; m++) {
+    for(int c = 0; c < options; c++) {
+      Moveset moveset = {{(MoveId)((m * 5 + c * 7) % library.size()), (MoveId)((m + c * 3 + 1) % library.size()), 0, 0}, 2, 10.0 - c * 0.75};
+      candidates[m].push_back(moveset);
+    }
+  }
+  std::vector<double> threats(kNullType, 0.0);
+  for(int t = 0; t < kNullType; t++) {
+    threats[t] = (t * 5) % 3;
+  }
+
+  TeamOptimizer optimizer;
+  optimizer.coverage_table_ = &coverage;
+  optimizer.thread_count_ = 2;
+
+  // every plan, for comparison
+  double best = -1e9;
+  std::vector<int> choices(members, 0);
+  for(int plan = 0; plan < 256; plan++) {
+    for(int m = 0; m < members; m++)
+      choices[m] = (plan >> (2 * m)) & 3;
+    best = std::max(best, optimizer.score(candidates, threats, choices));
+  }
+
+  TeamPlan found = optimizer.optimize(candidates, threats, 7);
+  if(std::fabs(found.score - best) > 1e-9 || std::fabs(optimizer.score(candidates, threats, found.choices) - found.score) > 1e-9) {
+    std::cout << "[Fail] found " << found.score << ", best is " << best << std::endl;
+    return 100;
+  }
+  optimizer.thread_count_ = 1;
+  if(optimizer.optimize(candidates, threats, 7).choices != found.choices) {
+    std::cout << "[Fail] plan changed with thread count" << std::endl;
+    return 200;
+  }
+
+  // members without candidates are left out
+  candidates[1].clear();
+  found = optimizer.optimize(candidates, threats, 7);
+  if(found.choices[1] != -1) {
+    std::cout << "[Fail] empty member was given a set" << std::endl;
+    return 300;
+  }
+  return 0;
+}
+
+int test_setup_evaluator() {
+  // an attack, and a sure +2 attack boost
+  MoveLibrary library;
+  Move attack;
+  attack.name_ = "Attack";
+  attack.elemental_type_ = kNormal;
+  attack.move_type_ = kPhysical;
+  attack.power_ = 40;
+  attack.accuracy_ = 100;
+  attack.target_ = kAnyAdjacentFoe;
+  attack.flags_ = classifyMove(attack);
+  library.set(attack);
+  Move boost;
+  boost.name_ = "Boost";
+  boost.elemental_type_ = kNormal;
+  boost.move_type_ = kStatus;
+  boost.target_ = kSelf;
+  boost.stat_modifiers_self_.attack_ = 2;
+  boost.flags_ = classifyMove(boost);
+  library.set(boost);
+
+  MonsterSpecies weak;
+  weak.type_ = TypesHad(kFire);
+  weak.base_stats_.hp_ = weak.base_stats_.attack_ = weak.base_stats_.defense_ = 60;
+  MonsterSpecies bulky;
+  bulky.type_ = TypesHad(kWater);
+  bulky.base_stats_.hp_ = bulky.base_stats_.defense_ = 200;
+  bulky.base_stats_.attack_ = 60;
+  TypeChart chart = resources::generateTypeChartGen5();
+  DamageCalculator calculator;
+  calculator.move_library_ = &library;
+  calculator.chart_ = &chart;
+  Combatant attacker(weak, 50);
+  std::vector<Combatant> targets = {Combatant(bulky, 50)};
+
+  // damage of the attack after some boosts
+  auto boosted = [&](const int stage) {
+    Combatant user = attacker;
+    user.stats.attack_ = SetupEvaluator::stagedStat(user.stats.attack_, stage);
+    return calculator.calculate(user, 0, targets[0]).expectedFraction();
+  };
+
+  SetupEvaluator evaluator;
+  evaluator.damage_calculator_ = &calculator;
+  evaluator.prepare(attacker, targets, 4);
+  const MoveId attack_only[] = {0};
+  double plain = evaluator.evaluate(attack_only, 1);
+  if(std::fabs(plain - 4 * boosted(0)) > 1e-9) {
+    std::cout << "[Fail] four attacks should be " << 4 * boosted(0) << ", not " << plain << std::endl;
+    return 100;
+  }
+
+  // best is some boosts, then attacking every turn after
+  const MoveId both[] = {1, 0};
+  std::vector<MoveId> sequence;
+  double with_boost = evaluator.evaluate(both, 2, &sequence);
+  double best = 0.0;
+  int best_boosts = 0;
+  for(int boosts = 0; boosts < 4; boosts++) {
+    double total = (4 - boosts) * boosted(std::min(2 * boosts, SETUP_MAX_STAGE));
+    if(total > best + 1e-12) {
+      best = total;
+      best_boosts = boosts;
+    }
+  }
+  if(std::fabs(with_boost - best) > 1e-9 || sequence.size() != 4 || best_boosts == 0
+    || std::count(sequence.begin(), sequence.end(), 1) != best_boosts || sequence.back() != 0) {
+    std::cout << "[Fail] expected " << best_boosts << " boosts for " << best << ", got " << with_boost << std::endl;
+    return 200;
+  }
+
+  // tables carry over, and the memo doesn't
+  if(evaluator.evaluate(attack_only, 1) != plain) {
+    std::cout << "[Fail] earlier moveset was remembered" << std::endl;
+    return 300;
+  }
+
+  // a table shared over the roster agrees, for another evaluator too
+  SetupDamageTable shared(&calculator, std::vector<const MonsterSpecies*>{&bulky});
+  SetupEvaluator first, second;
+  first.prepare(attacker, &shared, 4);
+  second.prepare(attacker, &shared, 4);
+  if(first.evaluate(both, 2) != with_boost || second.evaluate(both, 2) != with_boost
+    || second.evaluate(attack_only, 1) != plain) {
+    std::cout << "[Fail] shared table disagrees with the targets given" << std::endl;
+    return 400;
+  }
+  return 0;
+}
+
+} // namespace test
+} // namespace pokeman
\ No newline at end of file
@@ -0,0 +1,18 @@
+﻿/*
+* test_moveset.hpp
+* Author: Kathryn McKay
+* Pokeman Project
+* May 2016
+*/
+#ifndef POKEMAN_TEST_MOVESET_HPP_
+#define POKEMAN_TEST_MOVESET_HPP_
+
+#include "test_core.hpp"
+
+namespace pokeman {
+namespace test {
+const TestNode* moveset_suite();
+} // namespace test
+} // namespace pokeman
+
+#endif //POKEMAN_TEST_MOVESET_HPP_
\ No newline at end of file
@@ -48,6 +48,13 @@ int test_type_chart_xy();
 // learnset move tests
 int test_learnset_move_memo();
 
+// move tests
+int test_classify_move();
+int test_move_set_algebra();
+
+// species tests
+int test_learnset_index();
+
 // test suite
 static const TestNode test_pokeman_tests[] = {
   {"type count", "checks if all types have been included.", test_pokeman_type_count},
@@ -63,6 +70,9 @@ static const TestNode test_pokeman_tests[] = {
   {"check single lookup", "checsk type chart isWeakTo, etc.", test_type_chart_quick},
   {"check effectiveness lookup", "checks if XY function works", test_type_chart_xy},
   {"learnset move memo", "checks that memo is set when function is called", test_learnset_move_memo},
+  {"classify move", "checks that move flags are derived from move fields", test_classify_move},
+  {"move set algebra", "checks union, intersection & difference of move sets", test_move_set_algebra},
+  {"learnset index", "checks movepool queries by level cap and learn method", test_learnset_index},
   {nullptr, nullptr, NULL}
 };
 
@@ -597,5 +607,106 @@ int test_learnset_move_memo() {
   return 0;
 }
 
+int test_classify_move() {
+  // attack
+  Move attack;
+  attack.move_type_ = kPhysical;
+  attack.power_ = 80;
+  attack.target_ = kAnyAdjacentFoe;
+  MoveFlags expected = kMoveDamaging | kMoveTargetsFoe | kMoveTargetsAdjacent | kMoveTargetSelectable;
+  if(classifyMove(attack) != expected) {
+    std::cout << "attack was classified as " << classifyMove(attack) << " instead of " << expected << std::endl;
+    return 100;
+  }
+
+  // self buff
+  Move buff;
+  buff.move_type_ = kStatus;
+  buff.target_ = kSelf;
+  buff.stat_modifiers_self_.special_attack_ = 2;
+  expected = kMoveStatus | kMoveTargetsSelf | kMoveSelfStatChange | kMoveBoostsSpecialAttack;
+  if(classifyMove(buff) != expected) {
+    std::cout << "buff was classified as " << classifyMove(buff) << " instead of " << expected << std::endl;
+    return 200;
+  }
+
+  // debuff on foes
+  Move debuff;
+  debuff.move_type_ = kStatus;
+  debuff.target_ = kAllFoes;
+  debuff.stat_modifiers_target_.defense_ = -1;
+  expected = kMoveStatus | kMoveTargetsFoe | kMoveTargetStatChange;
+  if(classifyMove(debuff) != expected) {
+    std::cout << "debuff was classified as " << classifyMove(debuff) << " instead of " << expected << std::endl;
+    return 300;
+  }
+  return 0;
+}
+
+int test_move_set_algebra() {
+  // sets spanning more than one word, of different lengths
+  MoveSet a(std::vector<MoveId>({1, 5, 64, 130}));
+  MoveSet b(std::vector<MoveId>({5, 64, 70}));
+
+  std::vector<MoveId> either = (a | b).toVector();
+  std::vector<MoveId> both = (a & b).toVector();
+  std::vector<MoveId> only_a = (a - b).toVector();
+  std::vector<MoveId> only_b = (b - a).toVector();
+  if(either != std::vector<MoveId>({1, 5, 64, 70, 130})) {
+    std::cout << "[Fail] union" << std::endl;
+    return 100;
+  } else if(both != std::vector<MoveId>({5, 64})) {
+    std::cout << "[Fail] intersection" << std::endl;
+    return 200;
+  } else if(only_a != std::vector<MoveId>({1, 130}) || only_b != std::vector<MoveId>({70})) {
+    std::cout << "[Fail] difference" << std::endl;
+    return 300;
+  } else if(a.count() != 4 || !a.contains(130) || a.contains(129) || a.contains(1000)) {
+    std::cout << "[Fail] count or lookup" << std::endl;
+    return 400;
+  } else if(!(a & MoveSet()).empty()) {
+    std::cout << "[Fail] intersection with empty set" << std::endl;
+    return 500;
+  }
+  return 0;
+}
+
+int test_learnset_index() {
+  // ids 0-4 by level, out of order, 5 by machine, 6 by tutor, 2 also by machine
+  MonsterSpecies species;
+  const int levels[] = {12, 1, 30, 5, 12};
+  for(int i = 0; i < 5; i++) {
+    LearnsetMove move;
+    move.move_id_ = i;
+    move.learned_at_level_ = levels[i];
+    move.b_machine_able_ = i == 2;
+    species.learnset_.push_back(move);
+  }
+  LearnsetMove machine;
+  machine.move_id_ = 5;
+  machine.b_machine_able_ = true;
+  species.learnset_.push_back(machine);
+  LearnsetMove tutor;
+  tutor.move_id_ = 6;
+  tutor.setAsMoveTutorableWithMemo("somewhere");
+  species.learnset_.push_back(tutor);
+  species.indexLearnset();
+
+  if(species.getMovepool(12, kLevelUpOnly).toVector() != std::vector<MoveId>({1, 3, 0, 4})) {
+    std::cout << "[Fail] level up moves by 12" << std::endl;
+    return 100;
+  } else if(!species.getMovepool(0, kLevelUpOnly).empty()) {
+    std::cout << "[Fail] moves before level 1" << std::endl;
+    return 200;
+  } else if(species.getMovepool(4, kLevelUpAndMachines).toVector() != std::vector<MoveId>({2, 5, 1})) {
+    std::cout << "[Fail] machines and level up moves by 4" << std::endl;
+    return 300;
+  } else if(species.getMovepool().size() != 8 || MoveSet(species.getMovepool()).count() != 7) {
+    std::cout << "[Fail] whole movepool" << std::endl;
+    return 400;
+  }
+  return 0;
+}
+
 } // namespace test
 } // namespace pokeman
\ No newline at end of file
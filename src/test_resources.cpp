@@ -6,19 +6,46 @@
 */
 #include "test_resources.hpp"
 
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <sstream>
 
+#include "data_generator.hpp"
+#include "event_readers.hpp"
+#include "pmdb.hpp"
+#include "pokeman_loader.hpp"
 #include "resources.hpp"
+#include "species_index.hpp"
 
 namespace pokeman {
 namespace test {
 
 int check_types_all_exist();
 int check_gen5_chart();
+int test_compiled_database();
+int test_record_stream();
+int test_dangling_references();
+int test_string_arena();
+int test_data_generator();
+int test_event_readers();
+int test_species_index();
 
 static const TestNode test_resource_tests[] = {
   { "check types all exist", "ensures all types have an entry", check_types_all_exist},
   { "gen5 chart", "ensures gen5 chart is valid", check_gen5_chart},
+  { "compiled database", "compiles the data and loads it back", test_compiled_database},
+  { "record stream", "streams species one at a time like a whole parse", test_record_stream},
+  { "dangling references", "reports every unknown species and move at once", test_dangling_references},
+  { "string arena", "interns each name once", test_string_arena},
+  { "data generator", "makes up data that loads, the same each time", test_data_generator},
+  { "event readers", "reads json and csv into the same records as yaml", test_event_readers},
+  { "species index", "reads only the species asked for, by their byte ranges", test_species_index},
   { nullptr, nullptr, NULL }
 };
 
@@ -150,5 +177,478 @@ int check_gen5_chart() {
 
   return failures;
 }
+
+int test_compiled_database() {
+  resources::Loader loader(FILEPATH_CONFIG);
+  resources::PokemanDatabase sources;
+  if(loader.errorOccured() || !sources.loadSources(loader)) {
+    std::cout << "[Fail] couldn't load the sources" << std::endl;
+    return 100;
+  }
+
+  const std::string filepath = "test_compiled_database.tmp";
+  resources::PokemanDatabase compiled;
+  std::string error;
+  bool ok = resources::writePmdb(sources, 1234, filepath) && compiled.loadCompiled(filepath, 1234, &error);
+  if(!ok) {
+    std::remove(filepath.c_str());
+    std::cout << "[Fail] couldn't compile & load: " << error << std::endl;
+    return 200;
+  }
+
+  // same moves under the same ids, same learnsets, same team
+  const MoveLibrary& moves = compiled.getMoves();
+  bool same = moves.size() == sources.getMoves().size();
+  for(MoveId id = 0; same && id < moves.size(); id++) {
+    same = moves.get(id).name_ == sources.getMoves().get(id).name_ && moves.getFlags(id) == sources.getMoves().getFlags(id);
+  }
+  std::vector<const MonsterSpecies*> species = compiled.getSpecies().getAll();
+  std::vector<const MonsterSpecies*> source_species = sources.getSpecies().getAll();
+  same = same && species.size() == source_species.size();
+  for(size_t i = 0; same && i < species.size(); i++) {
+    same = species[i]->name_ == source_species[i]->name_ && species[i]->number_ == source_species[i]->number_
+      && species[i]->learnset_index_ == source_species[i]->learnset_index_
+      && species[i]->getMovepool(30, kLevelUpOnly).size() == source_species[i]->getMovepool(30, kLevelUpOnly).size();
+  }
+  same = same && compiled.getTeam().size() == sources.getTeam().size();
+  for(size_t i = 0; same && i < compiled.getTeam().size(); i++) {
+    const Monster& monster = compiled.getTeam()[i];
+    same = monster.name_ == sources.getTeam()[i].name_ && monster.level_ == sources.getTeam()[i].level_
+      && monster.species_ == compiled.getSpecies().get(sources.getTeam()[i].species_->number_)
+      && monster.hm_moves_ == sources.getTeam()[i].hm_moves_;
+  }
+  if(!same) {
+    std::remove(filepath.c_str());
+    std::cout << "[Fail] compiled database differs from the sources" << std::endl;
+    return 300;
+  }
+
+  // a move without a type, under a checksum that matches
+  std::string bytes;
+  {
+    std::ifstream file(filepath, std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+  resources::PmdbHeader header;
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  int32_t null_type = kNullType;
+  std::memcpy(&bytes[header.moves_offset + offsetof(resources::PmdbMove, elemental_type)], &null_type, sizeof(null_type));
+  header.checksum = resources::getPmdbChecksum(reinterpret_cast<const uint8_t*>(bytes.data()) + sizeof(header),
+    bytes.size() - sizeof(header));
+  std::memcpy(&bytes[0], &header, sizeof(header));
+  const std::string untyped_path = "test_compiled_database_untyped.tmp";
+  {
+    std::ofstream file(untyped_path, std::ios::binary);
+    file.write(bytes.data(), (std::streamsize)bytes.size());
+  }
+  resources::PokemanDatabase refused;
+  bool untyped = refused.loadCompiled(untyped_path, 1234, &error);
+  std::remove(untyped_path.c_str());
+  if(untyped) {
+    std::remove(filepath.c_str());
+    std::cout << "[Fail] loaded a move without a type" << std::endl;
+    return 350;
+  }
+
+  // other sources, then a flipped byte
+  bool stale = refused.loadCompiled(filepath, 4321, &error);
+  {
+    std::fstream file(filepath, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(-2, std::ios::end);
+    file.put('?');
+  }
+  bool corrupt = refused.loadCompiled(filepath, 1234, &error);
+  std::remove(filepath.c_str());
+  if(stale || corrupt) {
+    std::cout << "[Fail] loaded a stale or corrupt database" << std::endl;
+    return 400;
+  }
+  return 0;
+}
+
+int test_record_stream() {
+  const std::string text =
+    "---\n"
+    "- name: Orc\n"
+    "  number: 1\n"
+    "  types: [Fire, Fighting]\n"
+    "  basestats: &stats {hp: 110, attack: 123, defense: 65, spatk: 100, spdef: 65, speed: 65}\n"
+    "  learnset:\n"
+    "    leveling:\n"
+    "      - {name: Orc Punch, level: 1}\n"
+    "      - {name: Squeal, level: 11}\n"
+    "    tutoring: [Revive]\n"
+    "- name: Dryad\n"
+    "  number: 2\n"
+    "  types: [Bug, Grass]\n"
+    "  basestats: *stats\n"
+    "  learnset:\n"
+    "    machine: [Ply]\n";
+  SpeciesParser whole_parser;
+  MonsterSpeciesLibrary whole = whole_parser.parse(YAML::Load(text));
+
+  SpeciesParser stream_parser;
+  MonsterSpeciesLibrary streamed;
+  RecordStreamHandler handler([&stream_parser, &streamed](YAML::Node node) {
+    return stream_parser.parseInto(node, &streamed);
+  });
+  std::istringstream input(text);
+  YAML::Parser parser(input);
+  parser.HandleNextDocument(handler);
+  if(!whole_parser.good() || !stream_parser.good() || handler.getRecordCount() != 2) {
+    std::cout << "[Fail] streamed " << handler.getRecordCount() << " species" << std::endl;
+    return 100;
+  }
+
+  // same species, with the alias followed
+  for(int number = 1; number <= 2; number++) {
+    const MonsterSpecies* a = whole.get(number);
+    const MonsterSpecies* b = streamed.get(number);
+    if(b == nullptr || a->name_ != b->name_ || a->type_.second_type_ != b->type_.second_type_
+      || a->base_stats_.attack_ != b->base_stats_.attack_ || a->learnset_.size() != b->learnset_.size()) {
+      std::cout << "[Fail] species " << number << " streamed differently" << std::endl;
+      return 200;
+    }
+  }
+
+  // skipping the rest
+  int seen = 0;
+  RecordStreamHandler first_only([&seen](YAML::Node node) {
+    seen++;
+    return false;
+  });
+  std::istringstream again(text);
+  YAML::Parser second_parser(again);
+  second_parser.HandleNextDocument(first_only);
+  if(seen != 1 || !first_only.stopped()) {
+    std::cout << "[Fail] stream kept going after being stopped" << std::endl;
+    return 300;
+  }
+
+  // a top level that isn't a sequence is malformed, but an empty one isn't
+  const std::string not_sequences[] = {"name: Orc\nnumber: 1\n", "Orc\n"};
+  for(const std::string& not_sequence : not_sequences) {
+    RecordStreamHandler refused([&seen](YAML::Node node) {
+      seen++;
+      return true;
+    });
+    std::istringstream bad(not_sequence);
+    YAML::Parser bad_parser(bad);
+    bad_parser.HandleNextDocument(refused);
+    if(refused.getFailure().empty() || refused.getRecordCount() != 0) {
+      std::cout << "[Fail] streamed a document that isn't a sequence: " << not_sequence << std::endl;
+      return 400;
+    }
+  }
+  RecordStreamHandler empty([](YAML::Node node) {
+    return true;
+  });
+  std::istringstream nothing("~\n");
+  YAML::Parser empty_parser(nothing);
+  empty_parser.HandleNextDocument(empty);
+  if(!handler.getFailure().empty() || !empty.getFailure().empty()) {
+    std::cout << "[Fail] a sequence or an empty document was refused" << std::endl;
+    return 500;
+  }
+  return 0;
+}
+
+int test_dangling_references() {
+  MoveLibrary moves;
+  Move tackle;
+  tackle.name_ = "Tackle";
+  moves.set(tackle);
+  MonsterSpeciesLibrary species;
+  MonsterSpecies orc;
+  orc.name_ = "Orc";
+  orc.learnset_ = {LearnsetMove("Tackle"), LearnsetMove("Nope")};
+  orc.learnset_[0].learned_at_level_ = 1;
+  orc.learnset_[1].learned_at_level_ = 5;
+  species.set(1, orc);
+
+  // both bad members are reported, and the good one is kept
+  MonsterParser parser(&species, &moves);
+  std::vector<Monster> team = parser.parse(YAML::Load(
+    "- {name: Buster, species: Orc, moves: [Tackle, Slam]}\n"
+    "- {name: Ghost, species: Ork}\n"));
+  if(!parser.good() || team.size() != 1 || team[0].hm_moves_.size() != 1 || parser.getDanglingReferences().size() != 2) {
+    std::cout << "[Fail] team had " << parser.getDanglingReferences().size() << " dangling references" << std::endl;
+    return 100;
+  }
+
+  std::vector<std::string> dangling;
+  if(species.resolveMoves(moves, &dangling) != 1 || dangling.size() != 1 || species.get(1)->getMovepool().size() != 1) {
+    std::cout << "[Fail] learnset had " << dangling.size() << " dangling references" << std::endl;
+    return 200;
+  }
+
+  // kept moves are each kept once, and there can't be more than a moveset
+  MonsterParser repeated_parser(&species, &moves);
+  team = repeated_parser.parse(YAML::Load("- {name: Echo, species: Orc, moves: [Tackle, Tackle]}\n"));
+  MonsterParser greedy_parser(&species, &moves);
+  greedy_parser.parse(YAML::Load("- {name: Greedy, species: Orc, moves: [Tackle, Tackle, Tackle, Tackle, Tackle]}\n"));
+  if(!repeated_parser.good() || team.size() != 1 || team[0].hm_moves_.size() != 1 || greedy_parser.good()) {
+    std::cout << "[Fail] kept moves weren't limited to one moveset" << std::endl;
+    return 300;
+  }
+  return 0;
+}
+
+int test_string_arena() {
+  StringArena arena;
+  std::string name = "Orc Punch";
+  std::string_view first = arena.intern(name);
+  name[0] = 'X'; // the arena keeps its own copy
+  std::string_view again = arena.intern("Orc Punch");
+  std::string long_name(STRING_ARENA_BLOCK_SIZE + 1, 'a');
+  std::string_view long_view = arena.intern(long_name);
+  if(first != "Orc Punch" || again.data() != first.data() || long_view != long_name
+    || arena.intern("Xrc Punch").data() == first.data()) {
+    std::cout << "[Fail] interned names are wrong" << std::endl;
+    return 100;
+  }
+  if(arena.size() != 3 || arena.bytes() != 2 * first.size() + long_name.size() || !arena.intern("").empty()) {
+    std::cout << "[Fail] arena holds " << arena.size() << " names in " << arena.bytes() << " bytes" << std::endl;
+    return 200;
+  }
+  return 0;
+}
+
+int test_data_generator() {
+  DataGenerator generator;
+  generator.species_count_ = 40;
+  generator.move_count_ = 60;
+  generator.team_count_ = 12;
+  const std::string directory = "test_data_generator.tmp";
+  auto readSpecies = [&directory]() {
+    std::ifstream file(directory + "/species.yml");
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  };
+
+  bool written = generator.write(directory);
+  std::string first = readSpecies();
+  written = written && generator.write(directory);
+  resources::Loader loader(directory + "/config.yml");
+  resources::PokemanDatabase data;
+  bool loaded = !loader.errorOccured() && data.loadSources(loader);
+  std::string second = readSpecies();
+  std::filesystem::remove_all(directory);
+  if(!written || !loaded) {
+    std::cout << "[Fail] generated data didn't write or load" << std::endl;
+    return 100;
+  }
+  if(first != second || data.getSpecies().getAll().size() != 40 || data.getMoves().size() != 60
+    || data.getTeam().size() != 12 || data.getSpecies().getAll()[0]->getMovepool().size() < GEN_DATA_MIN_LEVEL_UP) {
+    std::cout << "[Fail] generated data is wrong" << std::endl;
+    return 200;
+  }
+  return 0;
+}
+
+int test_event_readers() {
+  const std::string species_yaml =
+    "- name: Orc\n"
+    "  number: 1\n"
+    "  types: [Fire, Fighting]\n"
+    "  basestats: {hp: 110, attack: 123, defense: 65, spatk: 100, spdef: 65, speed: 65}\n"
+    "  learnset:\n"
+    "    leveling:\n"
+    "      - {name: Orc Punch, level: 1}\n"
+    "      - {name: Squeal, level: 11}\n"
+    "    tutoring: [Revive]\n"
+    "- name: Dryad\n"
+    "  number: 2\n"
+    "  types: [Grass]\n"
+    "  basestats: {hp: 50, attack: 40, defense: 45, spatk: 90, spdef: 95, speed: 70}\n"
+    "  learnset:\n"
+    "    machine: [Ply, \"Orc Punch\"]\n";
+  const std::string species_json =
+    "[{\"name\": \"Orc\", \"number\": 1, \"types\": [\"Fire\", \"Fighting\"],\n"
+    "  \"basestats\": {\"hp\": 110, \"attack\": 123, \"defense\": 65, \"spatk\": 100, \"spdef\": 65, \"speed\": 65},\n"
+    "  \"learnset\": {\"leveling\": [{\"name\": \"Orc Punch\", \"level\": 1}, {\"name\": \"Squ\\u0065al\", \"level\": 11}],\n"
+    "    \"tutoring\": [\"Revive\"]}},\n"
+    " {\"name\": \"Dryad\", \"number\": 2, \"types\": [\"Grass\"],\n"
+    "  \"basestats\": {\"hp\": 50, \"attack\": 40, \"defense\": 45, \"spatk\": 90, \"spdef\": 95, \"speed\": 70},\n"
+    "  \"learnset\": {\"machine\": [\"Ply\", \"Orc Punch\"]}}]\n";
+  const std::string species_csv =
+    "name,number,types[],basestats.hp,basestats.attack,basestats.defense,basestats.spatk,basestats.spdef,"
+    "basestats.speed,learnset.leveling[name:level],learnset.machine[],learnset.tutoring[]\r\n"
+    "Orc,1,Fire|Fighting,110,123,65,100,65,65,Orc Punch:1|Squeal:11,,Revive\r\n"
+    "\"Dryad\",2,Grass,50,40,45,90,95,70,,\"Ply|Orc Punch\",\r\n";
+
+  SpeciesParser yaml_parser;
+  MonsterSpeciesLibrary from_yaml = yaml_parser.parse(YAML::Load(species_yaml));
+  MonsterSpeciesLibrary from_json, from_csv;
+  SpeciesParser json_parser, csv_parser;
+  RecordStreamHandler json_handler([&json_parser, &from_json](YAML::Node node) {
+    return json_parser.parseInto(node, &from_json);
+  });
+  RecordStreamHandler csv_handler([&csv_parser, &from_csv](YAML::Node node) {
+    return csv_parser.parseInto(node, &from_csv);
+  });
+  std::istringstream json_input(species_json), csv_input(species_csv);
+  JsonEventReader json_reader(json_input);
+  CsvEventReader csv_reader(csv_input);
+  if(!json_reader.read(json_handler) || !csv_reader.read(csv_handler) || !json_parser.good() || !csv_parser.good()
+    || json_handler.getRecordCount() != 2 || csv_handler.getRecordCount() != 2) {
+    std::cout << "[Fail] couldn't read species: " << json_reader.getError() << csv_reader.getError() << std::endl;
+    return 100;
+  }
+
+  // every field the same
+  for(const MonsterSpeciesLibrary* library : {&from_json, &from_csv}) {
+    for(int number = 1; number <= 2; number++) {
+      const MonsterSpecies* a = from_yaml.get(number);
+      const MonsterSpecies* b = library->get(number);
+      bool same = b != nullptr && a->name_ == b->name_ && a->type_.b_dual_type_ == b->type_.b_dual_type_
+        && a->type_.first_type_ == b->type_.first_type_ && a->type_.second_type_ == b->type_.second_type_
+        && a->base_stats_.hp_ == b->base_stats_.hp_ && a->base_stats_.speed_ == b->base_stats_.speed_
+        && a->learnset_.size() == b->learnset_.size();
+      for(size_t i = 0; same && i < a->learnset_.size(); i++) {
+        same = a->learnset_[i].move_name_ == b->learnset_[i].move_name_
+          && a->learnset_[i].learned_at_level_ == b->learnset_[i].learned_at_level_
+          && a->learnset_[i].b_machine_able_ == b->learnset_[i].b_machine_able_
+          && a->learnset_[i].b_tutor_able_ == b->learnset_[i].b_tutor_able_;
+      }
+      if(!same) {
+        std::cout << "[Fail] species " << number << " read differently" << std::endl;
+        return 200;
+      }
+    }
+  }
+
+  // moves, with and without status
+  MoveLibraryParser yaml_move_parser;
+  MoveLibrary yaml_moves = yaml_move_parser.parse(YAML::Load(
+    "- {name: Knockout, number: 1, type: Normal, category: Status, target: Self, pp: 30, status: {target: {attack: 2}}}\n"
+    "- {name: Slam, number: 2, type: Normal, category: Physical, pp: 20, power: 80, accuracy: 75}\n"));
+  MoveLibraryParser csv_move_parser;
+  MoveLibrary csv_moves;
+  RecordStreamHandler move_handler([&csv_move_parser, &csv_moves](YAML::Node node) {
+    return csv_move_parser.parseInto(node, &csv_moves);
+  });
+  std::istringstream move_input(
+    "name,number,type,category,target,pp,power,accuracy,status.target.attack\n"
+    "Knockout,1,Normal,Status,Self,30,,,2\n"
+    "Slam,2,Normal,Physical,,20,80,75,\n");
+  CsvEventReader move_reader(move_input);
+  if(!move_reader.read(move_handler) || !csv_move_parser.good() || csv_moves.size() != yaml_moves.size()) {
+    std::cout << "[Fail] couldn't read moves" << std::endl;
+    return 300;
+  }
+  for(MoveId id = 0; id < yaml_moves.size(); id++) {
+    const Move& a = yaml_moves.get(id);
+    const Move& b = csv_moves.get(id);
+    if(a.name_ != b.name_ || a.power_ != b.power_ || a.accuracy_ != b.accuracy_ || a.target_ != b.target_
+      || a.stat_modifiers_target_.attack_ != b.stat_modifiers_target_.attack_
+      || a.status_effect_change_target_ != b.status_effect_change_target_) {
+      std::cout << "[Fail] move " << a.name_ << " read differently" << std::endl;
+      return 400;
+    }
+  }
+
+  // malformed json says where
+  std::istringstream bad_input("[{\"name\": \"Orc\",\n \"number\" 1}]");
+  JsonEventReader bad_reader(bad_input);
+  RecordStreamHandler ignore([](YAML::Node node) { return true; });
+  if(bad_reader.read(ignore) || bad_reader.getErrorMark().line != 1 || bad_reader.getError().empty()) {
+    std::cout << "[Fail] malformed json wasn't caught" << std::endl;
+    return 500;
+  }
+  return 0;
+}
+
+int test_species_index() {
+  const std::string filepath = "test_species_index.tmp";
+  const std::string text =
+    "---\n"
+    "-\n"
+    "  name: Orc\n"
+    "  number: 1\n"
+    "  types: [Fire, Fighting]\n"
+    "  basestats: {hp: 110, attack: 123, defense: 65, spatk: 100, spdef: 65, speed: 65}\n"
+    "  learnset:\n"
+    "    leveling:\n"
+    "      - {name: Orc Punch, level: 1}\n"
+    "- name: Dryad\n"
+    "  number: 2\n"
+    "  types: [Grass]\n"
+    "  basestats: {hp: 50, attack: 40, defense: 45, spatk: 90, spdef: 95, speed: 70}\n"
+    "  learnset:\n"
+    "    machine: [Ply]\n"
+    "- name: Imp\n"
+    "  number: 3\n"
+    "  types: [Dark]\n"
+    "  basestats: {hp: 40, attack: 60, defense: 40, spatk: 60, spdef: 40, speed: 90}\n";
+  auto write = [&filepath](const std::string& contents) {
+    std::ofstream file(filepath, std::ios::binary | std::ios::trunc);
+    file << contents;
+  };
+  auto cleanUp = [&filepath]() {
+    std::remove(filepath.c_str());
+    std::remove((filepath + SPECIES_INDEX_EXTENSION).c_str());
+  };
+
+  write(text);
+  std::shared_ptr<resources::SpeciesIndex> index = std::make_shared<resources::SpeciesIndex>();
+  std::string error;
+  bool opened = index->open(filepath, &error);
+  bool saved = std::filesystem::exists(filepath + SPECIES_INDEX_EXTENSION);
+  if(!opened || !saved || index->getEntries().size() != 3 || index->getEntries()[1].name != "Dryad") {
+    cleanUp();
+    std::cout << "[Fail] couldn't index species: " << error << std::endl;
+    return 100;
+  }
+
+  // only what is asked for is read, and it reads like the whole file
+  SpeciesParser parser;
+  MonsterSpeciesLibrary whole = parser.parse(YAML::Load(text));
+  MonsterSpeciesLibrary lazy;
+  lazy.setSource(index);
+  const MonsterSpecies* dryad = lazy.get("Dryad");
+  if(index->getReadCount() != 1 || dryad == nullptr || dryad->number_ != 2 || lazy.get(2) != dryad
+    || lazy.get("Nobody") != nullptr || lazy.get(4) != nullptr) {
+    cleanUp();
+    std::cout << "[Fail] read " << index->getReadCount() << " species for one" << std::endl;
+    return 200;
+  }
+  std::vector<const MonsterSpecies*> all = lazy.getAll();
+  for(int number = 1; number <= 3; number++) {
+    const MonsterSpecies* a = whole.get(number);
+    const MonsterSpecies* b = lazy.get(number);
+    if(b == nullptr || a->name_ != b->name_ || a->type_.first_type_ != b->type_.first_type_
+      || a->base_stats_.speed_ != b->base_stats_.speed_ || a->learnset_.size() != b->learnset_.size()) {
+      cleanUp();
+      std::cout << "[Fail] species " << number << " read differently" << std::endl;
+      return 300;
+    }
+  }
+  if(all.size() != 3 || index->getReadCount() != 3) {
+    cleanUp();
+    std::cout << "[Fail] read " << index->getReadCount() << " species for all of them" << std::endl;
+    return 400;
+  }
+
+  // the sidecar is rebuilt once the file changes
+  write(text + "- {name: Elf, number: 4, types: [Fairy]}\n");
+  resources::SpeciesIndex changed;
+  bool reopened = changed.open(filepath, &error);
+  if(!reopened || changed.getEntries().size() != 4 || changed.getEntries()[3].name != "Elf") {
+    cleanUp();
+    std::cout << "[Fail] index wasn't rebuilt for a changed file" << std::endl;
+    return 500;
+  }
+
+  // items that can't be read on their own
+  write("- name: Orc\n  number: 1\n  basestats: &stats {hp: 1}\n- name: Imp\n  number: 3\n  basestats: *stats\n");
+  resources::SpeciesIndex anchored;
+  bool refused = !anchored.open(filepath, &error);
+  cleanUp();
+  if(!refused) {
+    std::cout << "[Fail] indexed species that share an anchor" << std::endl;
+    return 600;
+  }
+  return 0;
+}
 } // namespace test
 } // namespace pokeman
\ No newline at end of file
@@ -18,9 +18,9 @@
 namespace pokeman {
 namespace driver {
 int type_analysis(int argc, const char* argv[]) {
-  // get database
+  // get database, reading only the species the team needs
   bool error_occured;
-  resources::PokemanDatabase data = resources::initialize(&error_occured);
+  resources::PokemanDatabase data = resources::initialize(&error_occured, true);
   if(error_occured) {
     std::cout << "couldn't load database, closing now" << std::endl;
     return 1;
@@ -60,15 +60,10 @@ void TypeAnalyzer::analyze_against_type(Type type) const {
 
 void TypeAnalyzer::analyze_weaknesses(const size_t max_count) const {
   // calculate
+  std::vector<int> counts = countWeaknesses();
   std::map<Type, int> weakness_counts;
   for (int i = 0; i < kNullType; i++) {
-    int weakness_count = 0;
-    for (Monster monster : monsters_) {
-      if (evaluateSuitability(monster.species_->type_, (Type)i) < 0) {
-        weakness_count++;
-      }
-    }
-    weakness_counts[(Type)i] = weakness_count;
+    weakness_counts[(Type)i] = counts[i];
   }
 
   // reveal
@@ -77,6 +72,18 @@ void TypeAnalyzer::analyze_weaknesses(const size_t max_count) const {
   std::cout << std::endl;
 }
 
+std::vector<int> TypeAnalyzer::countWeaknesses() const {
+  std::vector<int> counts(kNullType, 0);
+  for (int i = 0; i < kNullType; i++) {
+    for (const Monster& monster : monsters_) {
+      if (evaluateSuitability(monster.species_->type_, (Type)i) < 0) {
+        counts[i]++;
+      }
+    }
+  }
+  return counts;
+}
+
 void TypeAnalyzer::analyze_strengths(const size_t max_count) const {
   // calculate
   std::map<Type, int> strength_counts;
@@ -30,6 +30,9 @@ public:
 
   void analyze_weaknesses(const size_t max_count) const;
 
+  /// Number of team members weak to each type, indexed by type.
+  std::vector<int> countWeaknesses() const;
+
   void analyze_strengths(const size_t max_count) const;
 
   /// adds pokemon to team